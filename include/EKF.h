@@ -11,7 +11,110 @@
 #include "Eigen/Dense"
 #include <memory>
 
-enum class KF_RET { SUCCESS = 0, EMPTY_ROBOT_MANAGER = -1, MATRIX_INVERSION_ERROR = -2 };
+/**
+ * @brief EKF return codes
+ * @details COV_FORM_FALLBACK is a completed update whose SQUARE_ROOT correction could not
+ * factor the covariance or the measurement noise and used JOSEPH instead
+ */
+enum class KF_RET { SUCCESS = 0, EMPTY_ROBOT_MANAGER = -1, MATRIX_INVERSION_ERROR = -2,
+                    COV_FORM_FALLBACK = 1 };
+
+/**
+ * @brief covariance correction after a Kalman update
+ * @details SIMPLE is (I - K H) Sigma. JOSEPH is (I - K H) Sigma (I - K H)^T + K R K^T, which
+ * stays symmetric and positive semi-definite for any gain. SQUARE_ROOT propagates a
+ * square root of Sigma through an orthogonal array update (correctFactor), so the result is
+ * a factor product and cannot lose definiteness to rounding. JOSEPH and SQUARE_ROOT store an
+ * exactly symmetric covariance
+ */
+enum class KF_COV_FORM { SIMPLE = 0, JOSEPH = 1, SQUARE_ROOT = 2 };
+
+/**
+ * @brief square-root correction of a stored covariance factor
+ * @details the pre-array [R^1/2, H L; 0, L] is rotated column by column (Givens) until its
+ * top-right block vanishes; the post-array is [S^1/2, 0; K S^1/2, L+], so the bottom-right
+ * block is a square root of the posterior covariance. Only orthogonal operations touch the
+ * factor, so the covariance it stands for cannot lose definiteness to rounding. The factor
+ * need not be triangular, only L L^T = Sigma
+ *
+ * @param[in,out] L: square root of the prior covariance, replaced by one of the posterior
+ * @param[in] H: measurement jacobian with respect to the state
+ * @param[in] R: measurement covariance
+ * @return false, leaving L unchanged, if R has no Cholesky factor, e.g. a noiseless sensor
+ */
+template <int N, int M, typename Scalar>
+bool correctFactor(Eigen::Matrix<Scalar, N, N>& L, const Eigen::Matrix<Scalar, M, N>& H,
+                   const Eigen::Matrix<Scalar, M, M>& R) {
+    Eigen::LLT<Eigen::Matrix<Scalar, M, M>> noise_llt(R);
+    if (noise_llt.info() != Eigen::Success) return false;
+    // top rows of the array; the bottom rows are [K S^1/2, L], with K S^1/2 zero at first
+    Eigen::Matrix<Scalar, M, M + N> top;
+    top.template leftCols<M>() = noise_llt.matrixL();
+    top.template rightCols<N>() = H * L;
+    Eigen::Matrix<Scalar, N, M> gain_block = Eigen::Matrix<Scalar, N, M>::Zero();
+    // top(i, i) is the pivot of row i; rows above it are already zero in both columns
+    for (int i = 0; i < M; i++) {
+        for (int j = 0; j < N; j++) {
+            Scalar a = top(i, i);
+            Scalar b = top(i, M + j);
+            if (b == 0) continue;
+            Scalar r = std::sqrt(a * a + b * b);
+            Scalar c = a / r;
+            Scalar s = b / r;
+            for (int row = i; row < M; row++) {
+                Scalar pivot = top(row, i);
+                top(row, i) = c * pivot + s * top(row, M + j);
+                top(row, M + j) = c * top(row, M + j) - s * pivot;
+            }
+            for (int row = 0; row < N; row++) {
+                Scalar pivot = gain_block(row, i);
+                gain_block(row, i) = c * pivot + s * L(row, j);
+                L(row, j) = c * L(row, j) - s * pivot;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief correct a covariance after a Kalman update with gain K
+ * @details stateless: SQUARE_ROOT factors Sigma for every call. Filters that keep the factor
+ * between updates call correctFactor directly, see LMEKF2D
+ *
+ * @param[in,out] sigma: prior covariance, replaced by the posterior
+ * @param[in] K: Kalman gain
+ * @param[in] H: measurement jacobian with respect to the state
+ * @param[in] R: measurement covariance
+ * @param[in] form: update form
+ * @return COV_FORM_FALLBACK if SQUARE_ROOT found no Cholesky factor of Sigma or R and
+ * used JOSEPH, SUCCESS otherwise
+ */
+template <int N, int M, typename Scalar>
+KF_RET correctCovariance(Eigen::Matrix<Scalar, N, N>& sigma,
+                         const Eigen::Matrix<Scalar, N, M>& K,
+                         const Eigen::Matrix<Scalar, M, N>& H,
+                         const Eigen::Matrix<Scalar, M, M>& R, KF_COV_FORM form) {
+    using StateCov = Eigen::Matrix<Scalar, N, N>;
+    if (form == KF_COV_FORM::SIMPLE) {
+        sigma = (StateCov::Identity() - K * H) * sigma;
+        return KF_RET::SUCCESS;
+    }
+
+    if (form == KF_COV_FORM::SQUARE_ROOT) {
+        Eigen::LLT<StateCov> sigma_llt(sigma);
+        StateCov L = sigma_llt.matrixL();
+        if (sigma_llt.info() == Eigen::Success && correctFactor(L, H, R)) {
+            sigma = L * L.transpose();
+            sigma = (sigma + sigma.transpose()).eval() * static_cast<Scalar>(0.5);
+            return KF_RET::SUCCESS;
+        }
+    }
+
+    const StateCov I_KH = StateCov::Identity() - K * H;
+    sigma = I_KH * sigma * I_KH.transpose() + K * R * K.transpose();
+    sigma = (sigma + sigma.transpose()).eval() * static_cast<Scalar>(0.5);
+    return form == KF_COV_FORM::SQUARE_ROOT ? KF_RET::COV_FORM_FALLBACK : KF_RET::SUCCESS;
+}
 
 /**
  * @brief: Abstract EKF class that offers two core EKF functions
@@ -52,6 +155,40 @@ public:
 
 };
 
+/**
+ * @brief convergence policy of the landmark EKFs
+ * @details a landmark whose covariance trace falls below trace_threshold is converged: its
+ * sightings still take part in association and weighting, but skip the EKF correction.
+ * A sighting whose squared Mahalanobis innovation exceeds thaw_gate resumes corrections.
+ * Unrelated to the frozen submaps, which hold landmarks outside the active region
+ */
+struct ConvergenceConfig {
+    float trace_threshold = 1e-4f;  // covariance trace below which a landmark converges, m^2
+    float thaw_gate = 9.21f;        // squared Mahalanobis innovation that thaws, 99% for 2 dof
+};
+
+/**
+ * @brief information contributed to one landmark by the observations of a frame
+ * @details information form (Lambda, eta) of the measurement terms, relative to the
+ * estimate they were linearized at; observations add up without any inversion
+ */
+struct LMInformation {
+    /**
+     * @brief sum of H^T R^-1 H
+     */
+    Eigen::Matrix2f info_matrix = Eigen::Matrix2f::Zero();
+
+    /**
+     * @brief sum of H^T R^-1 (z - h(mu))
+     */
+    Eigen::Vector2f info_vector = Eigen::Vector2f::Zero();
+
+    /**
+     * @brief number of observations accumulated
+     */
+    int count = 0;
+};
+
 class LMEKF2D final: public EKFBase {
 
 private:
@@ -66,6 +203,16 @@ private:
     */
    Eigen::Matrix2f m_sigma;
 
+   /**
+    * @brief square root of m_sigma kept between SQUARE_ROOT updates, valid if m_has_factor
+    */
+   Eigen::Matrix2f m_sigma_factor;
+
+   /**
+    * @brief set while m_sigma_factor matches m_sigma; any other write to m_sigma clears it
+    */
+   bool m_has_factor = false;
+
    /**
     * @brief shared pointer to the robot manager instance, used to access measurement models
     */
@@ -81,6 +228,64 @@ private:
     */
    struct Observation2D m_curr_obs;
 
+   /**
+    * @brief association terms of the stored observation, left by calcCPD: innovation
+    * (bearing not wrapped), its squared Mahalanobis distance under m_meas_cov, and the
+    * correspondence likelihood
+    * @details valid while m_terms_fresh; the update of the matched landmark reuses them
+    */
+   Eigen::Vector2f m_innovation;
+
+   float m_mahalanobis;
+
+   float m_cpd;
+
+   /**
+    * @brief set by calcCPD, cleared by a new observation and by every change of the estimate
+    */
+   bool m_terms_fresh = false;
+
+   /**
+    * @brief set once the covariance converged, see ConvergenceConfig
+    */
+   bool m_converged = false;
+
+   /**
+    * @brief skip the correction of a converged landmark if the innovation is consistent
+    * @details a larger innovation ends convergence and adds the innovation, mapped back to
+    * the landmark position, to the covariance, so that the correction can follow a landmark
+    * that moved
+    *
+    * @param[in] innovation: measurement minus prediction, bearing wrapped
+    * @param[in] mahalanobis: squared Mahalanobis distance of the innovation
+    * @param[in] H: measurement jacobian with respect to the landmark position
+    * @param[in] convergence: policy, nullptr if landmarks never converge
+    * @return true if the sighting was absorbed without a correction
+    */
+   bool absorbConverged(const Eigen::Vector2f& innovation, float mahalanobis,
+                        const Eigen::Matrix2f& H,
+                        const struct ConvergenceConfig* convergence);
+
+   /**
+    * @brief covariance correction in a given form
+    * @details SQUARE_ROOT updates the stored factor in place and factors m_sigma only when no
+    * factor is stored, i.e. on the first such update and after a write in another form
+    *
+    * @return COV_FORM_FALLBACK if SQUARE_ROOT had no factor and used JOSEPH, else SUCCESS
+    * @see correctCovariance for the parameters
+    */
+   KF_RET correctSigma(const Eigen::Matrix2f& K, const Eigen::Matrix2f& H,
+                       const Eigen::Matrix2f& R, KF_COV_FORM form);
+
+   /**
+    * @brief mark the landmark converged once its covariance trace is below the threshold
+    */
+   void checkConvergence(const struct ConvergenceConfig* convergence) {
+      if (convergence != nullptr && m_sigma.trace() < convergence->trace_threshold) {
+         m_converged = true;
+      }
+   }
+
 
 
    /**
@@ -113,6 +318,13 @@ public:
     */
     LMEKF2D(const LMEKF2D& ekf);
 
+   /**
+    * @brief copy assignment, lets particles reuse their landmark storage when resampling
+    *
+    * @param[in] ekf: EKF to be copied from
+    */
+    LMEKF2D& operator=(const LMEKF2D& ekf) = default;
+
    /**
     * @brief advances internal beliefs of 2D Landmark using the prediction model
     * @details no-op in Landmark EKF, since target is non dynamic
@@ -124,11 +336,100 @@ public:
    /**
     * @brief collects new measurement and update internal beliefs based on measurement
     */
-   KF_RET update() override;
+   KF_RET update() override { return update(KF_COV_FORM::SIMPLE); }
+
+   /**
+    * @brief update with the stored observation and a given covariance form
+    * @details reuses the innovation and its covariance from a calcCPD of the same observation
+    * and estimate, as left by the association; a converged landmark whose innovation passes
+    * the thaw gate then costs nothing more. The robot manager must not move in between
+    *
+    * @param[in] form: covariance update form
+    * @param[in] convergence: convergence policy, nullptr if landmarks never converge
+    * @return COV_FORM_FALLBACK if the update completed in JOSEPH form instead of SQUARE_ROOT
+    */
+   KF_RET update(KF_COV_FORM form, const struct ConvergenceConfig* convergence = nullptr);
+
+   /**
+    * @brief corrects the landmark belief with the stored observation, seen from a given pose
+    * @details standard EKF correction with the pose-conditioned measurement model of the
+    * robot manager; used by the FastSLAM 2.0 proposal where every particle has its own pose
+    *
+    * @param[in] rob_pose: robot pose the observation was taken from
+    */
+   KF_RET update(const struct Pose2D& rob_pose);
+
+   /**
+    * @brief pose-conditioned correction with the sensor model of another robot
+    * @details used when several robots share the landmark, so the robot that observed it
+    * need not be the one that started it
+    *
+    * @param[in] rob_pose: pose of the observing robot
+    * @param[in] observer: robot manager of the observing robot
+    * @param[in] form: covariance update form
+    * @param[in] convergence: convergence policy, nullptr if landmarks never converge
+    */
+   KF_RET update(const struct Pose2D& rob_pose, RobotManager2D& observer,
+                 KF_COV_FORM form = KF_COV_FORM::SIMPLE,
+                 const struct ConvergenceConfig* convergence = nullptr);
+
+   /**
+    * @brief fuse an independent estimate of the same landmark into this one
+    * @details product of the two Gaussians, used to merge the maps of different robots
+    *
+    * @param[in] mean: other landmark estimate
+    * @param[in] cov: covariance of the other estimate
+    * @param[in] form: covariance update form
+    */
+   KF_RET fuse(const struct Point2D& mean, const Eigen::Matrix2f& cov,
+               KF_COV_FORM form = KF_COV_FORM::SIMPLE);
+
+   /**
+    * @brief add one observation of this landmark to an information-form accumulator
+    * @details linearized at the current estimate, which does not move until
+    * applyInformation, so a burst of observations costs no inversion
+    *
+    * @param[in] rob_pose: pose of the observing robot
+    * @param[in] observer: robot manager of the observing robot
+    * @param[in] obs: observation of this landmark
+    * @param[in] noise_inv: inverse of the observer's measurement covariance
+    * @param[in,out] info: accumulator of the frame
+    */
+   void accumulate(const struct Pose2D& rob_pose, RobotManager2D& observer,
+                   const struct Observation2D& obs, const Eigen::Matrix2f& noise_inv,
+                   struct LMInformation& info) const;
+
+   /**
+    * @brief fold accumulated observations back into the moment form
+    * @details Sigma+ = (Sigma^-1 + Lambda)^-1 is computed as Sigma (I + Lambda Sigma)^-1,
+    * one inversion for all observations; the stored covariance is exactly symmetric
+    *
+    * @param[in] info: observations accumulated against the current estimate
+    * @param[in] convergence: convergence policy, nullptr if landmarks never converge
+    */
+   KF_RET applyInformation(const struct LMInformation& info,
+                           const struct ConvergenceConfig* convergence = nullptr);
+
+   /**
+    * @brief check one sighting against the landmark before it is accumulated
+    * @return true if the landmark is converged and absorbed the sighting, which then needs no
+    * accumulation; a large innovation ends convergence instead
+    * @see absorbConverged
+    */
+   bool absorbConverged(const struct Pose2D& rob_pose, RobotManager2D& observer,
+                        const struct Observation2D& obs,
+                        const struct ConvergenceConfig* convergence);
+
+   /**
+    * @brief true while the landmark skips its EKF corrections
+    */
+   bool isConverged() const { return m_converged; }
 
    /**
     * @brief calculates likelihood of correspondence given the measurement and prediction
     * @details we are not using robot manager to get measurement here to guarantee the timing of measurements
+    * The innovation and its covariance are kept until the observation or the estimate changes,
+    * so a repeated call and the update of the matched landmark reuse them
     * @return float; scalar value measuring likelihood that the observation matches internal state
     */
    float calcCPD();
@@ -139,6 +440,12 @@ public:
     * */
    const struct Point2D& getLMEst() const;
 
+   /**
+    * @brief returns current landmark position covariance in world frame
+    * @return a 2x2 covariance matrix
+    * */
+   const Eigen::Matrix2f& getLMCov() const { return m_sigma; }
+
    /**
     * @brief update internal copy of current robot observations
     * @details this ensures timing in constrast to the sampling approach. Must be called first every cycle
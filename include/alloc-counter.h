@@ -0,0 +1,55 @@
+/**
+ * @file alloc-counter.h
+ * @brief Defines a test utility that counts heap allocations within a scope
+ *
+ * Counting relies on replacements of the global operator new/delete, which live in
+ * alloc-counter.cpp. Only link that file into test executables.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Namespace for heap allocation accounting.
+ */
+namespace AllocCounter {
+
+/** Heap activity of the calling thread. */
+struct AllocStats {
+    uint64_t allocations;   // calls to any operator new
+    uint64_t deallocations; // calls to any operator delete with a non-null pointer
+    uint64_t bytes;         // bytes requested from operator new
+};
+
+/**
+ * @brief heap activity of the calling thread since it started
+ */
+AllocStats threadStats();
+
+/**
+ * @brief counts the allocations made by the calling thread while the object is alive
+ */
+class ScopedAllocCounter {
+
+private:
+    AllocStats m_start;
+
+public:
+    ScopedAllocCounter(): m_start(threadStats()) {}
+
+    /**
+     * @brief heap activity since construction
+     */
+    AllocStats delta() const {
+        AllocStats now = threadStats();
+        return {now.allocations - m_start.allocations,
+                now.deallocations - m_start.deallocations,
+                now.bytes - m_start.bytes};
+    }
+
+    uint64_t allocations() const { return delta().allocations; }
+};
+
+}; // namespace AllocCounter
@@ -0,0 +1,183 @@
+/**
+ * @file bench-util.h
+ * @brief Defines a small timing harness and machine-readable result writers
+ * used by the FastSLAM benchmark executables.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Namespace for benchmark timing and reporting utilities.
+ */
+namespace BenchUtil {
+
+/** Timing samples collected for a single benchmark case. */
+struct BenchResult {
+    std::string name;                     // kernel name, e.g. "LMEKF2D::update"
+    std::map<std::string, long> params;   // sweep parameters, e.g. {"landmarks", 100}
+    long iterations;                      // kernel calls timed per sample
+    std::vector<double> samples_ns;       // mean time per call of each sample (nanoseconds)
+    std::map<std::string, double> counters; // derived metrics, e.g. throughput or memory
+};
+
+/** Run-wide settings shared by every benchmark case. */
+struct BenchConfig {
+    int num_samples = 20;                 // timed samples per case
+    double min_sample_ms = 2.0;           // iteration count is doubled until a sample lasts this long
+    long max_iterations = 1L << 20;       // upper bound on calls per sample
+    std::string filter;                   // only run cases whose full name contains this string
+};
+
+/**
+ * @brief prevents the compiler from optimizing away a computed value
+ *
+ * @param[in] value: result of the benchmarked kernel
+ */
+template <class T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief builds the unique case name, e.g. "FastSLAMParticles::matchLandmark/landmarks:100"
+ *
+ * @param[in] name: kernel name
+ * @param[in] params: sweep parameters of the case
+ * @return full case name
+ */
+std::string fullName(const std::string& name, const std::map<std::string, long>& params);
+
+/**
+ * @brief time a kernel; the iteration count is calibrated so that each sample
+ * lasts at least config.min_sample_ms
+ *
+ * @param[in] name: kernel name
+ * @param[in] params: sweep parameters of the case
+ * @param[in] config: run-wide benchmark settings
+ * @param[in] kernel: callable invoked once per iteration
+ * @return collected samples; empty if the case was filtered out
+ */
+template <class Fn>
+BenchResult runBenchmark(const std::string& name, const std::map<std::string, long>& params,
+                         const BenchConfig& config, Fn&& kernel) {
+    using Clock = std::chrono::steady_clock;
+    BenchResult result{name, params, 0, {}, {}};
+    if (!config.filter.empty() &&
+        fullName(name, params).find(config.filter) == std::string::npos) {
+        return result;
+    }
+
+    auto time_batch = [&kernel](long iterations) {
+        auto start = Clock::now();
+        for (long i = 0; i < iterations; i++) {
+            kernel();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    };
+
+    // calibrate (doubles as warm-up)
+    long iterations = 1;
+    while (iterations < config.max_iterations &&
+           time_batch(iterations) < config.min_sample_ms * 1e6) {
+        iterations *= 2;
+    }
+
+    result.iterations = iterations;
+    result.samples_ns.reserve(config.num_samples);
+    for (int i = 0; i < config.num_samples; i++) {
+        result.samples_ns.push_back(time_batch(iterations) / static_cast<double>(iterations));
+    }
+    return result;
+}
+
+/**
+ * @brief arithmetic mean of the samples
+ */
+double mean(const std::vector<double>& samples);
+
+/**
+ * @brief sample standard deviation
+ */
+double stddev(const std::vector<double>& samples);
+
+/**
+ * @brief nearest-rank percentile of the samples
+ *
+ * @param[in] samples: unsorted samples
+ * @param[in] pct: percentile in [0, 100]
+ * @return the requested percentile, 0 for empty input
+ */
+double percentile(std::vector<double> samples, double pct);
+
+/**
+ * @brief current resident set size of this process
+ * @return RSS in kilobytes, 0 if unavailable
+ */
+long currentRSSKb();
+
+/**
+ * @brief peak resident set size of this process
+ * @return peak RSS in kilobytes, 0 if unavailable
+ */
+long peakRSSKb();
+
+/**
+ * @brief write results as JSON, including the raw samples of every case
+ *
+ * @param[in] path: output file
+ * @param[in] results: benchmark results
+ * @return true if the file was written
+ */
+bool writeJSON(const std::string& path, const std::vector<BenchResult>& results);
+
+/**
+ * @brief read results written by writeJSON
+ *
+ * @param[in] path: input file
+ * @param[out] results: parsed benchmark results
+ * @return true if the file was read and parsed
+ */
+bool readJSON(const std::string& path, std::vector<BenchResult>& results);
+
+/**
+ * @brief one-sided Mann-Whitney U test that samples_a tends to be larger than samples_b
+ * @details uses the normal approximation with tie and continuity correction
+ *
+ * @param[in] samples_a: e.g. timings of the new run
+ * @param[in] samples_b: e.g. timings of the baseline
+ * @return p-value; 1 if either side is empty
+ */
+double mannWhitneyGreaterP(const std::vector<double>& samples_a,
+                           const std::vector<double>& samples_b);
+
+/**
+ * @brief bootstrap confidence interval of median(samples_a) / median(samples_b) - 1
+ *
+ * @param[in] samples_a: e.g. timings of the new run
+ * @param[in] samples_b: e.g. timings of the baseline
+ * @param[in] confidence: interval coverage, e.g. 0.95
+ * @param[in] num_resamples: bootstrap iterations
+ * @param[in] seed: random seed, fixed so that comparisons are reproducible
+ * @return lower and upper bound of the relative change
+ */
+std::pair<double, double> bootstrapMedianChangeCI(const std::vector<double>& samples_a,
+                                                  const std::vector<double>& samples_b,
+                                                  double confidence, int num_resamples,
+                                                  unsigned int seed);
+
+/**
+ * @brief write one summary row per case as CSV; counters become extra columns
+ *
+ * @param[in] path: output file
+ * @param[in] results: benchmark results
+ * @return true if the file was written
+ */
+bool writeCSV(const std::string& path, const std::vector<BenchResult>& results);
+
+}; // namespace BenchUtil
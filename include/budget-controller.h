@@ -0,0 +1,137 @@
+/**
+ * @file budget-controller.h
+ * @brief Defines a controller that keeps the filter within a per-frame time budget
+ *
+ * The controller is fed the measured cost of every frame and answers with a particle
+ * budget and a cap on the observations processed per frame. Under load it first sheds
+ * particles, down to min_particles or until the effective sample size drops below its
+ * floor, and only then sheds observations, down to min_observations. When load eases it
+ * restores observations first and particles second. Frame costs are smoothed with an
+ * exponential moving average, and a change is only made after the smoothed cost stays
+ * outside the [low_water, high_water] band for hysteresis_frames consecutive frames.
+ * A frame that had to drop observations to meet its deadline counts as above the band.
+ */
+
+#pragma once
+
+#include <climits>
+
+enum class PF_BUDGET_ACTION{ HOLD = 0, SHRINK_PARTICLES = 1, GROW_PARTICLES = 2,
+                             SHED_OBSERVATIONS = 3, RESTORE_OBSERVATIONS = 4 };
+constexpr unsigned int UNLIMITED_OBSERVATIONS = UINT_MAX;
+
+/**
+ * @brief deadline, quality floors and smoothing of the budget controller
+ */
+struct BudgetConfig {
+    double deadline_us = 10000.0;      // time budget of one updateFilter call
+    double target_utilization = 0.8;   // fraction of the deadline a resize aims for
+    double high_water = 0.95;          // shed load when the smoothed cost exceeds this fraction
+    double low_water = 0.6;            // add load back when the smoothed cost is below this fraction
+    unsigned int hysteresis_frames = 3; // consecutive frames outside the band before acting
+    float smoothing = 0.2f;            // weight of the newest frame in the moving average
+    float max_step = 0.25f;            // largest relative change of one decision
+    unsigned int min_particles = 10;   // particle floor
+    unsigned int max_particles = 500;  // particle ceiling
+    unsigned int min_observations = 4; // observations always processed, if that many arrive
+    float min_effective_ratio = 0.1f;  // keep particles while N_eff / N is below this
+};
+
+/**
+ * @brief measured cost and quality of one frame
+ */
+struct FrameCost {
+    double frame_us;                      // wall time of the frame
+    unsigned int num_particles;           // particles that were updated
+    unsigned int num_observations;        // observations that arrived
+    unsigned int processed_observations;  // observations that were processed
+    double effective_particles;           // effective sample size before resampling
+};
+
+/**
+ * @brief outcome of one controller update
+ */
+struct BudgetDecision {
+    PF_BUDGET_ACTION action = PF_BUDGET_ACTION::HOLD;
+    unsigned int particle_budget = 0;                       // particles to carry from now on
+    unsigned int observation_cap = UNLIMITED_OBSERVATIONS;  // observations to process per frame
+    double smoothed_us = 0.0;                               // moving average of the frame cost
+    bool overrun = false;                                   // the frame exceeded the deadline
+};
+
+class BudgetController {
+
+private:
+    struct BudgetConfig m_config;
+
+    unsigned int m_particle_budget;
+
+    unsigned int m_observation_cap = UNLIMITED_OBSERVATIONS;
+
+    double m_smoothed_us = 0.0;
+
+    /**
+     * @brief moving average of the cost of one observation in one particle
+     */
+    double m_observation_us = 0.0;
+
+    bool m_has_sample = false;
+
+    /**
+     * @brief consecutive frames above the high-water and below the low-water mark
+     */
+    unsigned int m_frames_over = 0;
+    unsigned int m_frames_under = 0;
+
+    /**
+     * @brief shed particles, or observations if particles are at their floor
+     */
+    PF_BUDGET_ACTION shedLoad(const struct FrameCost& cost);
+
+    /**
+     * @brief restore observations, or particles if every observation is processed
+     */
+    PF_BUDGET_ACTION addLoad(const struct FrameCost& cost);
+
+public:
+
+    /**
+     * @brief class constructor
+     *
+     * @param[in] config: deadline, floors and smoothing; bounds are sanitized
+     * @param[in] initial_particles: current particle count, clamped to the bounds
+     */
+    BudgetController(const struct BudgetConfig& config, unsigned int initial_particles);
+
+    BudgetController(): BudgetController(BudgetConfig{}, BudgetConfig{}.max_particles) {}
+
+    /**
+     * @brief account for one frame and decide the budgets of the following frames
+     * @details frames without observations carry no per-particle work and are ignored
+     *
+     * @param[in] cost: measured cost and quality of the frame
+     * @return action taken and the resulting budgets
+     */
+    struct BudgetDecision update(const struct FrameCost& cost);
+
+    const struct BudgetConfig& getConfig() const { return m_config; }
+
+    unsigned int getParticleBudget() const { return m_particle_budget; }
+
+    unsigned int getObservationCap() const { return m_observation_cap; }
+
+    double getSmoothedCostUs() const { return m_smoothed_us; }
+
+    /**
+     * @brief smoothed cost of processing one observation in one particle, 0 before the
+     * first frame with observations
+     * @details lets a filter that gathers the whole frame before updating apply the
+     * deadline to the number of observations it takes
+     */
+    double getObservationCostUs() const { return m_observation_us; }
+};
+
+/**
+ * @brief label of a budget action, e.g. "shrink_particles"
+ */
+const char* budgetActionName(PF_BUDGET_ACTION action);
@@ -0,0 +1,105 @@
+/**
+ * @file consensus-map.h
+ * @brief Defines a lazily maintained, weight-averaged landmark map across all particles
+ *
+ * Every landmark carries a uid, given by the frame observation that started it. Particles
+ * that start a landmark from the same observation share the uid, and resampled copies
+ * keep it, so a uid identifies the same landmark hypothesis in every particle. The
+ * consensus of a landmark is the particle-weighted mixture of its per-particle estimates.
+ *
+ * The filter marks the uids it touches while updating; a query only recomputes those, so
+ * repeated queries between frames are O(1). Landmarks that are not observed keep their
+ * consensus until they are observed again, even if resampling changed the particles
+ * that hold them.
+ */
+
+#pragma once
+
+#include "core-structs.h"
+#include <cstdint>
+#include <vector>
+
+class FastSLAMParticles;
+
+/**
+ * @brief landmark uid of a particle used outside a filter
+ */
+constexpr uint32_t LM_UID_NONE = UINT32_MAX;
+
+/**
+ * @brief consensus estimate of one landmark
+ */
+struct ConsensusLandmark {
+    uint32_t uid;          // landmark uid shared across particles
+    struct Point2D mean;   // weighted mean of the per-particle estimates
+    Eigen::Matrix2f cov;   // mixture covariance, including the spread between particles
+    WeightScalar support;  // total weight of the particles holding the landmark, in (0, 1]
+};
+
+class ConsensusMap {
+
+private:
+    /**
+     * @brief live landmarks, sorted by uid
+     */
+    std::vector<struct ConsensusLandmark> m_landmarks;
+
+    /**
+     * @brief uids touched since the last refresh, deduplicated through m_dirty_flags
+     */
+    std::vector<uint32_t> m_dirty_uids;
+
+    /**
+     * @brief per uid, set while the uid is in m_dirty_uids
+     */
+    std::vector<uint8_t> m_dirty_flags;
+
+    uint64_t m_version = 0;
+
+public:
+
+    /**
+     * @brief mark a landmark as changed since the last refresh
+     *
+     * @param[in] uid: landmark uid; LM_UID_NONE is ignored
+     */
+    void touch(uint32_t uid) {
+        if (uid == LM_UID_NONE) return;
+        if (uid >= m_dirty_flags.size()) m_dirty_flags.resize(uid + 1, 0);
+        if (m_dirty_flags[uid]) return;
+        m_dirty_flags[uid] = 1;
+        m_dirty_uids.push_back(uid);
+    }
+
+    /**
+     * @brief recompute the touched landmarks from the particles
+     * @details O(touched * particles * log landmarks), plus a scan of the frozen landmarks
+     * in submap mode; a no-op if nothing was touched
+     *
+     * @param[in] particles: particle set
+     * @param[in] weights: normalized weights, indexed like the particles
+     */
+    void refresh(const std::vector<FastSLAMParticles>& particles,
+                 const std::vector<WeightScalar>& weights);
+
+    /**
+     * @brief true if landmarks were touched since the last refresh
+     */
+    bool isStale() const { return !m_dirty_uids.empty(); }
+
+    /**
+     * @brief incremented by every refresh that changed the map
+     */
+    uint64_t getVersion() const { return m_version; }
+
+    /**
+     * @brief live landmarks, sorted by uid
+     */
+    const std::vector<struct ConsensusLandmark>& getLandmarks() const { return m_landmarks; }
+
+    /**
+     * @brief look up one landmark
+     * @return pointer into the map, valid until the next refresh; nullptr if not live
+     */
+    const struct ConsensusLandmark* find(uint32_t uid) const;
+};
@@ -8,10 +8,31 @@
 #include <optional>
 #include <Eigen/Dense>
 
+/**
+ * @brief scalar of world coordinates (Point2D, Pose2D)
+ * @details float unless configured with -DPF_COORD_PRECISION=double, for long missions
+ * far from the origin. Covariances, observations and other relative quantities stay float
+ */
+#ifdef PF_COORD_DOUBLE
+using CoordScalar = double;
+#else
+using CoordScalar = float;
+#endif
+
+/**
+ * @brief scalar of the particle weights
+ * @details float unless configured with -DPF_WEIGHT_PRECISION=double
+ */
+#ifdef PF_WEIGHT_DOUBLE
+using WeightScalar = double;
+#else
+using WeightScalar = float;
+#endif
+
 /** A point (position only) in the 2D plane. */
 struct Point2D {
-    float x;           // x-coordinate (scaled in meters)
-    float y;           // y-coordinate (scaled in meters)
+    CoordScalar x;     // x-coordinate (scaled in meters)
+    CoordScalar y;     // y-coordinate (scaled in meters)
 
     struct Point2D& operator+=(const Eigen::Vector2f& rhs) {
        x += rhs[0];
@@ -22,8 +43,8 @@ struct Point2D {
 
 /** A pose (position and orientation) in the 2D plane. */
 struct Pose2D {
-    float x;           // x-coordinate (scaled in meters)
-    float y;           // y-coordinate (scaled in meters)
+    CoordScalar x;     // x-coordinate (scaled in meters)
+    CoordScalar y;     // y-coordinate (scaled in meters)
     float theta_rad;   // heading (radians) wrapped into [-pi, pi]
 
     /**
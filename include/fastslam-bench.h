@@ -0,0 +1,48 @@
+/**
+ * @file fastslam-bench.h
+ * @brief Defines the single accessor through which tests and benchmarks reach the private
+ * particle filter kernels and state
+ *
+ * Only include this header from test and benchmark executables; the library itself
+ * never uses it.
+ */
+
+#pragma once
+
+#include "particle-filter.h"
+
+/**
+ * @brief friend of FastSLAMParticles and FastSLAMPF exposing their private kernels
+ */
+class FastSLAMBench {
+public:
+    /**
+     * @brief associate one sighting with the landmarks of a particle
+     *
+     * @return data association index
+     */
+    static int matchLandmark(FastSLAMParticles& particle, const struct Observation2D& obs) {
+        return particle.matchLandmark(obs);
+    }
+
+    /**
+     * @brief draw one pose from the motion model around a mean
+     */
+    static struct Pose2D samplePose(FastSLAMPF& filter, const struct Pose2D& mean) {
+        return filter.samplePose(mean);
+    }
+
+    /**
+     * @brief resample the particle set by the current weights
+     */
+    static void reSampleParticles(FastSLAMPF& filter) {
+        filter.reSampleParticles();
+    }
+
+    /**
+     * @brief writable particle, e.g. to plant a map in a test
+     */
+    static FastSLAMParticles& particle(FastSLAMPF& filter, int idx) {
+        return filter.m_particle_set[idx];
+    }
+};
@@ -0,0 +1,151 @@
+/**
+ * @file landmark-ekf.h
+ * @brief Defines a dimension-generic landmark EKF with fixed-size Eigen types
+ *
+ * LandmarkEKF<Model> holds one landmark estimate of the type described by Model (see
+ * landmark-models.h), which also fixes the state and measurement dimensions and the
+ * scalar. The model is bound to the filter, so an instantiation has no virtual calls and
+ * no dynamic-size matrices: every product and inverse is on fixed-size Eigen types, which
+ * Eigen unrolls for these dimensions.
+ */
+
+#pragma once
+
+#include "EKF.h"
+#include "landmark-models.h"
+#include <Eigen/Dense>
+#include <cmath>
+
+template <class Model>
+class LandmarkEKF : private Model {
+
+public:
+    using Scalar = typename Model::Scalar;
+
+    static constexpr int state_dim = Model::state_dim;
+    static constexpr int meas_dim = Model::meas_dim;
+
+    static_assert(state_dim > 0 && meas_dim > 0, "landmark dimensions must be positive");
+
+    using State = Eigen::Matrix<Scalar, state_dim, 1>;
+    using StateCov = Eigen::Matrix<Scalar, state_dim, state_dim>;
+    using Meas = Eigen::Matrix<Scalar, meas_dim, 1>;
+    using MeasCov = Eigen::Matrix<Scalar, meas_dim, meas_dim>;
+    using Jacobian = Eigen::Matrix<Scalar, meas_dim, state_dim>;
+
+private:
+    /**
+     * @brief landmark state estimate
+     */
+    State m_mu;
+
+    /**
+     * @brief landmark estimate covariance
+     */
+    StateCov m_sigma;
+
+public:
+
+    /**
+     * @brief zero state, identity covariance
+     */
+    LandmarkEKF(): m_mu(State::Zero()), m_sigma(StateCov::Identity()) {}
+
+    /**
+     * @brief parametrized constructor
+     * @details a stateless model (no parameters) takes no storage in the filter
+     *
+     * @param[in] mu: initial landmark state
+     * @param[in] sigma: initial covariance
+     * @param[in] model: measurement model, e.g. carrying the sensor height
+     */
+    LandmarkEKF(const State& mu, const StateCov& sigma, const Model& model = Model()):
+        Model(model), m_mu(mu), m_sigma(sigma) {}
+
+    /**
+     * @brief restart the landmark from its first measurement
+     * @details the measurement noise is mapped through the inverse jacobian. Needs as many
+     * measurement rows as states
+     *
+     * @param[in] pose: robot pose the measurement was taken from
+     * @param[in] z: first measurement
+     * @param[in] meas_noise: measurement covariance
+     * @return MATRIX_INVERSION_ERROR, leaving the filter unchanged, if the measurement does
+     * not place the landmark or the jacobian at that place is singular or not finite
+     */
+    KF_RET initialize(const struct Pose2D& pose, const Meas& z, const MeasCov& meas_noise) {
+        static_assert(state_dim == meas_dim, "initialization needs an invertible measurement");
+        State mu = Model::inverse(pose, z);
+        if (!mu.allFinite()) return KF_RET::MATRIX_INVERSION_ERROR;
+        Jacobian H = Model::jacobian(pose, mu);
+        Scalar det = H.determinant();
+        if (det == 0 || !std::isfinite(det)) return KF_RET::MATRIX_INVERSION_ERROR;
+        Jacobian H_inv = H.inverse();
+        m_mu = mu;
+        m_sigma = H_inv * meas_noise * H_inv.transpose();
+        return KF_RET::SUCCESS;
+    }
+
+    const State& getMean() const { return m_mu; }
+
+    const StateCov& getCov() const { return m_sigma; }
+
+    const Model& getModel() const { return *this; }
+
+    /**
+     * @brief EKF correction from a precomputed innovation and jacobian
+     *
+     * @param[in] innovation: measurement minus prediction, angles wrapped
+     * @param[in] H: measurement jacobian with respect to the landmark state
+     * @param[in] meas_noise: measurement covariance
+     * @param[in] form: covariance update form; SQUARE_ROOT factors the covariance per call
+     * @return COV_FORM_FALLBACK if the update completed in JOSEPH form instead of SQUARE_ROOT
+     */
+    KF_RET correct(const Meas& innovation, const Jacobian& H, const MeasCov& meas_noise,
+                   KF_COV_FORM form = KF_COV_FORM::SIMPLE) {
+        MeasCov S = H * m_sigma * H.transpose() + meas_noise;
+        Scalar det = S.determinant();
+        if (det == 0 || !std::isfinite(det)) {
+            return KF_RET::MATRIX_INVERSION_ERROR;
+        }
+        Eigen::Matrix<Scalar, state_dim, meas_dim> K = m_sigma * H.transpose() * S.inverse();
+        m_mu += K * innovation;
+        return correctCovariance(m_sigma, K, H, meas_noise, form);
+    }
+
+    /**
+     * @brief correct the landmark with a measurement taken from a given pose
+     *
+     * @param[in] pose: robot pose hypothesis
+     * @param[in] z: measurement
+     * @param[in] meas_noise: measurement covariance
+     * @param[in] form: covariance update form
+     */
+    KF_RET update(const struct Pose2D& pose, const Meas& z, const MeasCov& meas_noise,
+                  KF_COV_FORM form = KF_COV_FORM::SIMPLE) {
+        KF_RET status = correct(Model::residual(z, Model::predict(pose, m_mu)),
+                                Model::jacobian(pose, m_mu), meas_noise, form);
+        Model::normalize(m_mu);
+        return status;
+    }
+
+    /**
+     * @brief likelihood of a measurement under the landmark estimate
+     * @return Gaussian density of the innovation, -1 if its covariance is singular
+     */
+    Scalar likelihood(const struct Pose2D& pose, const Meas& z,
+                      const MeasCov& meas_noise) const {
+        Jacobian H = Model::jacobian(pose, m_mu);
+        MeasCov S = H * m_sigma * H.transpose() + meas_noise;
+        Scalar det = S.determinant();
+        if (det <= 0 || !std::isfinite(det)) return -1;
+        Meas innovation = Model::residual(z, Model::predict(pose, m_mu));
+        Scalar mahalanobis = innovation.dot(S.inverse() * innovation);
+        return std::exp(static_cast<Scalar>(-0.5) * mahalanobis) /
+            std::sqrt(std::pow(static_cast<Scalar>(2 * M_PI), meas_dim) * det);
+    }
+};
+
+using PointLandmarkEKF2D = LandmarkEKF<LandmarkModels::PointModel2D<float>>;
+using PointLandmarkEKF3D = LandmarkEKF<LandmarkModels::PointModel3D<float>>;
+using OrientedLandmarkEKF2D = LandmarkEKF<LandmarkModels::OrientedModel2D<float>>;
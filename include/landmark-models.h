@@ -0,0 +1,180 @@
+/**
+ * @file landmark-models.h
+ * @brief Measurement models for the dimension-generic LandmarkEKF
+ *
+ * A model describes one landmark type seen from a planar robot pose. It provides
+ * - Scalar: floating-point type of the state and measurement
+ * - state_dim, meas_dim: landmark state and measurement sizes
+ * - predict(pose, lm): expected measurement
+ * - jacobian(pose, lm): d predict / d lm, meas_dim x state_dim
+ * - inverse(pose, z): landmark state that would produce z
+ * - residual(z, z_hat): z - z_hat with angular rows wrapped
+ * - normalize(lm): wraps angular state components after a correction
+ *
+ * Models are plain structs. A LandmarkEKF takes its model as template argument, so every
+ * call is resolved and inlined at compile time, and filters of different landmark types
+ * are different types even when their dimensions agree.
+ */
+
+#pragma once
+
+#include "core-structs.h"
+#include <Eigen/Dense>
+#include <cmath>
+
+namespace LandmarkModels {
+
+/**
+ * @brief wrap an angle into [-pi, pi]
+ * @details same result as MathUtil::wrapAngle, which is float only; the models are also
+ * instantiated with double, where a float round trip would lose the precision they exist for
+ */
+template <typename Scalar>
+inline Scalar wrapAngle(Scalar angle) {
+    return std::remainder(angle, static_cast<Scalar>(2 * M_PI));
+}
+
+/**
+ * @brief 2D point landmark observed by range and bearing
+ */
+template <typename ScalarT = float>
+struct PointModel2D {
+    using Scalar = ScalarT;
+    static constexpr int state_dim = 2;
+    static constexpr int meas_dim = 2;
+    using State = Eigen::Matrix<Scalar, state_dim, 1>;
+    using Meas = Eigen::Matrix<Scalar, meas_dim, 1>;
+    using Jacobian = Eigen::Matrix<Scalar, meas_dim, state_dim>;
+
+    Meas predict(const struct Pose2D& pose, const State& lm) const {
+        Scalar dx = lm(0) - pose.x;
+        Scalar dy = lm(1) - pose.y;
+        return Meas(std::sqrt(dx * dx + dy * dy),
+                    wrapAngle(std::atan2(dy, dx) - static_cast<Scalar>(pose.theta_rad)));
+    }
+
+    Jacobian jacobian(const struct Pose2D& pose, const State& lm) const {
+        Scalar dx = lm(0) - pose.x;
+        Scalar dy = lm(1) - pose.y;
+        Scalar q = dx * dx + dy * dy;
+        Scalar r = std::sqrt(q);
+        Jacobian H;
+        H << dx / r, dy / r,
+             -dy / q, dx / q;
+        return H;
+    }
+
+    State inverse(const struct Pose2D& pose, const Meas& z) const {
+        Scalar heading = pose.theta_rad + z(1);
+        return State(pose.x + z(0) * std::cos(heading), pose.y + z(0) * std::sin(heading));
+    }
+
+    Meas residual(const Meas& z, const Meas& z_hat) const {
+        return Meas(z(0) - z_hat(0), wrapAngle(z(1) - z_hat(1)));
+    }
+
+    void normalize(State&) const {}
+};
+
+/**
+ * @brief 3D point landmark observed by range, bearing and elevation
+ * @details the sensor sits sensor_height above the planar robot pose; elevation is
+ * positive upwards
+ */
+template <typename ScalarT = float>
+struct PointModel3D {
+    using Scalar = ScalarT;
+    static constexpr int state_dim = 3;
+    static constexpr int meas_dim = 3;
+    using State = Eigen::Matrix<Scalar, state_dim, 1>;
+    using Meas = Eigen::Matrix<Scalar, meas_dim, 1>;
+    using Jacobian = Eigen::Matrix<Scalar, meas_dim, state_dim>;
+
+    Scalar sensor_height = 0;
+
+    Meas predict(const struct Pose2D& pose, const State& lm) const {
+        Scalar dx = lm(0) - pose.x;
+        Scalar dy = lm(1) - pose.y;
+        Scalar dz = lm(2) - sensor_height;
+        Scalar planar = std::sqrt(dx * dx + dy * dy);
+        return Meas(std::sqrt(planar * planar + dz * dz),
+                    wrapAngle(std::atan2(dy, dx) - static_cast<Scalar>(pose.theta_rad)),
+                    std::atan2(dz, planar));
+    }
+
+    Jacobian jacobian(const struct Pose2D& pose, const State& lm) const {
+        Scalar dx = lm(0) - pose.x;
+        Scalar dy = lm(1) - pose.y;
+        Scalar dz = lm(2) - sensor_height;
+        Scalar q = dx * dx + dy * dy;
+        Scalar planar = std::sqrt(q);
+        Scalar r2 = q + dz * dz;
+        Scalar r = std::sqrt(r2);
+        Jacobian H;
+        H << dx / r, dy / r, dz / r,
+             -dy / q, dx / q, 0,
+             -dz * dx / (planar * r2), -dz * dy / (planar * r2), planar / r2;
+        return H;
+    }
+
+    State inverse(const struct Pose2D& pose, const Meas& z) const {
+        Scalar heading = pose.theta_rad + z(1);
+        Scalar planar = z(0) * std::cos(z(2));
+        return State(pose.x + planar * std::cos(heading), pose.y + planar * std::sin(heading),
+                     sensor_height + z(0) * std::sin(z(2)));
+    }
+
+    Meas residual(const Meas& z, const Meas& z_hat) const {
+        return Meas(z(0) - z_hat(0), wrapAngle(z(1) - z_hat(1)), z(2) - z_hat(2));
+    }
+
+    void normalize(State&) const {}
+};
+
+/**
+ * @brief oriented 2D landmark, e.g. a fiducial tag, observed by range, bearing and its
+ * heading relative to the robot
+ */
+template <typename ScalarT = float>
+struct OrientedModel2D {
+    using Scalar = ScalarT;
+    static constexpr int state_dim = 3;
+    static constexpr int meas_dim = 3;
+    using State = Eigen::Matrix<Scalar, state_dim, 1>;
+    using Meas = Eigen::Matrix<Scalar, meas_dim, 1>;
+    using Jacobian = Eigen::Matrix<Scalar, meas_dim, state_dim>;
+
+    Meas predict(const struct Pose2D& pose, const State& lm) const {
+        Scalar dx = lm(0) - pose.x;
+        Scalar dy = lm(1) - pose.y;
+        return Meas(std::sqrt(dx * dx + dy * dy),
+                    wrapAngle(std::atan2(dy, dx) - static_cast<Scalar>(pose.theta_rad)),
+                    wrapAngle(lm(2) - static_cast<Scalar>(pose.theta_rad)));
+    }
+
+    Jacobian jacobian(const struct Pose2D& pose, const State& lm) const {
+        Scalar dx = lm(0) - pose.x;
+        Scalar dy = lm(1) - pose.y;
+        Scalar q = dx * dx + dy * dy;
+        Scalar r = std::sqrt(q);
+        Jacobian H;
+        H << dx / r, dy / r, 0,
+             -dy / q, dx / q, 0,
+             0, 0, 1;
+        return H;
+    }
+
+    State inverse(const struct Pose2D& pose, const Meas& z) const {
+        Scalar heading = pose.theta_rad + z(1);
+        return State(pose.x + z(0) * std::cos(heading), pose.y + z(0) * std::sin(heading),
+                     wrapAngle(static_cast<Scalar>(pose.theta_rad) + z(2)));
+    }
+
+    Meas residual(const Meas& z, const Meas& z_hat) const {
+        return Meas(z(0) - z_hat(0), wrapAngle(z(1) - z_hat(1)), wrapAngle(z(2) - z_hat(2)));
+    }
+
+    void normalize(State& lm) const { lm(2) = wrapAngle(lm(2)); }
+};
+
+}; // namespace LandmarkModels
@@ -0,0 +1,78 @@
+/**
+ * @file landmark-staging.h
+ * @brief Defines the staging list of tentative landmarks shared by all particles
+ *
+ * In staging mode a sighting that no particle can associate does not start an EKF right
+ * away. It is placed in the world from the odometry pose and recorded in one list for the
+ * whole filter, where sightings within gate_m of each other accumulate. A tentative landmark
+ * seen in min_sightings different frames, within window_frames of its first sighting, is
+ * promoted: every particle that could not associate the promoting sighting starts an EKF
+ * from it. Tentative landmarks that do not reach min_sightings in time expire, so clutter
+ * and one-off detections never reach the particles.
+ */
+
+#pragma once
+
+#include "core-structs.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief promotion rule of the staging list
+ */
+struct StagingConfig {
+    int min_sightings = 3;      // frames a tentative landmark must be seen in to be promoted
+    int window_frames = 10;     // frames after its first sighting before it expires
+    float gate_m = 0.5f;        // sightings closer than this to a tentative landmark join it
+};
+
+/**
+ * @brief landmark seen too few times to be mapped yet
+ */
+struct TentativeLandmark {
+    struct Point2D position;    // mean of the sightings, placed from the odometry pose
+    int sightings;              // frames the landmark was seen in
+    uint64_t first_frame;
+    uint64_t last_frame;
+};
+
+class LandmarkStaging {
+
+private:
+    struct StagingConfig m_config;
+
+    std::vector<struct TentativeLandmark> m_tentative;
+
+    uint64_t m_frame = 0;
+
+public:
+
+    /**
+     * @brief set the promotion rule, keeps the tentative landmarks
+     */
+    void configure(const struct StagingConfig& config);
+
+    const struct StagingConfig& getConfig() const { return m_config; }
+
+    /**
+     * @brief start a frame, expiring the tentative landmarks that ran out of time
+     */
+    void beginFrame();
+
+    /**
+     * @brief record an unassociated sighting
+     * @details joins the nearest tentative landmark within gate_m, or starts one. Repeated
+     * sightings within one frame count once
+     *
+     * @param[in] position: world position of the sighting
+     * @return true if the sighting promotes its tentative landmark, which leaves the list
+     */
+    bool addSighting(const struct Point2D& position);
+
+    /**
+     * @brief drop every tentative landmark
+     */
+    void clear() { m_tentative.clear(); }
+
+    const std::vector<struct TentativeLandmark>& getTentative() const { return m_tentative; }
+};
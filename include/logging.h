@@ -0,0 +1,204 @@
+/**
+ * @file logging.h
+ * @brief Defines leveled, structured logging with an asynchronous ring-buffer sink
+ *
+ * Log statements below the compile-time level PF_LOG_LEVEL (cmake -DPF_LOG_LEVEL=DEBUG,
+ * default INFO) expand to nothing. Compiled-in statements below the runtime level
+ * (setLevel, initially PF_LOG_LEVEL) only read an atomic. Enabled statements copy a fixed-size record into a
+ * lock-free ring buffer; a background thread formats the records as logfmt lines
+ * (ts=... level=... msg="..." key=value) and hands them to the sink. The first submitted
+ * record allocates the ring and starts the thread; after that producers never lock,
+ * allocate or block: when the ring is full the record is dropped and counted.
+ *
+ * usage: PF_LOG_WARN("non-invertible landmark jacobian", "det", det);
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define PF_LOG_LEVEL_TRACE 0
+#define PF_LOG_LEVEL_DEBUG 1
+#define PF_LOG_LEVEL_INFO 2
+#define PF_LOG_LEVEL_WARN 3
+#define PF_LOG_LEVEL_ERROR 4
+#define PF_LOG_LEVEL_OFF 5
+
+#ifndef PF_LOG_LEVEL
+#define PF_LOG_LEVEL PF_LOG_LEVEL_INFO
+#endif
+
+/**
+ * @brief Namespace for diagnostics logging.
+ */
+namespace Logging {
+
+enum class Level { TRACE = PF_LOG_LEVEL_TRACE, DEBUG = PF_LOG_LEVEL_DEBUG,
+                   INFO = PF_LOG_LEVEL_INFO, WARN = PF_LOG_LEVEL_WARN,
+                   ERROR = PF_LOG_LEVEL_ERROR, OFF = PF_LOG_LEVEL_OFF };
+
+/**
+ * @brief lowercase level name, e.g. "warn"
+ */
+const char* levelName(Level level);
+
+constexpr int MAX_FIELDS = 4;
+
+/** One key-value pair attached to a record. */
+struct Field {
+    const char* key;    // must point to a string literal
+    double value;
+};
+
+/** One log statement, copied by value into the ring. */
+struct Record {
+    Level level;
+    uint64_t timestamp_ns;  // nanoseconds since the logger started
+    const char* message;    // must point to a string literal
+    int num_fields;
+    Field fields[MAX_FIELDS];
+};
+
+/**
+ * @brief bounded multi-producer, single-consumer ring of records
+ * @details every slot carries a sequence number, so producers claim slots with a single
+ * compare-and-swap and never wait on each other or on the consumer
+ */
+class LogRing {
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        Record record;
+    };
+
+    std::vector<Slot> m_slots;
+    uint64_t m_mask;
+    std::atomic<uint64_t> m_head{0};
+    uint64_t m_tail = 0;
+
+public:
+    /**
+     * @param[in] capacity: number of slots, rounded up to a power of two
+     */
+    explicit LogRing(size_t capacity);
+
+    /**
+     * @brief enqueue a record, from any thread
+     * @return false if the ring is full and the record was dropped
+     */
+    bool tryPush(const Record& record);
+
+    /**
+     * @brief dequeue the oldest record; only called by the consumer
+     * @return false if the ring is empty
+     */
+    bool tryPop(Record& record);
+
+    size_t capacity() const { return m_slots.size(); }
+};
+
+/**
+ * @brief receives every formatted line on the logging thread
+ */
+using Sink = std::function<void(const std::string& line)>;
+
+/**
+ * @brief replace the sink; the default writes to stderr
+ * @details waits until queued records have reached the previous sink
+ */
+void setSink(Sink sink);
+
+/**
+ * @brief drop records below a runtime level (on top of the compile-time level)
+ */
+void setLevel(Level level);
+
+/**
+ * @brief true if records of this level pass the runtime level
+ * @details does not construct the logger
+ */
+bool isEnabled(Level level);
+
+/**
+ * @brief block until every queued record has been written to the sink
+ */
+void flush();
+
+/**
+ * @brief number of records dropped because the ring was full
+ */
+uint64_t droppedCount();
+
+/**
+ * @brief format a record as a logfmt line
+ */
+std::string format(const Record& record);
+
+/**
+ * @brief enqueue a record; allocates the ring and starts the logging thread on first use
+ */
+void submit(const Record& record);
+
+/**
+ * @brief nanoseconds since the logger started
+ */
+uint64_t nowNs();
+
+inline void addFields(Record&) {}
+
+template<class T, class... Rest>
+inline void addFields(Record& record, const char* key, T value, Rest... rest) {
+    record.fields[record.num_fields++] = {key, static_cast<double>(value)};
+    addFields(record, rest...);
+}
+
+/**
+ * @brief log a message with up to MAX_FIELDS numeric fields passed as key, value pairs
+ */
+template<class... Args>
+inline void log(Level level, const char* message, Args... key_values) {
+    static_assert(sizeof...(Args) % 2 == 0, "fields are passed as key, value pairs");
+    static_assert(sizeof...(Args) / 2 <= MAX_FIELDS, "too many fields");
+    if (!isEnabled(level)) return;
+
+    Record record{level, nowNs(), message, 0, {}};
+    addFields(record, key_values...);
+    submit(record);
+}
+
+}; // namespace Logging
+
+#if PF_LOG_LEVEL <= PF_LOG_LEVEL_TRACE
+#define PF_LOG_TRACE(...) Logging::log(Logging::Level::TRACE, __VA_ARGS__)
+#else
+#define PF_LOG_TRACE(...) (void) 0
+#endif
+
+#if PF_LOG_LEVEL <= PF_LOG_LEVEL_DEBUG
+#define PF_LOG_DEBUG(...) Logging::log(Logging::Level::DEBUG, __VA_ARGS__)
+#else
+#define PF_LOG_DEBUG(...) (void) 0
+#endif
+
+#if PF_LOG_LEVEL <= PF_LOG_LEVEL_INFO
+#define PF_LOG_INFO(...) Logging::log(Logging::Level::INFO, __VA_ARGS__)
+#else
+#define PF_LOG_INFO(...) (void) 0
+#endif
+
+#if PF_LOG_LEVEL <= PF_LOG_LEVEL_WARN
+#define PF_LOG_WARN(...) Logging::log(Logging::Level::WARN, __VA_ARGS__)
+#else
+#define PF_LOG_WARN(...) (void) 0
+#endif
+
+#if PF_LOG_LEVEL <= PF_LOG_LEVEL_ERROR
+#define PF_LOG_ERROR(...) Logging::log(Logging::Level::ERROR, __VA_ARGS__)
+#else
+#define PF_LOG_ERROR(...) (void) 0
+#endif
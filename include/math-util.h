@@ -61,22 +61,66 @@ float sampleNormal( const float aMean, const float aVariance );
 
 /**
  * @brief Generates a random sample from the Uniform [min, max)
+ * @details instantiated for float and double, so that draws against a WeightScalar cdf keep
+ * its precision
  *
  * @param[in] aMin: minimum value of the range
  * @param[in] aMax: maximum value of the range
  *
  * @return Random value, distributed according to the defined Uniform
  */
-float sampleUniform( const float& aMin, const float& aMax );
+template< class T >
+T sampleUniform( const T& aMin, const T& aMax );
+
+/**
+ * @brief Draws a zero-mean sample from a 3D Gaussian
+ * @details uses the Cholesky factor of the covariance, or its eigendecomposition when the
+ * covariance is only positive semi-definite (e.g. noiseless heading)
+ *
+ * @param[in] aCov: 3x3 covariance matrix
+ * @return a sample from N(0, aCov)
+ */
+Eigen::Vector3f sampleMultivariateNormal( const Eigen::Matrix3f& aCov );
+
+/**
+ * @brief Evaluates the density of a zero-mean 2D Gaussian
+ *
+ * @param[in] aResidual: deviation from the mean, e.g. a measurement innovation
+ * @param[in] aCov: 2x2 covariance matrix
+ * @return the density, or 0 if the covariance is singular
+ */
+float gaussianPdf2D( const Eigen::Vector2f& aResidual, const Eigen::Matrix2f& aCov );
+
+/**
+ * @brief Number of samples KLD-sampling needs for a histogram with a given support
+ * @details Fox (2003): with probability 1 - delta, the K-L divergence between the sample
+ * based and the true posterior stays below epsilon when
+ * n >= (k-1)/(2 epsilon) * (1 - 2/(9(k-1)) + sqrt(2/(9(k-1))) z)^3
+ *
+ * @param[in] aNumBins: number of histogram bins holding at least one sample (k)
+ * @param[in] aEpsilon: bound on the K-L divergence
+ * @param[in] aZQuantile: upper 1 - delta quantile of the standard normal
+ * @return required number of samples, 0 when fewer than two bins are occupied
+ */
+unsigned int kldSampleBound( const int aNumBins, const float aEpsilon, const float aZQuantile );
+
+/**
+ * @brief Wraps an angle into [-pi, pi]
+ *
+ * @param[in] aAngle_rad: angle in radians
+ * @return the equivalent angle in [-pi, pi]
+ */
+float wrapAngle( const float aAngle_rad );
 
 /**
  * @brief Finds the distance between two points
+ * @details computed in CoordScalar, the precision of the coordinates
  *
  * @param[in] aPointA: a 2D point
  * @param[in] aPointB: a 2D point
  * @return the absolute distance between two points
  */
-float findDist( const struct Point2D& aPointA, const struct Point2D& aPointB );
+CoordScalar findDist( const struct Point2D& aPointA, const struct Point2D& aPointB );
 
 /**
  * @brief overloaded version of findDist, used specifically for robot and landmark
@@ -85,7 +129,7 @@ float findDist( const struct Point2D& aPointA, const struct Point2D& aPointB );
  * @param[in] aRobPose: robot pose
  * @return distance between landmark and robot
  */
-float findDist( const struct Point2D& aLandMark, const struct Pose2D& aRobPose );
+CoordScalar findDist( const struct Point2D& aLandMark, const struct Pose2D& aRobPose );
 
 /**
  * @brief generate a cumulative cdf table based on pdf weights
@@ -0,0 +1,185 @@
+/**
+ * @file metrics.h
+ * @brief Defines a registry of atomic counters and gauges with Prometheus text exposition
+ *
+ * Metrics are registered once (under a lock) and then updated with relaxed atomics, so
+ * updating never locks or allocates. The registry is written in the Prometheus text format,
+ * either on demand or periodically by a PeriodicWriter, into a file that a local agent
+ * (e.g. the node_exporter textfile collector) can scrape.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Namespace for runtime metrics.
+ */
+namespace Metrics {
+
+/**
+ * @brief monotonically increasing count
+ */
+class Counter {
+
+private:
+    std::atomic<uint64_t> m_value{0};
+
+public:
+    void inc(uint64_t amount = 1) { m_value.fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief value that can go up and down
+ */
+class Gauge {
+
+private:
+    std::atomic<double> m_value{0.0};
+
+public:
+    void set(double value) { m_value.store(value, std::memory_order_relaxed); }
+    double value() const { return m_value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief owns every metric; references handed out stay valid for the registry's lifetime
+ */
+class Registry {
+
+private:
+    enum class Type { COUNTER, GAUGE };
+
+    /** One registered time series. */
+    struct Entry {
+        std::string family;   // metric name without labels
+        std::string labels;   // e.g. outcome="matched", empty if unlabeled
+        std::string help;
+        Type type;
+        Counter* counter;
+        Gauge* gauge;
+    };
+
+    mutable std::mutex m_lock;
+    std::deque<Counter> m_counters;
+    std::deque<Gauge> m_gauges;
+    std::vector<Entry> m_entries;
+
+public:
+    /**
+     * @brief register a counter, or return the existing one with the same name and labels
+     *
+     * @param[in] name: metric name, e.g. "fastslam_frames_total"
+     * @param[in] help: one-line description written as # HELP
+     * @param[in] labels: label pairs without braces, e.g. "outcome=\"new\""
+     */
+    Counter& counter(const std::string& name, const std::string& help,
+                     const std::string& labels = "");
+
+    /**
+     * @brief register a gauge, or return the existing one with the same name and labels
+     *
+     * @param[in] name: metric name, e.g. "fastslam_effective_particles"
+     * @param[in] help: one-line description written as # HELP
+     * @param[in] labels: label pairs without braces
+     */
+    Gauge& gauge(const std::string& name, const std::string& help,
+                 const std::string& labels = "");
+
+    /**
+     * @brief write every metric in the Prometheus text exposition format
+     */
+    void writePrometheus(std::ostream& out) const;
+
+    /**
+     * @brief write the exposition to a file, atomically replacing the previous one
+     *
+     * @param[in] path: output file; a temporary file next to it is renamed over it
+     * @return true if the file was written
+     */
+    bool writePrometheusFile(const std::string& path) const;
+};
+
+/**
+ * @brief background thread rewriting the exposition file at a fixed interval
+ * @details the file is also written once more when the writer stops
+ */
+class PeriodicWriter {
+
+private:
+    const Registry& m_registry;
+    std::string m_path;
+    std::chrono::milliseconds m_interval;
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+    std::thread m_thread;
+
+    void run();
+
+public:
+    PeriodicWriter(const Registry& registry, const std::string& path,
+                   std::chrono::milliseconds interval);
+
+    ~PeriodicWriter() { stop(); }
+
+    /**
+     * @brief write a final snapshot and join the thread; safe to call twice
+     */
+    void stop();
+
+    PeriodicWriter(const PeriodicWriter&) = delete;
+    PeriodicWriter& operator=(const PeriodicWriter&) = delete;
+};
+
+/**
+ * @brief the health and throughput metrics published by FastSLAMPF
+ * @details rates such as frames/s are derived by the scraper, e.g.
+ * rate(fastslam_frames_total[1m])
+ */
+struct FilterMetrics {
+    Counter& frames;
+    Counter& observations;
+    Counter& update_seconds_us;
+    Counter& resamples;
+    Counter& assoc_matched;
+    Counter& assoc_new;
+    Counter& assoc_rejected;
+    Counter& assoc_tentative;
+    Counter& matrix_inversion_failures;
+    Gauge& landmarks_min;
+    Gauge& landmarks_mean;
+    Gauge& landmarks_max;
+    Gauge& effective_particles;
+    Gauge& particles;
+    Counter& budget_hold;
+    Counter& budget_shrink_particles;
+    Counter& budget_grow_particles;
+    Counter& budget_shed_observations;
+    Counter& budget_restore_observations;
+    Counter& deadline_overruns;
+    Counter& observations_shed;
+    Gauge& frame_cost_us;
+    Gauge& particle_budget;
+    Gauge& observation_cap;
+
+    /**
+     * @brief register the filter metrics
+     *
+     * @param[in] registry: registry owning the metrics
+     * @param[in] labels: constant labels for every series, e.g. "robot=\"r1\""
+     */
+    explicit FilterMetrics(Registry& registry, const std::string& labels = "");
+};
+
+}; // namespace Metrics
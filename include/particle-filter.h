@@ -3,19 +3,72 @@
  * @brief defines the particle filter class, including re-sampling methods
  */
 
+#pragma once
+
+#include "budget-controller.h"
+#include "consensus-map.h"
 #include "core-structs.h"
 #include "math-util.h"
 #include "EKF.h"
-#include <unordered_map>
+#include "metrics.h"
+#include "profiler.h"
+#include "landmark-staging.h"
+#include "prior-map.h"
+#include "submap.h"
+#include "worker-pool.h"
+#include <chrono>
+#include <memory>
 #include <queue>
 #include <vector>
 
 enum class PF_RET{ SUCCESS = 0, EMPTY_ROBOT_MANAGER = -1, MATRIX_INVERSION_ERROR = -2, UPDATE_ERROR = -3 };
+enum class PF_ASSOC{ MATCHED = 0, NEW_LANDMARK = 1, REJECTED = 2, TENTATIVE = 3 };
+enum class PF_PROPOSAL{ MOTION = 0, OBSERVATION = 1 };
+constexpr int LABEL_NEW_LANDMARK = -1;
+constexpr int LABEL_REJECTED = -2;
+constexpr int LABEL_TENTATIVE = -3;
+constexpr int LABEL_INVALID = -4;       // sighting with a non-positive or non-finite range
 constexpr unsigned int DEFAULT_NUM_PARTICLE = 50;
 constexpr float DEFAULT_IMPORTANCE_FACTOR = 0.5;
 
+/**
+ * @brief log weight of a failed update, about log(1e-30); the floor of every log weight
+ */
+constexpr float MIN_LOG_LIKELIHOOD = -69.0f;
+
+/**
+ * @brief KLD-sampling settings (Fox, 2003): the particle count adapts to the posterior spread
+ */
+struct KLDConfig {
+    unsigned int min_particles = 10;   // lower bound on the particle count
+    unsigned int max_particles = 500;  // upper bound on the particle count
+    float bin_size_m = 0.2f;           // x and y histogram bin width
+    float bin_size_rad = 0.1f;         // heading histogram bin width
+    float epsilon = 0.05f;             // bound on the K-L divergence
+    float z_quantile = 2.326f;         // upper 1 - delta normal quantile, 2.326 for delta = 0.01
+};
+
+/**
+ * @brief one frame of one robot of a fleet, see FastSLAMPF::updateFleet
+ */
+struct RobotFrame {
+    unsigned int robot_id;                          // id returned by addRobot, 0 for the first
+    struct Pose2D pose_mean;                        // odometry mean of that robot
+    std::vector<struct Observation2D> observations; // landmark sightings of that robot
+};
+
+/**
+ * @brief chi-square gate (2 dof, 99%) for matching landmarks of merged maps
+ */
+constexpr float DEFAULT_MERGE_GATE = 9.21f;
+
 class FastSLAMParticles {
 
+    /**
+     * @brief test and benchmark accessor to the private kernels, defined in fastslam-bench.h
+     */
+    friend class FastSLAMBench;
+
 private:
     /**
      * @brief starting importance factor for determining new lm sightings
@@ -34,9 +87,77 @@ private:
     int m_data_label;
 
     /**
-     * @brief collection of all landmark EKFs
+     * @brief outcome of the latest data association, reported to the filter metrics
+     */
+    PF_ASSOC m_last_assoc = PF_ASSOC::NEW_LANDMARK;
+
+    /**
+     * @brief status of the latest landmark belief update
+     */
+    PF_RET m_last_update_status = PF_RET::SUCCESS;
+
+    /**
+     * @brief collection of all landmark EKFs and their sighting counts
+     * @details held by value so that resampling copies into existing storage
+     * instead of allocating one EKF per landmark per particle
+     */
+    std::vector<std::pair<LMEKF2D, int>> m_lmekf_bank;
+
+    /**
+     * @brief landmark uids, parallel to m_lmekf_bank
+     * @details the filter hands out uids in increasing order and landmarks are only ever
+     * appended, so the vector stays sorted
+     */
+    std::vector<uint32_t> m_lm_uids;
+
+    /**
+     * @brief landmarks of the regions outside the active window, in submap mode
+     * @details immutable and shared with the resampled copies of this particle
+     */
+    std::vector<std::shared_ptr<const FrozenSubmap>> m_frozen_submaps;
+
+    /**
+     * @brief poses of the robots added after the first one; robot r is at index r - 1
+     * @details all robots of a particle share its landmark bank
+     */
+    std::vector<struct Pose2D> m_fleet_poses;
+
+    /**
+     * @brief covariance form of the landmark EKF updates, copied with the particle
+     */
+    KF_COV_FORM m_cov_form = KF_COV_FORM::SIMPLE;
+
+    /**
+     * @brief fuse the matched observations of a frame per landmark in information form
+     */
+    bool m_info_fusion = false;
+
+    /**
+     * @brief landmarks matched in the frame being fused, in order of first sighting, with
+     * the information they accumulated
+     * @details scratch of fuseFrameInformation, emptied after each frame so that copying the
+     * particle copies nothing while the capacity stays with the copy target
+     */
+    std::vector<std::pair<int, struct LMInformation>> m_fusion_info;
+
+    /**
+     * @brief converged landmarks thawed by the frame being fused, scratch like m_fusion_info
+     */
+    std::vector<int> m_fusion_thawed;
+
+    /**
+     * @brief convergence policy of the landmarks, only used when m_convergence_enabled is set
+     */
+    struct ConvergenceConfig m_convergence;
+
+    bool m_convergence_enabled = false;
+
+    /**
+     * @brief convergence policy passed to the landmark updates, nullptr when disabled
      */
-    std::vector<std::pair<std::unique_ptr<LMEKF2D>, int>> m_lmekf_bank;
+    const struct ConvergenceConfig* convergencePolicy() const {
+        return m_convergence_enabled ? &m_convergence : nullptr;
+    }
 
     /**
      * @brief shared ptr to robot manager instance,
@@ -55,16 +176,82 @@ private:
 
     /**
      * @brief update specific landmark belief given new measurement
+     * @details follows matchLandmark, whose association terms the matched landmark reuses
      *
      * @param[in] curr_obs: current robot observation
+     * @param[in] new_uid: uid given to the landmark if the observation starts one
+     * @param[in] stage_new: leave an unmatched observation to the filter's staging list
      */
-    PF_RET updateLMBelief(const struct Observation2D& curr_obs);
+    PF_RET updateLMBelief(const struct Observation2D& curr_obs, uint32_t new_uid,
+                          bool stage_new);
+
+    /**
+     * @brief start landmarks from a batch of observations, in closed form
+     * @details inverts the range-bearing model analytically: the mean is the sighting
+     * projected from robot_pose, the covariance is J R J^T with J the jacobian of that
+     * projection. Landmarks are constructed in place in the bank. A sighting with a
+     * non-positive or non-finite range has no bearing to invert; it starts nothing and is
+     * labelled LABEL_INVALID
+     *
+     * @param[in] robot_pose: pose the observations were taken from
+     * @param[in] robot: robot manager of the observing robot
+     * @param[in] obs: observations of the batch
+     * @param[in,out] labels: per observation; those labelled LABEL_NEW_LANDMARK are started
+     * @param[in] count: number of observations
+     * @param[in] first_uid: observation j starts landmark first_uid + j
+     * @return number of landmarks started
+     */
+    int initLandmarks(const struct Pose2D& robot_pose,
+                      const std::shared_ptr<RobotManager2D>& robot,
+                      const struct Observation2D* obs, int* labels, int count,
+                      uint32_t first_uid);
 
     /**
      * @brief update local copy of current robot pose
      */
     PF_RET updatePose(const struct Pose2D& new_pose);
 
+    /**
+     * @brief FastSLAM 2.0 kernel shared by all robots of the particle
+     *
+     * @param[in,out] robot_pose: pose slot of the observing robot, resampled from the proposal
+     * @param[in] robot: robot manager of the observing robot
+     * @see updateParticleProposal for the other parameters
+     */
+    float proposalUpdate(struct Pose2D& robot_pose,
+                         const std::shared_ptr<RobotManager2D>& robot,
+                         const std::vector<struct Observation2D>& frame_obs,
+                         const struct Pose2D& pose_mean,
+                         const Eigen::Matrix3f& pose_cov,
+                         std::vector<int>& labels,
+                         uint32_t first_uid,
+                         bool stage_new);
+
+    /**
+     * @brief update every matched landmark of a frame once, in information form
+     * @details labels of landmarks whose update fails are set to LABEL_REJECTED
+     *
+     * @param[in] robot_pose: pose of the observing robot
+     * @param[in] robot: robot manager of the observing robot
+     * @param[in] noise_inv: inverse of the robot's measurement covariance
+     * @param[in] frame_obs: observations of the frame
+     * @param[in,out] labels: association label of each observation
+     */
+    void fuseFrameInformation(const struct Pose2D& robot_pose, RobotManager2D& robot,
+                              const Eigen::Matrix2f& noise_inv,
+                              const std::vector<struct Observation2D>& frame_obs,
+                              std::vector<int>& labels);
+
+    /**
+     * @brief move the landmarks of a frozen submap back into the landmark bank
+     */
+    void thawSubmap(const struct FrozenSubmap& submap);
+
+    /**
+     * @brief restore the uid order of the landmark bank after thawing
+     */
+    void sortBankByUid();
+
 
 #ifdef LM_CLEANUP
     /**
@@ -93,53 +280,517 @@ public:
      *
      * @param[in] part: particle to copy from
      */
-    FastSLAMParticles(const FastSLAMParticles& part);
+    FastSLAMParticles(const FastSLAMParticles& part) = default;
+
+    /**
+     * @brief copy assignment, reuses the landmark storage of the target particle
+     *
+     * @param[in] part: particle to copy from
+     */
+    FastSLAMParticles& operator=(const FastSLAMParticles& part) = default;
 
     /**
      * @brief check for the total number of tracked landmakrs
      * @return current number of tracked landmarks */
     int getNumLandMark() const { return m_lmekf_bank.size(); };
 
+    /**
+     * @brief number of landmarks frozen in submaps, not counted by getNumLandMark
+     */
+    int getNumFrozenLandMark() const;
+
+    /**
+     * @brief estimate of a landmark by uid, whether active or frozen
+     * @details active landmarks are found by binary search, frozen ones by a scan of the
+     * submaps
+     *
+     * @param[in] uid: landmark uid
+     * @param[out] mean: landmark mean
+     * @param[out] cov: landmark covariance
+     * @return false if the particle holds no landmark with this uid
+     */
+    bool getLandmarkEstimate(uint32_t uid, struct Point2D& mean, Eigen::Matrix2f& cov) const;
+
+    /**
+     * @brief frozen submaps, one per inactive region holding landmarks
+     */
+    const std::vector<std::shared_ptr<const FrozenSubmap>>& getFrozenSubmaps() const {
+        return m_frozen_submaps;
+    }
+
+    /**
+     * @brief keep only the landmarks of the regions around (center_ix, center_iy) active
+     * @details landmarks outside the window are frozen by region, frozen regions inside the
+     * window are thawed back into the landmark bank
+     *
+     * @param[in] center_ix: region index of the robot along x
+     * @param[in] center_iy: region index of the robot along y
+     * @param[in] config: region size and window radius
+     */
+    void updateActiveRegion(int32_t center_ix, int32_t center_iy,
+                            const struct SubmapConfig& config);
+
+    /**
+     * @brief thaw every frozen submap
+     */
+    void thawAll();
+
+    /**
+     * @brief landmark EKF at a bank index
+     */
+    const LMEKF2D& getLandmark(int idx) const { return m_lmekf_bank[idx].first; }
+
+    /**
+     * @brief uid of the landmark at a bank index
+     */
+    uint32_t getLandmarkUid(int idx) const { return m_lm_uids[idx]; }
+
+    /**
+     * @brief bank index of a landmark
+     * @return index, -1 if the particle does not hold the landmark
+     */
+    int findLandmark(uint32_t uid) const;
+
+    /**
+     * @brief uid of the landmark matched or started by the latest update
+     * @return LM_UID_NONE if the update did not get that far
+     */
+    uint32_t getLastLandmarkUid() const {
+        return m_data_label >= 0 && m_data_label < m_lm_uids.size() ? m_lm_uids[m_data_label]
+                                                                     : LM_UID_NONE;
+    }
+
+    /**
+     * @brief robot pose hypothesis carried by this particle
+     * @return pose sampled during the latest update
+     */
+    const struct Pose2D& getPose() const { return m_robot_pose; }
+
+    /**
+     * @brief outcome of the latest data association
+     * @return MATCHED if an existing landmark was updated, NEW_LANDMARK if one was created,
+     * REJECTED if the matched landmark could not be updated
+     */
+    PF_ASSOC getLastAssociation() const { return m_last_assoc; }
+
+    /**
+     * @brief status of the latest landmark belief update
+     */
+    PF_RET getLastUpdateStatus() const { return m_last_update_status; }
+
     /**
      * @brief class template method, runs landmark data association and belief update
      *
      * @param[in] new_obs: new robot landmark observation, unclassified
      * @param[in] new_pose: new robot pose estimate
+     * @param[in] new_uid: uid given to the landmark if the observation starts one
+     * @param[in] stage_new: if the observation matches no landmark, start none; the last
+     * association is then TENTATIVE and the importance factor is the new-landmark one
      * @return maximum importance factor for resampling
      */
     float updateParticle(const struct Observation2D& new_obs,
-                         const struct Pose2D& new_pose);
+                         const struct Pose2D& new_pose,
+                         uint32_t new_uid = LM_UID_NONE,
+                         bool stage_new = false);
+
+    /**
+     * @brief FastSLAM 2.0 update: samples the pose from a proposal conditioned on the
+     * observations, then updates the landmarks from that pose
+     * @details every observation is associated against the landmarks from the proposal mean;
+     * matched observations refine the proposal Gaussian through the pose jacobian. The pose
+     * is sampled once from the refined proposal, and matched landmarks are corrected (new
+     * ones initialized) using it
+     *
+     * @param[in] frame_obs: all observations of the frame
+     * @param[in] pose_mean: motion model mean, e.g. from odometry
+     * @param[in] pose_cov: motion model covariance
+     * @param[out] labels: per observation, the matched landmark index,
+     * LABEL_NEW_LANDMARK, LABEL_REJECTED (update failed to invert), LABEL_INVALID or
+     * LABEL_TENTATIVE
+     * @param[in] first_uid: uid of a landmark started by the first observation; observation
+     * j starts landmark first_uid + j
+     * @param[in] stage_new: start no landmarks; unmatched observations are labelled
+     * LABEL_TENTATIVE for the filter's staging list
+     * @return log importance factor, summed over the observations; MIN_LOG_LIKELIHOOD
+     * without a robot manager
+     */
+    float updateParticleProposal(const std::vector<struct Observation2D>& frame_obs,
+                                 const struct Pose2D& pose_mean,
+                                 const Eigen::Matrix3f& pose_cov,
+                                 std::vector<int>& labels,
+                                 uint32_t first_uid = LM_UID_NONE,
+                                 bool stage_new = false);
+
+    /**
+     * @brief FastSLAM 2.0 update for one robot of a fleet
+     * @details same as updateParticleProposal, with the pose slot and sensor model of the
+     * given robot; every robot updates the same landmark bank
+     *
+     * @param[in] robot_id: 0 for the robot the particle was built with, r for the r-th
+     * pose added with addRobotPose
+     * @param[in] robot: robot manager of that robot
+     * @see updateParticleProposal for the other parameters
+     */
+    float updateRobotProposal(unsigned int robot_id,
+                              const std::shared_ptr<RobotManager2D>& robot,
+                              const std::vector<struct Observation2D>& frame_obs,
+                              const struct Pose2D& pose_mean,
+                              const Eigen::Matrix3f& pose_cov,
+                              std::vector<int>& labels,
+                              uint32_t first_uid = LM_UID_NONE);
+
+    /**
+     * @brief localization-only update against a fixed map shared by all particles
+     * @details the particle takes new_pose and is weighted by associating every observation,
+     * by maximum likelihood, with the prior landmarks near where it lands; the map is not
+     * changed. An observation that matches nothing contributes the importance factor
+     *
+     * @param[in] frame_obs: all observations of the frame
+     * @param[in] new_pose: sampled robot pose
+     * @param[in] map: prior map
+     * @param[in] config: search radius of the association
+     * @param[out] num_matched: observations associated with a prior landmark
+     * @return log importance factor, summed over the observations; MIN_LOG_LIKELIHOOD
+     * without a robot manager
+     */
+    float localizeParticle(const std::vector<struct Observation2D>& frame_obs,
+                           const struct Pose2D& new_pose,
+                           const PriorMap& map,
+                           const struct LocalizationConfig& config,
+                           int& num_matched);
+
+    /**
+     * @brief drop every landmark of the particle, active and frozen
+     */
+    void clearLandmarks();
+
+    /**
+     * @brief add the pose slot of another robot sharing this particle's map
+     */
+    void addRobotPose(const struct Pose2D& starting_pose);
+
+    /**
+     * @brief number of robots tracked by the particle, at least 1
+     */
+    unsigned int getNumRobots() const { return m_fleet_poses.size() + 1; }
+
+    /**
+     * @brief select the covariance form of this particle's landmark EKF updates
+     */
+    void setCovarianceForm(KF_COV_FORM form) { m_cov_form = form; }
+
+    KF_COV_FORM getCovarianceForm() const { return m_cov_form; }
+
+    /**
+     * @brief fuse repeated observations of a landmark within a frame in information form
+     */
+    void setInformationFusion(bool enabled) { m_info_fusion = enabled; }
+
+    bool getInformationFusion() const { return m_info_fusion; }
+
+    /**
+     * @brief let converged landmarks skip their EKF corrections, see ConvergenceConfig
+     */
+    void enableConvergence(const struct ConvergenceConfig& config) {
+        m_convergence = config;
+        m_convergence_enabled = true;
+    }
+
+    /**
+     * @brief correct every landmark on every sighting again
+     */
+    void disableConvergence() { m_convergence_enabled = false; }
+
+    /**
+     * @brief number of landmarks in the bank that currently skip their corrections
+     */
+    int getNumConvergedLandMark() const;
+
+    /**
+     * @brief start a landmark promoted from the staging list
+     * @details the landmark is placed from this particle's current pose
+     *
+     * @param[in] obs: promoting observation
+     * @param[in] uid: landmark uid, larger than every uid of the particle
+     * @return false if the observation is degenerate
+     */
+    bool promoteLandmark(const struct Observation2D& obs, uint32_t uid);
+
+    /**
+     * @brief pose hypothesis of one robot
+     * @return pose of robot_id, the first robot's pose if robot_id is unknown
+     */
+    const struct Pose2D& getRobotPose(unsigned int robot_id) const;
+
+    /**
+     * @brief fuse an independent estimate into the landmark with this uid
+     * @return false if the particle does not hold the landmark actively
+     */
+    bool fuseLandmark(uint32_t uid, const struct Point2D& mean, const Eigen::Matrix2f& cov,
+                      int sightings);
+
+    /**
+     * @brief append a landmark, e.g. from a merged map
+     * @details uid must be larger than every uid of the particle
+     */
+    void appendLandmark(uint32_t uid, const struct Point2D& mean, const Eigen::Matrix2f& cov,
+                        int sightings);
 
      /**
      * @brief finds the coordinates of all the landmarks assosciated with a particle
+     * @details includes the landmarks frozen in submaps
      * @return queue of all the landmark coordinates 
      */
     const std::vector<struct Point2D> getLandmarkCoordinates() const;
 };
 
 class FastSLAMPF {
+
+    /**
+     * @brief test and benchmark accessor to the private kernels, defined in fastslam-bench.h
+     */
+    friend class FastSLAMBench;
+
 private:
 
     /**
-     * @brief key-value pairs of index and particles
+     * @brief particles, indexed the same way as the weights
+     */
+    std::vector<FastSLAMParticles> m_particle_set;
+
+    /**
+     * @brief resampling target, swapped with the particle set after every resample
+     * @details kept across updates so that steady-state resampling does not allocate
+     */
+    std::vector<FastSLAMParticles> m_aux_particle_set;
+
+    /**
+     * @brief cdf of the particle weights, reused across resamples
      */
-    std::unordered_map<int, std::unique_ptr<FastSLAMParticles>> m_particle_set;
+    std::vector<WeightScalar> m_cdf_table;
 
     /**
-     * @brief importance factors associated with particles
+     * @brief normalized importance weights, summing to one; uniform right after a resample
      */
-    std::vector<float> m_particle_weights;
+    std::vector<WeightScalar> m_particle_weights;
+
+    /**
+     * @brief log importance weights accumulated since the last resample, shifted so that
+     * the best particle is at 0 after every normalization
+     */
+    std::vector<WeightScalar> m_log_weights;
+
+    /**
+     * @brief index of the highest-weight particle, kept up to date by every weight update
+     */
+    int m_best_idx = 0;
+
+    /**
+     * @brief resample when the effective sample size drops below this fraction of the set
+     */
+    float m_resample_threshold = 1.0f;
 
     /**
      * @brief point to robot manager
      */
     std::shared_ptr<RobotManager2D> m_robot;
 
+    /**
+     * @brief robot managers of the fleet, indexed by robot id; m_fleet[0] is m_robot
+     */
+    std::vector<std::shared_ptr<RobotManager2D>> m_fleet;
+
     /**
      * @brief number of particles in the filter
      */
     unsigned int m_num_particles;
 
+    /**
+     * @brief KLD-sampling settings, only used when m_kld_enabled is set
+     */
+    struct KLDConfig m_kld_config;
+
+    bool m_kld_enabled = false;
+
+    /**
+     * @brief open-addressing set of the pose bins occupied during KLD resampling, 0 is empty
+     */
+    std::vector<uint64_t> m_kld_bins;
+
+    /**
+     * @brief per-frame time budget, only used when m_budget_enabled is set
+     */
+    BudgetController m_budget;
+
+    bool m_budget_enabled = false;
+
+    /**
+     * @brief particles allowed by the budget controller, caps KLD-sampling as well
+     */
+    unsigned int m_particle_budget = UINT_MAX;
+
+    struct BudgetDecision m_last_budget_decision;
+
+#ifdef PF_PROFILING
+    /**
+     * @brief per-stage timing histograms
+     */
+    Profiler::StageProfile m_stage_profile;
+
+    /**
+     * @brief per-worker timing histograms of updateFleet, merged into m_stage_profile
+     * @details histograms are not thread-safe, so every worker records into its own
+     */
+    std::vector<Profiler::StageProfile> m_worker_profiles;
+#endif // PF_PROFILING
+
+    /**
+     * @brief pose proposal, motion model only (FastSLAM 1.0) or observation-conditioned (2.0)
+     */
+    PF_PROPOSAL m_proposal = PF_PROPOSAL::MOTION;
+
+    /**
+     * @brief covariance form of the landmark EKF updates
+     */
+    KF_COV_FORM m_cov_form = KF_COV_FORM::SIMPLE;
+
+    /**
+     * @brief information-form fusion of repeated observations within a frame
+     */
+    bool m_info_fusion = false;
+
+    /**
+     * @brief observations of the current frame, reused across updates
+     */
+    std::vector<struct Observation2D> m_frame_obs;
+
+    /**
+     * @brief per-observation association labels of the particle being updated
+     */
+    std::vector<int> m_frame_labels;
+
+    /**
+     * @brief tentative landmarks, only used when m_staging_enabled is set
+     */
+    LandmarkStaging m_staging;
+
+    bool m_staging_enabled = false;
+
+    /**
+     * @brief per particle (and observation, in the observation proposal), set when the
+     * observation was staged instead of starting a landmark
+     */
+    std::vector<uint8_t> m_frame_staged;
+
+    /**
+     * @brief submap settings, only used when m_submaps_enabled is set
+     */
+    struct SubmapConfig m_submap_config;
+
+    bool m_submaps_enabled = false;
+
+    /**
+     * @brief region the active window is centered on; unset until the first frame
+     */
+    int64_t m_active_region_key = 0;
+
+    bool m_has_active_region = false;
+
+    /**
+     * @brief uid of the first observation of the next frame; observation j of a frame
+     * starts landmark m_next_uid + j
+     */
+    uint32_t m_next_uid = 0;
+
+    /**
+     * @brief weight-averaged map, refreshed on query
+     */
+    mutable ConsensusMap m_consensus;
+
+    /**
+     * @brief threads of updateFleet, kept across frames
+     */
+    WorkerPool m_workers;
+
+    /**
+     * @brief fixed map of localization mode, nullptr while mapping
+     */
+    std::shared_ptr<const PriorMap> m_prior_map;
+
+    struct LocalizationConfig m_localization_config;
+
+    /**
+     * @brief health and throughput metrics, not owned; nullptr when not attached
+     */
+    Metrics::FilterMetrics* m_metrics = nullptr;
+
+    /**
+     * @brief publish the particle-set statistics of the current frame
+     * @details effective sample size and landmarks per particle, computed before resampling
+     */
+    void publishMetrics();
+
+    /**
+     * @brief turn the log weights into normalized weights
+     * @details log-sum-exp around the tracked best particle, so large likelihood ratios
+     * neither overflow nor underflow
+     */
+    void normalizeWeights();
+
+    /**
+     * @brief uniform weights after a resample
+     *
+     * @param[in] best_idx: index of the particle that continues the previous best one
+     */
+    void resetWeights(int best_idx);
+
+    /**
+     * @brief effective sample size of the current weights, (sum w)^2 / sum w^2
+     */
+    double effectiveParticles() const;
+
+    /**
+     * @brief record a staged observation and start its landmark if it gets promoted
+     * @details the particles that staged the observation are those with
+     * m_frame_staged[i * stride + offset] set
+     *
+     * @param[in] obs: observation staged by at least one particle, or by none
+     * @param[in] uid: uid of a landmark started by the observation
+     * @param[in] pose_mean: pose the tentative landmark is placed from
+     * @param[in] stride: flags per particle in m_frame_staged
+     * @param[in] offset: flag of the observation within a particle's flags
+     * @return number of particles that started the landmark
+     */
+    unsigned int promoteStaged(const struct Observation2D& obs, uint32_t uid,
+                               const struct Pose2D& pose_mean, size_t stride, size_t offset);
+
+    /**
+     * @brief re-center the active submap window on the robot when it changes region
+     */
+    void updateActiveRegion(const struct Pose2D& robot_pose);
+
+    /**
+     * @brief move the observations of a frame into m_frame_obs, for the modes that
+     * update every particle with the whole frame
+     * @details stops at obs_cap and, under a budget, once taking one more observation at
+     * the per-observation cost of past frames would finish past the deadline; at least
+     * min_obs observations are taken
+     */
+    void gatherFrame(std::queue<struct Observation2D>& sightings, unsigned int obs_cap,
+                     unsigned int min_obs, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief resample if forced by KLD-sampling or the particle budget, or when the effective
+     * sample size is below the threshold
+     * @return true if the particles were resampled
+     */
+    bool resampleIfNeeded(double effective_particles);
+
+    /**
+     * @brief feed the frame cost to the budget controller and apply its decision
+     */
+    void applyBudget(const struct FrameCost& cost);
+
     /**
      * @brief sample robot pose; this function is probabilistic
      * @details credit: https://stackoverflow.com/questions/6142576
@@ -155,6 +806,18 @@ private:
      */
     void reSampleParticles();
 
+    /**
+     * @brief resample with replacement until the KLD bound of the occupied pose bins is met
+     * @details the resampled set gets uniform weights since its size may change
+     */
+    void reSampleParticlesKLD();
+
+    /**
+     * @brief mark the pose bin of a particle as occupied
+     * @return true if the bin was empty
+     */
+    bool insertKLDBin(const struct Pose2D& pose);
+
 public:
 
     FastSLAMPF() = delete;
@@ -194,11 +857,39 @@ public:
 
     /**
      * @brief extract filter estimate on robot pose and landmark position
+     * @details O(1), the highest-weight particle is tracked while the weights are updated.
+     * After a resample it is the first copy of the previous best particle
      *
-     * @return a copied instance of the particle that reflect the SLAM estimations
-     * the returned pointer is not the internal state, but rather a copy of the internal state
+     * @return view of the highest-weight particle, valid until the next updateFilter call
      */
-     std::unique_ptr<FastSLAMParticles> returnEst();
+    const FastSLAMParticles& returnEst() const { return m_particle_set[m_best_idx]; }
+
+    /**
+     * @brief index of the highest-weight particle
+     */
+    int getBestParticleIndex() const { return m_best_idx; }
+
+    /**
+     * @brief normalized importance weights, indexed like the particles
+     */
+    const std::vector<WeightScalar>& getWeights() const { return m_particle_weights; }
+
+    /**
+     * @brief one particle, indexed like the weights
+     *
+     * @param[in] idx: particle index in [0, getWeights().size())
+     * @return view of the particle, valid until the next updateFilter call
+     */
+    const FastSLAMParticles& getParticle(int idx) const { return m_particle_set[idx]; }
+
+    /**
+     * @brief resample only when the effective sample size drops below a fraction of the set
+     * @details between resamples the weights keep accumulating; 1 (default) resamples on
+     * every update. KLD-sampling and particle budget changes always resample
+     *
+     * @param[in] ratio: fraction of the particle count in (0, 1]
+     */
+    void setResampleThreshold(float ratio) { m_resample_threshold = ratio; }
 
     /**
      * @brief draw one particle (with replacement) based on the random generated sample
@@ -208,7 +899,250 @@ public:
      * @param[in] cdf_vec: cdf vector containing cumulative sum of all weights
      * @param[in] sample: randomly-generated number in range of the cdf table
      */
-    int drawWithReplacement(const std::vector<float>& cdf_vec, float sample)const;
+    int drawWithReplacement(const std::vector<WeightScalar>& cdf_vec, WeightScalar sample)const;
+
+#ifdef PF_PROFILING
+    /**
+     * @brief per-stage timing histograms accumulated over all updateFilter calls
+     * @details only available when the library is built with PF_PROFILING
+     *
+     * @return histograms of pose sampling, association, EKF update, weighting, resampling
+     * and of whole updateFilter calls
+     */
+    const Profiler::StageProfile& getStageProfile() const { return m_stage_profile; }
+
+    /**
+     * @brief clear the per-stage timing histograms
+     */
+    void resetStageProfile() { m_stage_profile.reset(); }
+#endif // PF_PROFILING
+
+    /**
+     * @brief adapt the particle count at every resample with KLD-sampling
+     * @details the count moves within [min_particles, max_particles]; storage for
+     * max_particles is reserved up front
+     *
+     * @param[in] config: bounds, bin sizes and K-L error bound
+     */
+    void enableKLDSampling(const struct KLDConfig& config);
+
+    /**
+     * @brief return to a fixed particle count, keeping the current one
+     */
+    void disableKLDSampling() { m_kld_enabled = false; }
+
+    /**
+     * @brief keep every updateFilter call within a time budget
+     * @details the particle count and the observations processed per frame are adjusted
+     * between frames (see BudgetController). Within a frame, the remaining observations are
+     * dropped once the next one, at the average cost so far, would finish past the deadline,
+     * as long as min_observations were processed. The OBSERVATION proposal and localization
+     * mode gather the frame before updating, so they take the observations that fit at the
+     * per-observation cost of past frames. Storage for max_particles is reserved up front
+     *
+     * @param[in] config: deadline, particle and observation floors, smoothing and hysteresis
+     */
+    void enableBudget(const struct BudgetConfig& config);
+
+    /**
+     * @brief stop adapting to the time budget, keeping the current particle count
+     */
+    void disableBudget();
+
+    /**
+     * @brief decision taken by the budget controller after the latest frame
+     */
+    const struct BudgetDecision& getLastBudgetDecision() const { return m_last_budget_decision; }
+
+    /**
+     * @brief current number of particles
+     */
+    unsigned int getNumParticles() const { return m_num_particles; }
+
+    /**
+     * @brief select the pose proposal used by updateFilter
+     * @details OBSERVATION (FastSLAM 2.0) needs far fewer particles when odometry is noisy
+     * relative to the landmark sensor
+     *
+     * @param[in] proposal: MOTION (FastSLAM 1.0, default) or OBSERVATION (FastSLAM 2.0)
+     */
+    void setProposal(PF_PROPOSAL proposal);
+
+    PF_PROPOSAL getProposal() const { return m_proposal; }
+
+    /**
+     * @brief select how the landmark EKFs update their covariance
+     * @details JOSEPH and SQUARE_ROOT keep float covariances symmetric and positive definite
+     * over long runs of precise measurements, at a higher cost per update
+     *
+     * @param[in] form: SIMPLE (default), JOSEPH or SQUARE_ROOT
+     */
+    void setCovarianceForm(KF_COV_FORM form);
+
+    KF_COV_FORM getCovarianceForm() const { return m_cov_form; }
+
+    /**
+     * @brief fuse the observations a landmark receives within one frame in information form
+     * @details the matched observations of each landmark are added up and inverted once,
+     * instead of one EKF update and inversion per observation. Applies to the OBSERVATION
+     * proposal and updateFleet, which associate the whole frame before updating. The MOTION
+     * proposal samples a pose per observation and keeps sequential updates in updateFilter;
+     * enabling fusion with it logs a warning
+     *
+     * @param[in] enabled: true for information-form fusion, false (default) for
+     * sequential updates
+     */
+    void setInformationFusion(bool enabled);
+
+    bool getInformationFusion() const { return m_info_fusion; }
+
+    /**
+     * @brief stop correcting landmarks whose covariance converged
+     * @details a converged landmark still takes part in association and weighting, but its
+     * sightings skip the EKF correction until one of them is inconsistent with it (see
+     * ConvergenceConfig). Saves most of the update cost of long-lived maps
+     *
+     * @param[in] config: covariance trace threshold and thaw gate
+     */
+    void enableConvergence(const struct ConvergenceConfig& config);
+
+    /**
+     * @brief correct every landmark on every sighting again
+     */
+    void disableConvergence();
+
+    /**
+     * @brief publish health and throughput metrics on every updateFilter call
+     * @details the metrics must outlive the filter or be detached by passing nullptr
+     *
+     * @param[in] metrics: metrics registered in a Metrics::Registry, nullptr to detach
+     */
+    void attachMetrics(Metrics::FilterMetrics* metrics) { m_metrics = metrics; }
+
+    /**
+     * @brief restrict association and update to the landmarks near the robot
+     * @details the window follows the pose passed to updateFilter and moves when that pose
+     * enters another region; landmarks outside it are frozen per particle (see submap.h)
+     *
+     * @param[in] config: region size and window radius
+     */
+    void enableSubmaps(const struct SubmapConfig& config);
+
+    /**
+     * @brief thaw every submap and return to a single landmark bank
+     */
+    void disableSubmaps();
+
+    /**
+     * @brief stage unassociated observations before they start landmarks
+     * @details an observation that a particle cannot associate no longer starts an EKF in
+     * that particle. It is recorded in one filter-wide list of tentative landmarks, placed
+     * from the pose passed to updateFilter. Once a tentative landmark is promoted (see
+     * landmark-staging.h), the particles that could not associate the promoting observation
+     * start the landmark from their own pose. Applies to updateFilter; updateFleet starts
+     * landmarks directly
+     *
+     * @param[in] config: sightings needed, time window and gate
+     */
+    void enableStaging(const struct StagingConfig& config);
+
+    /**
+     * @brief start landmarks on their first sighting again, dropping the tentative ones
+     */
+    void disableStaging();
+
+    const LandmarkStaging& getStaging() const { return m_staging; }
+
+    /**
+     * @brief track the pose against a fixed map instead of mapping
+     * @details every particle drops its landmarks and keeps only its pose. updateFilter
+     * then samples the poses from the motion model and weights them by associating the
+     * observations with the shared prior map, through its grid index; nothing is mapped
+     * and resampling copies poses only. The proposal, staging and submap settings do not
+     * apply while localizing, and updateFleet is not supported
+     *
+     * @param[in] map: prior map, shared read-only; nullptr is ignored
+     * @param[in] config: association settings
+     */
+    void enableLocalization(std::shared_ptr<const PriorMap> map,
+                            const struct LocalizationConfig& config = LocalizationConfig());
+
+    /**
+     * @brief return to mapping, starting from empty particle maps
+     */
+    void disableLocalization();
+
+    bool isLocalizing() const { return m_prior_map != nullptr; }
+
+    const std::shared_ptr<const PriorMap>& getPriorMap() const { return m_prior_map; }
+
+    /**
+     * @brief add a robot that shares the landmark map of this filter
+     * @details every particle gets a pose hypothesis for the robot, starting at
+     * starting_pose, which must be in the frame of the map
+     *
+     * @param[in] robot: robot manager of the new robot
+     * @param[in] starting_pose: initial pose of the new robot in the map frame
+     * @return robot id for updateFleet, -1 if robot is null
+     */
+    int addRobot(std::shared_ptr<RobotManager2D> robot, const struct Pose2D& starting_pose);
+
+    /**
+     * @brief add the robot of another filter together with its map
+     * @details the other map must be aligned with this one, i.e. expressed in the same
+     * frame. Its best particle, including the landmarks frozen in its submaps, is
+     * associated once against the best particle of this filter by Mahalanobis gating;
+     * matched landmarks are fused, the others appended with new uids, in every particle.
+     * A particle that does not hold a matched landmark gets it appended under a new uid
+     * instead. In submap mode this filter's submaps are thawed first, and the active window
+     * is re-applied by the next updateFilter call. The robot's pose hypotheses are drawn
+     * from the other filter's particles by weight. Not supported in localization mode
+     *
+     * @param[in] robot: robot manager of the other filter's robot
+     * @param[in] other: filter whose map is merged
+     * @param[in] gate: squared Mahalanobis distance below which two landmarks are the same
+     * @return robot id for updateFleet, -1 if robot is null or this filter is localizing
+     */
+    int mergeRobot(std::shared_ptr<RobotManager2D> robot, const FastSLAMPF& other,
+                   float gate = DEFAULT_MERGE_GATE);
+
+    /**
+     * @brief number of robots sharing the map, 1 unless robots were added
+     */
+    unsigned int getNumRobots() const { return m_fleet.size(); }
+
+    /**
+     * @brief update every particle with one frame from each of several robots, then
+     * normalize and resample once
+     * @details always uses the observation-conditioned proposal, whose models take the
+     * observing robot's pose explicitly. The robots of a particle share its map, so their
+     * frames are applied one after another within a particle; the particles are split
+     * across num_threads workers, whose threads are kept for later calls. Submap windows
+     * and the frame budget follow updateFilter only
+     *
+     * @param[in] frames: frames of distinct or repeated robots, applied in order
+     * @param[in] num_threads: worker threads, 1 updates on the calling thread
+     */
+    void updateFleet(const std::vector<struct RobotFrame>& frames, unsigned int num_threads = 1);
+
+    /**
+     * @brief particle-weighted consensus of every landmark across the particle set
+     * @details only the landmarks touched since the previous query are recomputed; between
+     * frames repeated queries are O(1) and return the same version
+     *
+     * @return map view, valid until the next updateFilter call
+     */
+    const ConsensusMap& getConsensusMap() const;
+
+    /**
+     * @brief consensus of every landmark ever started, active or frozen in a submap
+     * @details recomputes every landmark rather than only the touched ones, so that no entry
+     * is left stale by resampling; O(landmarks * particles * log landmarks), meant for
+     * evaluation rather than the update loop
+     *
+     * @return map view, valid until the next updateFilter call
+     */
+    const ConsensusMap& getFullConsensusMap() const;
 
      /**
      * @brief samples one particle, based on weights, and estimates the landmarks of each EKF
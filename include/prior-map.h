@@ -0,0 +1,120 @@
+/**
+ * @file prior-map.h
+ * @brief Defines a fixed, spatially indexed landmark map for localization-only mode
+ *
+ * A PriorMap is built once and never changes, so a single instance is shared read-only by
+ * every particle of a filter in localization mode (FastSLAMPF::enableLocalization).
+ * Landmarks are bucketed into a uniform grid of square cells, stored contiguously cell by
+ * cell, so that a query visits only the cells around the point of interest.
+ */
+
+#pragma once
+
+#include "core-structs.h"
+#include "submap.h"
+#include <cstdint>
+#include <vector>
+
+class ConsensusMap;
+
+/**
+ * @brief association settings of localization mode
+ */
+struct LocalizationConfig {
+    float search_radius_m = 1.0f;   // candidates lie this close to where a sighting lands
+};
+
+/**
+ * @brief one landmark of a prior map
+ */
+struct PriorLandmark {
+    uint32_t uid;          // uid of the landmark, e.g. from the consensus map it came from
+    struct Point2D mean;
+    Eigen::Matrix2f cov;   // uncertainty of the mapped position
+};
+
+class PriorMap {
+
+private:
+    float m_cell_size_m;
+
+    /**
+     * @brief landmarks, grouped by cell in the order of m_cell_keys
+     */
+    std::vector<struct PriorLandmark> m_landmarks;
+
+    /**
+     * @brief sorted keys of the occupied cells, see regionKey
+     */
+    std::vector<int64_t> m_cell_keys;
+
+    /**
+     * @brief first landmark of each occupied cell, plus the total landmark count
+     */
+    std::vector<uint32_t> m_cell_start;
+
+public:
+
+    /**
+     * @brief index a set of landmarks
+     *
+     * @param[in] landmarks: landmarks of the map, in any order
+     * @param[in] cell_size_m: side of one grid cell; about the search radius works well
+     */
+    explicit PriorMap(std::vector<struct PriorLandmark> landmarks, float cell_size_m = 2.0f);
+
+    /**
+     * @brief prior map from the consensus of a finished mapping run
+     *
+     * @param[in] consensus: consensus map, e.g. FastSLAMPF::getConsensusMap()
+     * @param[in] min_support: landmarks held by less particle weight than this are left out
+     * @param[in] cell_size_m: side of one grid cell
+     */
+    static PriorMap fromConsensus(const ConsensusMap& consensus, float min_support = 0.5f,
+                                  float cell_size_m = 2.0f);
+
+    size_t size() const { return m_landmarks.size(); }
+
+    float getCellSize() const { return m_cell_size_m; }
+
+    /**
+     * @brief landmarks grouped by grid cell
+     */
+    const std::vector<struct PriorLandmark>& getLandmarks() const { return m_landmarks; }
+
+    /**
+     * @brief call f on every landmark within radius_m of center
+     * @details visits the cells overlapping the square around center, each found by binary
+     * search over the occupied cells
+     *
+     * @param[in] center: query point
+     * @param[in] radius_m: search radius
+     * @param[in] f: callable taking a const PriorLandmark&
+     */
+    template<typename F>
+    void forEachNear(const struct Point2D& center, float radius_m, F&& f) const {
+        if (m_landmarks.empty() || !(radius_m >= 0)) return;
+        int32_t min_ix = regionIndex(center.x - radius_m, m_cell_size_m);
+        int32_t max_ix = regionIndex(center.x + radius_m, m_cell_size_m);
+        int32_t min_iy = regionIndex(center.y - radius_m, m_cell_size_m);
+        int32_t max_iy = regionIndex(center.y + radius_m, m_cell_size_m);
+        double radius2 = static_cast<double>(radius_m) * radius_m;
+        for (int32_t ix = min_ix; ix <= max_ix; ix++) {
+            for (int32_t iy = min_iy; iy <= max_iy; iy++) {
+                int cell = findCell(regionKey(ix, iy));
+                if (cell < 0) continue;
+                for (uint32_t i = m_cell_start[cell]; i < m_cell_start[cell + 1]; i++) {
+                    const struct PriorLandmark& lm = m_landmarks[i];
+                    double dx = static_cast<double>(lm.mean.x) - center.x;
+                    double dy = static_cast<double>(lm.mean.y) - center.y;
+                    if (dx * dx + dy * dy <= radius2) f(lm);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief index of the occupied cell with the given key, -1 if the cell is empty
+     */
+    int findCell(int64_t key) const;
+};
@@ -0,0 +1,210 @@
+/**
+ * @file profiler.h
+ * @brief Defines low-overhead scoped stage timers and latency histograms for the filter hot path
+ *
+ * Timers are only compiled in when PF_PROFILING is defined (cmake -DPF_PROFILING=ON).
+ * Otherwise PF_PROFILE_SCOPE and PF_PROFILE_BIND expand to nothing and the
+ * hot path carries no timing code at all. With PF_TRACING, PF_PROFILE_SCOPE also
+ * emits a trace span for the stage (see trace.h).
+ */
+
+#pragma once
+
+#include "trace.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Namespace for hot-path stage timing.
+ */
+namespace Profiler {
+
+/**
+ * @brief stages of one FastSLAMPF::updateFilter call; FRAME times the whole call
+ */
+enum class Stage { SAMPLE_POSE = 0, ASSOCIATION, EKF_UPDATE, WEIGHTING, RESAMPLE, FRAME,
+                   NUM_STAGES };
+
+constexpr int NUM_STAGES = static_cast<int>(Stage::NUM_STAGES);
+
+/**
+ * @brief human-readable stage name, e.g. "association"
+ */
+const char* stageName(Stage stage);
+
+/**
+ * @brief HDR-style histogram of durations
+ * @details durations below 2^SUB_BUCKET_BITS ns are counted exactly; above that, every
+ * power-of-two range is split into 2^(SUB_BUCKET_BITS-1) linear sub-buckets, so any
+ * reported value is within 1/2^(SUB_BUCKET_BITS-1) of the recorded one. Recording never
+ * allocates; durations beyond MAX_TRACKABLE_NS land in the top bucket but still count
+ * toward max and mean.
+ */
+class LatencyHistogram {
+
+public:
+    static constexpr int SUB_BUCKET_BITS = 7;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+    static constexpr int MAX_VALUE_BITS = 40;
+    static constexpr uint64_t MAX_TRACKABLE_NS = (uint64_t{1} << MAX_VALUE_BITS) - 1;
+    static constexpr int NUM_BUCKETS =
+        SUB_BUCKET_COUNT + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * SUB_BUCKET_HALF;
+
+private:
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count = 0;
+    uint64_t m_total_ns = 0;
+    uint64_t m_min_ns = UINT64_MAX;
+    uint64_t m_max_ns = 0;
+
+public:
+    LatencyHistogram(): m_buckets(NUM_BUCKETS, 0) {}
+
+    /**
+     * @brief bucket index of a duration
+     */
+    static int bucketIndex(uint64_t duration_ns);
+
+    /**
+     * @brief largest duration counted in a bucket
+     */
+    static uint64_t bucketUpperNs(int bucket);
+
+    /**
+     * @brief add one duration to the histogram
+     *
+     * @param[in] duration_ns: measured duration in nanoseconds
+     */
+    void record(uint64_t duration_ns);
+
+    /**
+     * @brief add every duration recorded in another histogram, e.g. from another thread
+     *
+     * @param[in] other: histogram to merge in
+     */
+    void merge(const LatencyHistogram& other);
+
+    /**
+     * @brief drop all recorded durations
+     */
+    void reset();
+
+    /**
+     * @brief upper bound of the bucket holding the requested percentile
+     *
+     * @param[in] pct: percentile in [0, 100]
+     * @return duration in nanoseconds, clamped to the observed maximum; 0 if nothing was recorded
+     */
+    uint64_t percentileNs(double pct) const;
+
+    uint64_t count() const { return m_count; }
+    uint64_t totalNs() const { return m_total_ns; }
+    uint64_t minNs() const { return m_count ? m_min_ns : 0; }
+    uint64_t maxNs() const { return m_max_ns; }
+    double meanNs() const { return m_count ? static_cast<double>(m_total_ns) / m_count : 0.0; }
+    uint64_t bucketCount(int bucket) const { return m_buckets[bucket]; }
+};
+
+/**
+ * @brief one histogram per stage, including the whole frame
+ */
+struct StageProfile {
+    std::array<LatencyHistogram, NUM_STAGES> stages;
+
+    LatencyHistogram& operator[](Stage stage) { return stages[static_cast<int>(stage)]; }
+    const LatencyHistogram& operator[](Stage stage) const { return stages[static_cast<int>(stage)]; }
+
+    void reset() {
+        for (auto& it: stages) {
+            it.reset();
+        }
+    }
+
+    /**
+     * @brief add every duration recorded in another profile, e.g. from another thread
+     */
+    void merge(const StageProfile& other) {
+        for (int i = 0; i < NUM_STAGES; i++) {
+            stages[i].merge(other.stages[i]);
+        }
+    }
+};
+
+/**
+ * @brief write count, mean, p50, p90, p99, p99.9 and max of every non-empty stage as CSV
+ *
+ * @param[in] profile: histograms to export
+ * @param[in] path: output file
+ * @return true if the file was written
+ */
+bool writeLatencyReport(const StageProfile& profile, const std::string& path);
+
+/**
+ * @brief profile receiving the timings of the calling thread, nullptr if unbound
+ */
+inline thread_local StageProfile* t_active_profile = nullptr;
+
+/**
+ * @brief routes the calling thread's timers into a profile for the lifetime of the object
+ */
+class ProfileBinding {
+
+private:
+    StageProfile* m_previous;
+
+public:
+    explicit ProfileBinding(StageProfile& profile): m_previous(t_active_profile) {
+        t_active_profile = &profile;
+    }
+
+    ~ProfileBinding() { t_active_profile = m_previous; }
+
+    ProfileBinding(const ProfileBinding&) = delete;
+    ProfileBinding& operator=(const ProfileBinding&) = delete;
+};
+
+/**
+ * @brief measures the enclosing scope and records it under a stage of the bound profile
+ */
+class ScopedTimer {
+
+private:
+    Stage m_stage;
+    std::chrono::steady_clock::time_point m_start;
+
+public:
+    explicit ScopedTimer(Stage stage): m_stage(stage), m_start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedTimer() {
+        if (t_active_profile == nullptr) return;
+        auto elapsed = std::chrono::steady_clock::now() - m_start;
+        (*t_active_profile)[m_stage].record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+}; // namespace Profiler
+
+#define PF_PROFILE_CONCAT_INNER(a, b) a##b
+#define PF_PROFILE_CONCAT(a, b) PF_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PF_PROFILING
+#define PF_PROFILE_TIMER(stage) \
+    Profiler::ScopedTimer PF_PROFILE_CONCAT(pf_profile_timer_, __LINE__)(stage)
+#define PF_PROFILE_BIND(profile) \
+    Profiler::ProfileBinding PF_PROFILE_CONCAT(pf_profile_binding_, __LINE__)(profile)
+#else
+#define PF_PROFILE_TIMER(stage) (void) 0
+#define PF_PROFILE_BIND(profile) (void) 0
+#endif // PF_PROFILING
+
+// stages are timed when PF_PROFILING is set and show up as spans when PF_TRACING is set
+#define PF_PROFILE_SCOPE(stage) \
+    PF_PROFILE_TIMER(stage); PF_TRACE_SPAN(Profiler::stageName(stage), "stage")
@@ -122,6 +122,38 @@ public:
      */
     virtual Eigen::Matrix2f measJacobian(const struct Point2D& mu_prev) const = 0;
 
+    /**
+     * @brief predicts the measurement of a landmark from a given robot pose
+     * @details unlike predictMeas(mu_prev), does not use the manager's current pose, so
+     * every particle can condition the prediction on its own pose hypothesis
+     *
+     * @param[in] rob_pose: robot pose hypothesis
+     * @param[in] lm: landmark location
+     * @return predicted range-bearing measurement, bearing wrapped into [-pi, pi]
+     */
+    virtual struct Observation2D predictMeas(const struct Pose2D& rob_pose,
+                                             const struct Point2D& lm) const = 0;
+
+    /**
+     * @brief jacobian of the measurement function with respect to the landmark position
+     *
+     * @param[in] rob_pose: robot pose hypothesis
+     * @param[in] lm: landmark location
+     * @return a 2x2 matrix, rows are range and bearing
+     */
+    virtual Eigen::Matrix2f measJacobian(const struct Pose2D& rob_pose,
+                                         const struct Point2D& lm) const = 0;
+
+    /**
+     * @brief jacobian of the measurement function with respect to the robot pose
+     *
+     * @param[in] rob_pose: robot pose hypothesis
+     * @param[in] lm: landmark location
+     * @return a 2x3 matrix, rows are range and bearing, columns are x, y and heading
+     */
+    virtual Eigen::Matrix<float, 2, 3> poseJacobian(const struct Pose2D& rob_pose,
+                                                    const struct Point2D& lm) const = 0;
+
     /**
      * @brief get current robot measurement noise
      * @return a 2x2 sensor covariance matrix
@@ -223,6 +255,24 @@ public:
      */
     Eigen::Matrix2f measJacobian(const struct Point2D& mu_prev) const override;
 
+    /**
+     * @brief predict the lidar measurement of a landmark from a given robot pose
+     */
+    struct Observation2D predictMeas(const struct Pose2D& rob_pose,
+                                     const struct Point2D& lm) const override;
+
+    /**
+     * @brief lidar measurement jacobian with respect to the landmark, from a given robot pose
+     */
+    Eigen::Matrix2f measJacobian(const struct Pose2D& rob_pose,
+                                 const struct Point2D& lm) const override;
+
+    /**
+     * @brief lidar measurement jacobian with respect to the robot pose
+     */
+    Eigen::Matrix<float, 2, 3> poseJacobian(const struct Pose2D& rob_pose,
+                                            const struct Point2D& lm) const override;
+
     /**
      * @brief get Create3 sensor measurement noise
      */
@@ -266,6 +316,15 @@ public:
 
     Eigen::Matrix2f measJacobian(const struct Point2D& mu_prev) const override;
 
+    struct Observation2D predictMeas(const struct Pose2D& rob_pose,
+                                     const struct Point2D& lm) const override;
+
+    Eigen::Matrix2f measJacobian(const struct Pose2D& rob_pose,
+                                 const struct Point2D& lm) const override;
+
+    Eigen::Matrix<float, 2, 3> poseJacobian(const struct Pose2D& rob_pose,
+                                            const struct Point2D& lm) const override;
+
     Eigen::Matrix2f getMeasNoise() const override;
 
     Eigen::Matrix3f getProcessNoise() const override;
@@ -0,0 +1,96 @@
+/**
+ * @file sim-world.h
+ * @brief Defines a synthetic landmark world used to drive the filter in
+ * benchmarks and evaluation runs.
+ */
+
+#pragma once
+
+#include "core-structs.h"
+#include <random>
+#include <vector>
+
+/** Settings of a synthetic world and the simulated robot driving through it. */
+struct SimConfig {
+    int num_landmarks = 100;          // landmarks scattered over the world
+    int max_obs_per_frame = 5;        // nearest landmarks reported per frame
+    int clutter_per_frame = 0;        // spurious sightings per frame, uniform within range
+    float world_size_m = 0.0f;        // side of the square world; <= 0 scales with num_landmarks
+    float perceptual_range_m = 5.0f;  // maximum sensing range
+    float speed_mps = 0.5f;           // forward velocity of the robot
+    float turn_rate_radps = 0.0f;     // angular velocity; <= 0 drives a loop of radius world/4
+    float dt_s = 1.0f;                // time between frames
+    Eigen::Matrix2f meas_noise = Eigen::Vector2f(0.01f, 0.001f).asDiagonal();
+    Eigen::Matrix3f odom_noise = Eigen::Vector3f(0.001f, 0.001f, 0.0001f).asDiagonal();
+    unsigned int seed = 1;            // random seed; identical seeds replay identical worlds
+};
+
+/** Everything the simulated robot reports in one frame, plus the ground truth. */
+struct SimFrame {
+    struct Pose2D true_pose;                        // ground-truth robot pose
+    struct Pose2D odom_pose;                        // dead-reckoned pose, drifts over time
+    std::vector<struct Observation2D> observations; // noisy range-bearing sightings
+    std::vector<int> landmark_indices;              // ground-truth landmark of each sighting,
+                                                    // -1 for clutter
+};
+
+class SimWorld {
+
+private:
+    /**
+     * @brief world and robot settings
+     */
+    SimConfig m_config;
+
+    /**
+     * @brief seeded generator; the simulation never uses std::random_device
+     */
+    std::mt19937 m_gen;
+
+    /**
+     * @brief ground-truth landmark positions
+     */
+    std::vector<struct Point2D> m_landmarks;
+
+    /**
+     * @brief ground-truth robot pose
+     */
+    struct Pose2D m_true_pose;
+
+    /**
+     * @brief dead-reckoned robot pose
+     */
+    struct Pose2D m_odom_pose;
+
+    /**
+     * @brief draw a zero-mean sample with the given variance
+     */
+    float sampleNoise(float variance);
+
+public:
+
+    SimWorld() = delete;
+
+    /**
+     * @brief scatter the landmarks and place the robot at the start of its loop
+     *
+     * @param[in] config: world and robot settings
+     */
+    explicit SimWorld(const SimConfig& config);
+
+    /**
+     * @brief advance the robot by one frame and collect its sightings
+     * @return odometry, observations and ground truth of the new frame
+     */
+    SimFrame step();
+
+    /**
+     * @brief ground-truth landmark positions
+     */
+    const std::vector<struct Point2D>& getLandmarks() const { return m_landmarks; }
+
+    /**
+     * @brief settings the world was built with (world size resolved)
+     */
+    const SimConfig& getConfig() const { return m_config; }
+};
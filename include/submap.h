@@ -0,0 +1,65 @@
+/**
+ * @file submap.h
+ * @brief Defines the region grid and the frozen storage of the submap mode
+ *
+ * In submap mode the world is cut into square regions. Only the landmarks of regions
+ * within active_radius regions of the robot stay in a particle's landmark bank, where
+ * they take part in association and update. The others are frozen into one immutable
+ * FrozenSubmap per region: 28 bytes per landmark with float coordinates, instead of a full
+ * EKF. Frozen submaps are shared between a particle and its resampled copies, so copying a
+ * particle only copies its active landmarks.
+ */
+
+#pragma once
+
+#include "core-structs.h"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief submap region size and active window
+ */
+struct SubmapConfig {
+    float region_size_m = 20.0f;  // side of one square region
+    int active_radius = 1;        // regions around the robot's region kept active, 1 gives 3x3
+};
+
+/**
+ * @brief index of a region along one axis
+ */
+inline int32_t regionIndex(float coord_m, float region_size_m) {
+    return static_cast<int32_t>(std::floor(coord_m / region_size_m));
+}
+
+/**
+ * @brief key of the region (ix, iy)
+ */
+inline int64_t regionKey(int32_t ix, int32_t iy) {
+    return static_cast<int64_t>(static_cast<uint64_t>(static_cast<uint32_t>(ix)) << 32 |
+                                static_cast<uint32_t>(iy));
+}
+
+inline int32_t regionKeyX(int64_t key) { return static_cast<int32_t>(key >> 32); }
+inline int32_t regionKeyY(int64_t key) { return static_cast<int32_t>(key & 0xFFFFFFFF); }
+
+/**
+ * @brief landmark estimate without its EKF machinery
+ */
+struct FrozenLandmark {
+    uint32_t uid;
+    CoordScalar x;
+    CoordScalar y;
+    float cov_xx;
+    float cov_xy;
+    float cov_yy;
+    int sightings;
+};
+
+/**
+ * @brief landmarks of one inactive region, immutable once built
+ */
+struct FrozenSubmap {
+    int64_t key;
+    std::vector<struct FrozenLandmark> landmarks;
+};
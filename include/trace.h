@@ -0,0 +1,161 @@
+/**
+ * @file trace.h
+ * @brief Defines a span tracer that exports Chrome trace-event JSON (viewable in Perfetto)
+ *
+ * Spans are only compiled in when PF_TRACING is defined (cmake -DPF_TRACING=ON), and
+ * only recorded between Trace::start() and Trace::stop(). Every thread writes into its
+ * own fixed-size ring buffer; the buffer is registered once under a lock, after which
+ * recording never locks or allocates. When a buffer wraps, the oldest spans are dropped.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Namespace for timeline tracing.
+ */
+namespace Trace {
+
+/** One completed span ("ph":"X" in the trace-event format). */
+struct TraceEvent {
+    const char* name;       // span name, must point to a string literal
+    const char* category;   // span category, e.g. "frame" or "stage"
+    uint64_t start_ns;      // start time relative to the trace epoch
+    uint64_t duration_ns;   // span length
+    int64_t arg;            // free-form argument, e.g. particle count; -1 if unused
+};
+
+/**
+ * @brief spans kept per thread before the oldest are overwritten
+ */
+constexpr size_t DEFAULT_BUFFER_EVENTS = 1 << 16;
+
+/**
+ * @brief single-writer ring buffer owned by one thread
+ */
+class ThreadBuffer {
+
+private:
+    std::vector<TraceEvent> m_events;
+    std::atomic<uint64_t> m_written{0};
+    uint32_t m_tid;
+    std::string m_thread_name;
+
+public:
+    ThreadBuffer(uint32_t tid, size_t capacity): m_events(capacity), m_tid(tid) {}
+
+    /**
+     * @brief append a span; only called by the owning thread
+     */
+    void push(const TraceEvent& event) {
+        uint64_t idx = m_written.load(std::memory_order_relaxed);
+        m_events[idx % m_events.size()] = event;
+        m_written.store(idx + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief copy out the retained spans, oldest first
+     */
+    std::vector<TraceEvent> snapshot() const;
+
+    /**
+     * @brief drop all spans
+     */
+    void clear() { m_written.store(0, std::memory_order_release); }
+
+    uint32_t getTid() const { return m_tid; }
+    const std::string& getThreadName() const { return m_thread_name; }
+    void setThreadName(const std::string& name) { m_thread_name = name; }
+};
+
+/**
+ * @brief true while spans are being recorded
+ */
+extern std::atomic<bool> g_enabled;
+
+/**
+ * @brief begin recording spans
+ */
+void start();
+
+/**
+ * @brief stop recording spans; recorded spans are kept until clear()
+ */
+void stop();
+
+/**
+ * @brief drop the spans of every thread
+ */
+void clear();
+
+/**
+ * @brief nanoseconds since the trace epoch (first use of the tracer)
+ */
+uint64_t nowNs();
+
+/**
+ * @brief buffer of the calling thread, registered on first use
+ */
+ThreadBuffer& threadBuffer();
+
+/**
+ * @brief label the calling thread in the exported trace, e.g. "worker 3"
+ */
+void setThreadName(const std::string& name);
+
+/**
+ * @brief write the spans of every thread as Chrome trace-event JSON
+ * @details must not race with recording threads; call it after stop() or between frames
+ *
+ * @param[in] path: output file
+ * @return true if the file was written
+ */
+bool dumpChromeJson(const std::string& path);
+
+/**
+ * @brief records the enclosing scope as a span if tracing is running
+ */
+class ScopedSpan {
+
+private:
+    const char* m_name;
+    const char* m_category;
+    int64_t m_arg;
+    uint64_t m_start_ns;
+    bool m_active;
+
+public:
+    ScopedSpan(const char* name, const char* category, int64_t arg = -1):
+        m_name(name), m_category(category), m_arg(arg),
+        m_active(g_enabled.load(std::memory_order_relaxed)) {
+        m_start_ns = m_active ? nowNs() : 0;
+    }
+
+    ~ScopedSpan() {
+        if (!m_active) return;
+        threadBuffer().push({m_name, m_category, m_start_ns, nowNs() - m_start_ns, m_arg});
+    }
+
+    ScopedSpan(const ScopedSpan&) = delete;
+    ScopedSpan& operator=(const ScopedSpan&) = delete;
+};
+
+}; // namespace Trace
+
+#define PF_TRACE_CONCAT_INNER(a, b) a##b
+#define PF_TRACE_CONCAT(a, b) PF_TRACE_CONCAT_INNER(a, b)
+
+#ifdef PF_TRACING
+#define PF_TRACE_SPAN(name, category) \
+    Trace::ScopedSpan PF_TRACE_CONCAT(pf_trace_span_, __LINE__)(name, category)
+#define PF_TRACE_SPAN_ARG(name, category, arg) \
+    Trace::ScopedSpan PF_TRACE_CONCAT(pf_trace_span_, __LINE__)(name, category, arg)
+#else
+#define PF_TRACE_SPAN(name, category) (void) 0
+#define PF_TRACE_SPAN_ARG(name, category, arg) (void) 0
+#endif // PF_TRACING
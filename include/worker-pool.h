@@ -0,0 +1,79 @@
+/**
+ * @file worker-pool.h
+ * @brief Defines a persistent pool of worker threads for the parallel filter updates
+ *
+ * Threads are started the first time a run needs them and then reused by every later run,
+ * so per-thread state such as trace buffers is created once per worker rather than once
+ * per frame. A run hands the same task to the calling thread (worker 0) and to workers
+ * 1..n-1, and returns once all of them finished. Copying a pool gives an empty pool: the
+ * threads belong to the object that started them.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+
+private:
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_lock;
+
+    std::condition_variable m_start;
+
+    std::condition_variable m_done;
+
+    /**
+     * @brief task of the current run, valid while m_pending > 0
+     */
+    const std::function<void(unsigned int)>* m_task = nullptr;
+
+    /**
+     * @brief incremented by every run, wakes the workers
+     */
+    uint64_t m_generation = 0;
+
+    /**
+     * @brief pool threads taking part in the current run, workers 1..m_active
+     */
+    unsigned int m_active = 0;
+
+    /**
+     * @brief pool threads of the current run that have not finished yet
+     */
+    unsigned int m_pending = 0;
+
+    bool m_stop = false;
+
+    void workerLoop(unsigned int worker, uint64_t generation);
+
+public:
+    WorkerPool() = default;
+
+    WorkerPool(const WorkerPool&) : WorkerPool() {}
+
+    WorkerPool& operator=(const WorkerPool&) { return *this; }
+
+    ~WorkerPool();
+
+    /**
+     * @brief run task(w) for w in [0, num_workers), worker 0 on the calling thread
+     * @details starts the missing pool threads on first use; blocks until every worker
+     * returned. Runs of one pool must not overlap
+     *
+     * @param[in] num_workers: workers of this run, 1 runs task(0) inline
+     * @param[in] task: work of one worker, called concurrently
+     */
+    void run(unsigned int num_workers, const std::function<void(unsigned int)>& task);
+
+    /**
+     * @brief pool threads started so far, not counting the calling thread
+     */
+    unsigned int size() const { return m_threads.size(); }
+};
@@ -0,0 +1,310 @@
+/**
+ * @file accuracy_eval.cpp
+ * @brief Accuracy-versus-cost evaluation of the filter against simulated ground truth
+ *
+ * usage: eval_FastSLAM [--particles 5,10,25,50] [--obs 2,5] [--landmarks <n>]
+ *                      [--frames <n>] [--runs <n>] [--proposal motion,observation]
+ *                      [--json <file>] [--csv <file>]
+ *
+ * Every configuration is run over the same seeded worlds (one per run). Reported per
+ * configuration, averaged over runs:
+ *   - pose_rmse_m, heading_rmse_rad: error of the weighted particle-mean pose over all
+ *     frames, using the filter's normalized weights
+ *   - pose_nees: normalized estimation error squared of the pose, using the weighted
+ *     particle spread as covariance; a consistent filter averages 3 (the pose dimension)
+ *   - landmark_rmse_m, landmark_nees: error of the consensus map landmarks matched to
+ *     ground truth, weighted by their support; landmarks frozen in submaps count like
+ *     active ones. A consistent map averages 2
+ *   - spurious_landmarks: expected landmarks per particle with no ground-truth landmark
+ *     within the gate
+ *   - cpu_ms_per_frame, wall_ms_per_frame: cost of updateFilter
+ * --proposal selects the pose proposal: motion (FastSLAM 1.0, default), observation
+ * (FastSLAM 2.0) or both; the "proposal" parameter of each case is 0 or 1 respectively.
+ * A configuration is marked pareto = 1 when no other configuration has both lower pose
+ * error and lower CPU cost.
+ */
+
+#include "bench-util.h"
+#include "particle-filter.h"
+#include "robot-manager.h"
+#include "sim-world.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+constexpr float LANDMARK_GATE_M = 1.0f;
+constexpr float POSE_COV_REGULARIZER = 1e-6f;
+
+/** Accumulated errors of one run. */
+struct RunErrors {
+    double pos_sq_sum = 0.0;
+    double heading_sq_sum = 0.0;
+    double pose_nees_sum = 0.0;
+    int frames = 0;
+    double lm_rmse = 0.0;
+    double lm_nees = 0.0;
+    double spurious = 0.0;
+    double cpu_ms = 0.0;
+    std::vector<double> frame_ns;
+};
+
+std::vector<int> parseList(const char* arg) {
+    std::vector<int> values;
+    std::stringstream list(arg);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        int value = atoi(item.c_str());
+        if (value > 0) values.push_back(value);
+    }
+    return values;
+}
+
+/**
+ * @brief pose error and NEES of the weighted particle cloud against the true pose
+ */
+void scorePose(const FastSLAMPF& filter, const struct Pose2D& truth, RunErrors& errors) {
+    const std::vector<WeightScalar>& weights = filter.getWeights();
+    Eigen::Vector3f mean = Eigen::Vector3f::Zero();
+    float sin_sum = 0.0f;
+    float cos_sum = 0.0f;
+    for (int i = 0; i < weights.size(); i++) {
+        const struct Pose2D& pose = filter.getParticle(i).getPose();
+        float w = static_cast<float>(weights[i]);
+        mean(0) += w * pose.x;
+        mean(1) += w * pose.y;
+        sin_sum += w * sinf(pose.theta_rad);
+        cos_sum += w * cosf(pose.theta_rad);
+    }
+    mean(2) = atan2f(sin_sum, cos_sum);
+
+    Eigen::Matrix3f cov = POSE_COV_REGULARIZER * Eigen::Matrix3f::Identity();
+    for (int i = 0; i < weights.size(); i++) {
+        const struct Pose2D& pose = filter.getParticle(i).getPose();
+        Eigen::Vector3f diff(pose.x - mean(0), pose.y - mean(1),
+                             MathUtil::wrapAngle(pose.theta_rad - mean(2)));
+        cov += static_cast<float>(weights[i]) * diff * diff.transpose();
+    }
+
+    Eigen::Vector3f err(mean(0) - truth.x, mean(1) - truth.y,
+                        MathUtil::wrapAngle(mean(2) - truth.theta_rad));
+    errors.pos_sq_sum += err(0) * err(0) + err(1) * err(1);
+    errors.heading_sq_sum += err(2) * err(2);
+    errors.pose_nees_sum += err.dot(cov.ldlt().solve(err));
+    errors.frames++;
+}
+
+/**
+ * @brief map error, map NEES and spurious landmarks of the consensus map
+ * @details every consensus landmark counts with its support, the weight of the particles
+ * holding it, so the scores are the weighted averages over particles
+ */
+void scoreMap(const ConsensusMap& map, const std::vector<struct Point2D>& truth,
+              RunErrors& errors) {
+    double sq_sum = 0.0;
+    double nees_sum = 0.0;
+    double matched = 0.0;
+    double spurious = 0.0;
+    for (const auto& lm: map.getLandmarks()) {
+        auto nearest = std::min_element(truth.begin(), truth.end(),
+            [&lm](const Point2D& a, const Point2D& b) {
+                return MathUtil::findDist(lm.mean, a) < MathUtil::findDist(lm.mean, b);
+            });
+        if (nearest == truth.end() || MathUtil::findDist(lm.mean, *nearest) > LANDMARK_GATE_M) {
+            spurious += lm.support;
+            continue;
+        }
+        Eigen::Vector2f err(lm.mean.x - nearest->x, lm.mean.y - nearest->y);
+        sq_sum += lm.support * err.squaredNorm();
+        nees_sum += lm.support * err.dot(lm.cov.ldlt().solve(err));
+        matched += lm.support;
+    }
+    errors.lm_rmse = matched > 0 ? sqrt(sq_sum / matched) : 0.0;
+    errors.lm_nees = matched > 0 ? nees_sum / matched : 0.0;
+    errors.spurious = spurious;
+}
+
+/**
+ * @brief run one configuration over one seeded world
+ */
+RunErrors runOnce(int num_particles, int obs_per_frame, int num_landmarks, int num_frames,
+                  PF_PROPOSAL proposal, unsigned int seed) {
+    SimConfig sim_config;
+    sim_config.num_landmarks = num_landmarks;
+    sim_config.max_obs_per_frame = obs_per_frame;
+    sim_config.seed = seed;
+    SimWorld world(sim_config);
+
+    std::shared_ptr<MockManager2D> robot = std::make_shared<MockManager2D>(
+        Pose2D{.x = 0, .y = 0, .theta_rad = 0}, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0},
+        sim_config.meas_noise, sim_config.perceptual_range_m, sim_config.odom_noise);
+
+    SimFrame first = world.step();
+    robot->setState(first.odom_pose);
+    FastSLAMPF filter(robot, num_particles, first.odom_pose, DEFAULT_IMPORTANCE_FACTOR);
+    filter.setProposal(proposal);
+
+    RunErrors errors;
+    for (int i = 0; i < num_frames; i++) {
+        SimFrame frame = world.step();
+        robot->setState(frame.odom_pose);
+        std::queue<struct Observation2D> sightings;
+        for (const auto& it: frame.observations) {
+            sightings.push(it);
+        }
+
+        std::clock_t cpu_start = std::clock();
+        auto wall_start = std::chrono::steady_clock::now();
+        filter.updateFilter(frame.odom_pose, sightings);
+        errors.frame_ns.push_back(std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - wall_start).count());
+        errors.cpu_ms += 1000.0 * (std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+        scorePose(filter, frame.true_pose, errors);
+    }
+    scoreMap(filter.getFullConsensusMap(), world.getLandmarks(), errors);
+    return errors;
+}
+
+/**
+ * @brief flag configurations no other configuration beats on both pose error and CPU cost
+ */
+void markPareto(std::vector<BenchUtil::BenchResult>& results) {
+    for (auto& it: results) {
+        bool dominated = false;
+        for (const auto& other: results) {
+            bool no_worse = other.counters.at("pose_rmse_m") <= it.counters.at("pose_rmse_m") &&
+                other.counters.at("cpu_ms_per_frame") <= it.counters.at("cpu_ms_per_frame");
+            bool better = other.counters.at("pose_rmse_m") < it.counters.at("pose_rmse_m") ||
+                other.counters.at("cpu_ms_per_frame") < it.counters.at("cpu_ms_per_frame");
+            dominated = dominated || (no_worse && better);
+        }
+        it.counters["pareto"] = dominated ? 0.0 : 1.0;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<int> particle_counts = {5, 10, 25, 50};
+    std::vector<int> obs_counts = {2, 5};
+    int num_landmarks = 100;
+    int num_frames = 100;
+    int num_runs = 3;
+    std::vector<PF_PROPOSAL> proposals = {PF_PROPOSAL::MOTION};
+    std::string json_path = "eval_FastSLAM.json";
+    std::string csv_path;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--particles") && has_value) {
+            particle_counts = parseList(argv[++i]);
+        } else if (!strcmp(argv[i], "--obs") && has_value) {
+            obs_counts = parseList(argv[++i]);
+        } else if (!strcmp(argv[i], "--landmarks") && has_value) {
+            num_landmarks = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--frames") && has_value) {
+            num_frames = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--runs") && has_value) {
+            num_runs = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--proposal") && has_value) {
+            std::string list = argv[++i];
+            proposals.clear();
+            if (list.find("motion") != std::string::npos) {
+                proposals.push_back(PF_PROPOSAL::MOTION);
+            }
+            if (list.find("observation") != std::string::npos) {
+                proposals.push_back(PF_PROPOSAL::OBSERVATION);
+            }
+        } else if (!strcmp(argv[i], "--json") && has_value) {
+            json_path = argv[++i];
+        } else if (!strcmp(argv[i], "--csv") && has_value) {
+            csv_path = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--particles 5,10,25,50] [--obs 2,5]"
+                      << " [--landmarks <n>] [--frames <n>] [--runs <n>]"
+                      << " [--proposal motion,observation]"
+                      << " [--json <file>] [--csv <file>]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (proposals.empty()) {
+        std::cerr << "--proposal takes motion, observation or both" << std::endl;
+        return 1;
+    }
+
+    std::vector<BenchUtil::BenchResult> results;
+    for (PF_PROPOSAL proposal: proposals) {
+        for (int num_particles: particle_counts) {
+            for (int obs_per_frame: obs_counts) {
+                BenchUtil::BenchResult res{"accuracy",
+                                           {{"particles", num_particles},
+                                            {"obs_per_frame", obs_per_frame},
+                                            {"proposal", static_cast<long>(proposal)}},
+                                           1, {}, {}};
+                double pos_sq = 0.0, heading_sq = 0.0, pose_nees = 0.0;
+                double lm_rmse = 0.0, lm_nees = 0.0, spurious = 0.0, cpu_ms = 0.0;
+                int frames = 0;
+                for (int run = 0; run < num_runs; run++) {
+                    RunErrors errors = runOnce(num_particles, obs_per_frame, num_landmarks,
+                                               num_frames, proposal,
+                                               static_cast<unsigned int>(run + 1));
+                    pos_sq += errors.pos_sq_sum;
+                    heading_sq += errors.heading_sq_sum;
+                    pose_nees += errors.pose_nees_sum;
+                    frames += errors.frames;
+                    lm_rmse += errors.lm_rmse / num_runs;
+                    lm_nees += errors.lm_nees / num_runs;
+                    spurious += errors.spurious / num_runs;
+                    cpu_ms += errors.cpu_ms;
+                    res.samples_ns.insert(res.samples_ns.end(), errors.frame_ns.begin(),
+                                          errors.frame_ns.end());
+                }
+
+                res.counters["pose_rmse_m"] = sqrt(pos_sq / frames);
+                res.counters["heading_rmse_rad"] = sqrt(heading_sq / frames);
+                res.counters["pose_nees"] = pose_nees / frames;
+                res.counters["landmark_rmse_m"] = lm_rmse;
+                res.counters["landmark_nees"] = lm_nees;
+                res.counters["spurious_landmarks"] = spurious;
+                res.counters["cpu_ms_per_frame"] = cpu_ms / frames;
+                res.counters["wall_ms_per_frame"] = BenchUtil::mean(res.samples_ns) * 1e-6;
+                results.push_back(std::move(res));
+            }
+        }
+    }
+    markPareto(results);
+
+    std::cerr << std::left << std::setw(40) << "configuration" << std::right
+              << std::setw(11) << "pose m" << std::setw(11) << "pose NEES"
+              << std::setw(11) << "lm m" << std::setw(11) << "lm NEES"
+              << std::setw(11) << "spurious" << std::setw(11) << "cpu ms"
+              << std::setw(8) << "pareto" << std::endl;
+    for (auto& res: results) {
+        std::cerr << std::left << std::setw(40) << BenchUtil::fullName(res.name, res.params)
+                  << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << res.counters["pose_rmse_m"]
+                  << std::setw(11) << res.counters["pose_nees"]
+                  << std::setw(11) << res.counters["landmark_rmse_m"]
+                  << std::setw(11) << res.counters["landmark_nees"]
+                  << std::setw(11) << res.counters["spurious_landmarks"]
+                  << std::setw(11) << res.counters["cpu_ms_per_frame"]
+                  << std::setw(8) << (res.counters["pareto"] > 0 ? "*" : "") << std::endl;
+    }
+
+    if (!json_path.empty() && !BenchUtil::writeJSON(json_path, results)) {
+        std::cerr << "failed to write " << json_path << std::endl;
+        return 1;
+    }
+    if (!csv_path.empty() && !BenchUtil::writeCSV(csv_path, results)) {
+        std::cerr << "failed to write " << csv_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,372 @@
+/**
+ * @file bench-util.cpp
+ * @brief Implements benchmark statistics and result writers.
+ */
+
+#include "bench-util.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+
+namespace {
+
+/**
+ * @brief read a "<key>: <value> kB" entry from /proc/self/status
+ */
+long readProcStatusKb(const std::string& key) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, key.size(), key) == 0) {
+            std::istringstream fields(line.substr(key.size() + 1));
+            long value_kb = 0;
+            fields >> value_kb;
+            return value_kb;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief minimal JSON value, sufficient for the files written by writeJSON
+ */
+struct JsonValue {
+    enum class Type { NUL, NUMBER, STRING, ARRAY, OBJECT } type = Type::NUL;
+    double number = 0.0;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* find(const std::string& key) const {
+        for (const auto& it: members) {
+            if (it.first == key) return &it.second;
+        }
+        return nullptr;
+    }
+};
+
+/**
+ * @brief recursive-descent JSON parser; booleans are read as numbers
+ */
+class JsonParser {
+
+private:
+    const std::string& m_src;
+    size_t m_pos = 0;
+
+    void skipSpace() {
+        while (m_pos < m_src.size() && isspace(static_cast<unsigned char>(m_src[m_pos]))) {
+            m_pos++;
+        }
+    }
+
+    bool consume(char expected) {
+        skipSpace();
+        if (m_pos < m_src.size() && m_src[m_pos] == expected) {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseString(std::string& out) {
+        if (!consume('"')) return false;
+        while (m_pos < m_src.size() && m_src[m_pos] != '"') {
+            if (m_src[m_pos] == '\\' && m_pos + 1 < m_src.size()) m_pos++;
+            out += m_src[m_pos++];
+        }
+        return consume('"');
+    }
+
+public:
+    explicit JsonParser(const std::string& src): m_src(src) {}
+
+    bool parse(JsonValue& value) {
+        skipSpace();
+        if (m_pos >= m_src.size()) return false;
+
+        char next = m_src[m_pos];
+        if (next == '{') {
+            value.type = JsonValue::Type::OBJECT;
+            m_pos++;
+            if (consume('}')) return true;
+            do {
+                std::pair<std::string, JsonValue> member;
+                if (!parseString(member.first) || !consume(':') || !parse(member.second)) {
+                    return false;
+                }
+                value.members.push_back(std::move(member));
+            } while (consume(','));
+            return consume('}');
+        }
+        if (next == '[') {
+            value.type = JsonValue::Type::ARRAY;
+            m_pos++;
+            if (consume(']')) return true;
+            do {
+                value.items.emplace_back();
+                if (!parse(value.items.back())) return false;
+            } while (consume(','));
+            return consume(']');
+        }
+        if (next == '"') {
+            value.type = JsonValue::Type::STRING;
+            return parseString(value.text);
+        }
+        if (m_src.compare(m_pos, 4, "null") == 0) {
+            m_pos += 4;
+            return true;
+        }
+        if (m_src.compare(m_pos, 4, "true") == 0 || m_src.compare(m_pos, 5, "false") == 0) {
+            value.type = JsonValue::Type::NUMBER;
+            value.number = next == 't' ? 1.0 : 0.0;
+            m_pos += next == 't' ? 4 : 5;
+            return true;
+        }
+
+        const char* start = m_src.c_str() + m_pos;
+        char* end = nullptr;
+        value.type = JsonValue::Type::NUMBER;
+        value.number = strtod(start, &end);
+        if (end == start) return false;
+        m_pos += static_cast<size_t>(end - start);
+        return true;
+    }
+};
+
+double medianOf(std::vector<double>& samples) {
+    size_t mid = samples.size() / 2;
+    std::nth_element(samples.begin(), samples.begin() + mid, samples.end());
+    double upper = samples[mid];
+    if (samples.size() % 2 == 1) return upper;
+    return 0.5 * (upper + *std::max_element(samples.begin(), samples.begin() + mid));
+}
+
+} // namespace
+
+std::string BenchUtil::fullName(const std::string& name,
+                                const std::map<std::string, long>& params) {
+    std::string full = name;
+    for (const auto& it: params) {
+        full += "/" + it.first + ":" + std::to_string(it.second);
+    }
+    return full;
+}
+
+double BenchUtil::mean(const std::vector<double>& samples) {
+    if (samples.empty()) return 0.0;
+
+    double sum = 0.0;
+    for (const auto& it: samples) {
+        sum += it;
+    }
+    return sum / static_cast<double>(samples.size());
+}
+
+double BenchUtil::stddev(const std::vector<double>& samples) {
+    if (samples.size() < 2) return 0.0;
+
+    double avg = mean(samples);
+    double sq_sum = 0.0;
+    for (const auto& it: samples) {
+        sq_sum += (it - avg) * (it - avg);
+    }
+    return std::sqrt(sq_sum / static_cast<double>(samples.size() - 1));
+}
+
+double BenchUtil::percentile(std::vector<double> samples, double pct) {
+    if (samples.empty()) return 0.0;
+
+    std::sort(samples.begin(), samples.end());
+    double rank = std::ceil(pct / 100.0 * static_cast<double>(samples.size()));
+    size_t idx = rank < 1.0 ? 0 : static_cast<size_t>(rank) - 1;
+    return samples[std::min(idx, samples.size() - 1)];
+}
+
+long BenchUtil::currentRSSKb() {
+    return readProcStatusKb("VmRSS");
+}
+
+long BenchUtil::peakRSSKb() {
+    return readProcStatusKb("VmHWM");
+}
+
+bool BenchUtil::writeJSON(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& res = results[i];
+        out << "    {\"name\": \"" << fullName(res.name, res.params) << "\", "
+            << "\"kernel\": \"" << res.name << "\", \"params\": {";
+        size_t param_idx = 0;
+        for (const auto& it: res.params) {
+            out << (param_idx++ ? ", " : "") << "\"" << it.first << "\": " << it.second;
+        }
+        out << "}, \"counters\": {";
+        size_t counter_idx = 0;
+        for (const auto& it: res.counters) {
+            out << (counter_idx++ ? ", " : "") << "\"" << it.first << "\": " << it.second;
+        }
+        out << "}, \"iterations\": " << res.iterations
+            << ", \"mean_ns\": " << mean(res.samples_ns)
+            << ", \"median_ns\": " << percentile(res.samples_ns, 50.0)
+            << ", \"stddev_ns\": " << stddev(res.samples_ns)
+            << ", \"min_ns\": " << percentile(res.samples_ns, 0.0)
+            << ", \"max_ns\": " << percentile(res.samples_ns, 100.0)
+            << ", \"samples_ns\": [";
+        for (size_t j = 0; j < res.samples_ns.size(); j++) {
+            out << (j ? ", " : "") << res.samples_ns[j];
+        }
+        out << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return out.good();
+}
+
+bool BenchUtil::writeCSV(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+
+    std::set<std::string> counter_names;
+    for (const auto& res: results) {
+        for (const auto& it: res.counters) {
+            counter_names.insert(it.first);
+        }
+    }
+
+    out << "name,iterations,samples,mean_ns,median_ns,stddev_ns,min_ns,max_ns";
+    for (const auto& it: counter_names) {
+        out << "," << it;
+    }
+    out << "\n";
+    for (const auto& res: results) {
+        out << fullName(res.name, res.params) << ","
+            << res.iterations << ","
+            << res.samples_ns.size() << ","
+            << mean(res.samples_ns) << ","
+            << percentile(res.samples_ns, 50.0) << ","
+            << stddev(res.samples_ns) << ","
+            << percentile(res.samples_ns, 0.0) << ","
+            << percentile(res.samples_ns, 100.0);
+        for (const auto& it: counter_names) {
+            auto counter = res.counters.find(it);
+            out << ",";
+            if (counter != res.counters.end()) out << counter->second;
+        }
+        out << "\n";
+    }
+    return out.good();
+}
+
+bool BenchUtil::readJSON(const std::string& path, std::vector<BenchResult>& results) {
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    std::stringstream content;
+    content << in.rdbuf();
+    std::string src = content.str();
+
+    JsonValue root;
+    JsonParser parser(src);
+    if (!parser.parse(root)) return false;
+    const JsonValue* benchmarks = root.find("benchmarks");
+    if (benchmarks == nullptr || benchmarks->type != JsonValue::Type::ARRAY) return false;
+
+    for (const auto& it: benchmarks->items) {
+        const JsonValue* kernel = it.find("kernel");
+        const JsonValue* samples = it.find("samples_ns");
+        if (kernel == nullptr || samples == nullptr) return false;
+
+        BenchResult res{kernel->text, {}, 0, {}, {}};
+        if (const JsonValue* params = it.find("params")) {
+            for (const auto& param: params->members) {
+                res.params[param.first] = static_cast<long>(param.second.number);
+            }
+        }
+        if (const JsonValue* counters = it.find("counters")) {
+            for (const auto& counter: counters->members) {
+                res.counters[counter.first] = counter.second.number;
+            }
+        }
+        if (const JsonValue* iterations = it.find("iterations")) {
+            res.iterations = static_cast<long>(iterations->number);
+        }
+        for (const auto& sample: samples->items) {
+            res.samples_ns.push_back(sample.number);
+        }
+        results.push_back(std::move(res));
+    }
+    return true;
+}
+
+double BenchUtil::mannWhitneyGreaterP(const std::vector<double>& samples_a,
+                                      const std::vector<double>& samples_b) {
+    const size_t n_a = samples_a.size();
+    const size_t n_b = samples_b.size();
+    if (n_a == 0 || n_b == 0) return 1.0;
+
+    // pool and rank, averaging the ranks of ties
+    std::vector<std::pair<double, bool>> pooled;
+    pooled.reserve(n_a + n_b);
+    for (const auto& it: samples_a) pooled.push_back({it, true});
+    for (const auto& it: samples_b) pooled.push_back({it, false});
+    std::sort(pooled.begin(), pooled.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+    const double n = static_cast<double>(n_a + n_b);
+    double rank_sum_a = 0.0;
+    double tie_term = 0.0;
+    for (size_t i = 0; i < pooled.size();) {
+        size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first) j++;
+        double avg_rank = 0.5 * static_cast<double>(i + 1 + j);
+        double ties = static_cast<double>(j - i);
+        tie_term += ties * ties * ties - ties;
+        for (size_t k = i; k < j; k++) {
+            if (pooled[k].second) rank_sum_a += avg_rank;
+        }
+        i = j;
+    }
+
+    double u_a = rank_sum_a - 0.5 * static_cast<double>(n_a * (n_a + 1));
+    double mean_u = 0.5 * static_cast<double>(n_a * n_b);
+    double var_u = static_cast<double>(n_a * n_b) / 12.0 * ((n + 1.0) - tie_term / (n * (n - 1.0)));
+    if (var_u <= 0.0) return 1.0;
+
+    double z = (u_a - mean_u - 0.5) / std::sqrt(var_u);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+std::pair<double, double> BenchUtil::bootstrapMedianChangeCI(const std::vector<double>& samples_a,
+                                                             const std::vector<double>& samples_b,
+                                                             double confidence,
+                                                             int num_resamples,
+                                                             unsigned int seed) {
+    if (samples_a.empty() || samples_b.empty() || num_resamples <= 0) return {0.0, 0.0};
+
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<size_t> pick_a(0, samples_a.size() - 1);
+    std::uniform_int_distribution<size_t> pick_b(0, samples_b.size() - 1);
+    std::vector<double> draw_a(samples_a.size());
+    std::vector<double> draw_b(samples_b.size());
+    std::vector<double> changes;
+    changes.reserve(num_resamples);
+
+    for (int i = 0; i < num_resamples; i++) {
+        for (auto& it: draw_a) it = samples_a[pick_a(gen)];
+        for (auto& it: draw_b) it = samples_b[pick_b(gen)];
+        double median_b = medianOf(draw_b);
+        if (median_b <= 0.0) continue;
+        changes.push_back(medianOf(draw_a) / median_b - 1.0);
+    }
+    if (changes.empty()) return {0.0, 0.0};
+
+    double tail = 50.0 * (1.0 - confidence);
+    return {percentile(changes, tail), percentile(changes, 100.0 - tail)};
+}
@@ -0,0 +1,51 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "bench-util.h"
+#include <cstdio>
+
+TEST_CASE( "Test JSON round trip" ){
+    std::vector<BenchUtil::BenchResult> written = {
+        {"LMEKF2D::update", {}, 1024, {10.5, 11.0, 12.25}, {}},
+        {"FastSLAMPF::updateFilter", {{"particles", 50}, {"landmarks", 200}}, 1,
+         {1e6, 2e6}, {{"p99_ms", 1.9}}}
+    };
+    const std::string path = "bench_util_test_output.json";
+    REQUIRE( BenchUtil::writeJSON(path, written) );
+
+    std::vector<BenchUtil::BenchResult> read;
+    REQUIRE( BenchUtil::readJSON(path, read) );
+    std::remove(path.c_str());
+
+    REQUIRE( read.size() == 2 );
+    REQUIRE( read[0].name == "LMEKF2D::update" );
+    REQUIRE( read[0].iterations == 1024 );
+    REQUIRE( read[0].samples_ns == written[0].samples_ns );
+    REQUIRE( read[1].params.at("particles") == 50 );
+    REQUIRE( read[1].params.at("landmarks") == 200 );
+    REQUIRE_THAT( read[1].counters.at("p99_ms"), Catch::Matchers::WithinRel(1.9, 0.001) );
+    REQUIRE( BenchUtil::fullName(read[1].name, read[1].params) ==
+             "FastSLAMPF::updateFilter/landmarks:200/particles:50" );
+}
+
+TEST_CASE( "Test regression statistics" ){
+    std::vector<double> baseline = {100, 101, 99, 100, 102, 98, 100, 101, 99, 100};
+    std::vector<double> same = {101, 100, 99, 100, 98, 102, 100, 99, 101, 100};
+    std::vector<double> slower = {120, 121, 119, 120, 122, 118, 120, 121, 119, 120};
+
+    SECTION( "Mann-Whitney detects a shift only in the slower direction" ){
+        REQUIRE( BenchUtil::mannWhitneyGreaterP(slower, baseline) < 0.001 );
+        REQUIRE( BenchUtil::mannWhitneyGreaterP(baseline, slower) > 0.99 );
+        REQUIRE( BenchUtil::mannWhitneyGreaterP(same, baseline) > 0.05 );
+        REQUIRE( BenchUtil::mannWhitneyGreaterP({}, baseline) == 1.0 );
+    }
+
+    SECTION( "bootstrap interval brackets the median change" ){
+        auto ci = BenchUtil::bootstrapMedianChangeCI(slower, baseline, 0.95, 1000, 1);
+        REQUIRE( ci.first > 0.15 );
+        REQUIRE( ci.second < 0.25 );
+
+        auto ci_same = BenchUtil::bootstrapMedianChangeCI(same, baseline, 0.95, 1000, 1);
+        REQUIRE( ci_same.first <= 0.0 );
+        REQUIRE( ci_same.second >= 0.0 );
+    }
+}
@@ -0,0 +1,207 @@
+/**
+ * @file bench_compare.cpp
+ * @brief Compares a benchmark run against a stored baseline and flags regressions
+ *
+ * usage: bench_compare <baseline.json> <current.json> [--threshold <pct>]
+ *                      [--thresholds <file>] [--alpha <p>] [--method mannwhitney|bootstrap]
+ *                      [--update-baseline]
+ *
+ * Both files are produced by the benchmark executables (--json). A case regresses when
+ * its median slows down by more than its threshold and the slowdown is significant:
+ *   - mannwhitney: one-sided Mann-Whitney U p-value below alpha (default)
+ *   - bootstrap: the lower bound of the (1 - alpha) bootstrap interval of the median
+ *     change exceeds the threshold
+ *
+ * The thresholds file holds one "<name prefix> <percent>" pair per line; the longest
+ * matching prefix wins and "*" sets the default. Lines starting with '#' are ignored.
+ *
+ * If the baseline file does not exist, the current run is stored as the baseline.
+ * --update-baseline overwrites the baseline with the current run after comparing.
+ *
+ * exit status: 0 no regression, 1 regression found, 2 usage or file error
+ */
+
+#include "bench-util.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+constexpr int EXIT_REGRESSION = 1;
+constexpr int EXIT_USAGE = 2;
+constexpr int BOOTSTRAP_RESAMPLES = 2000;
+constexpr unsigned int BOOTSTRAP_SEED = 42;
+
+/**
+ * @brief per-benchmark regression thresholds, in percent
+ */
+class ThresholdTable {
+
+private:
+    double m_default_pct;
+    std::vector<std::pair<std::string, double>> m_prefixes;
+
+public:
+    explicit ThresholdTable(double default_pct): m_default_pct(default_pct) {}
+
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in.is_open()) return false;
+
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string prefix;
+            double pct;
+            if (!(fields >> prefix) || prefix[0] == '#') continue;
+            if (!(fields >> pct)) return false;
+            if (prefix == "*") {
+                m_default_pct = pct;
+            } else {
+                m_prefixes.push_back({prefix, pct});
+            }
+        }
+        return true;
+    }
+
+    double lookup(const std::string& name) const {
+        double pct = m_default_pct;
+        size_t best_len = 0;
+        for (const auto& it: m_prefixes) {
+            if (it.first.size() > best_len && name.compare(0, it.first.size(), it.first) == 0) {
+                pct = it.second;
+                best_len = it.first.size();
+            }
+        }
+        return pct;
+    }
+};
+
+int usage(const char* prog) {
+    std::cerr << "usage: " << prog << " <baseline.json> <current.json> [--threshold <pct>]"
+              << " [--thresholds <file>] [--alpha <p>] [--method mannwhitney|bootstrap]"
+              << " [--update-baseline]" << std::endl;
+    return EXIT_USAGE;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) return usage(argv[0]);
+
+    std::string baseline_path = argv[1];
+    std::string current_path = argv[2];
+    double default_pct = 5.0;
+    std::string thresholds_path;
+    double alpha = 0.05;
+    bool use_bootstrap = false;
+    bool update_baseline = false;
+
+    for (int i = 3; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--threshold") && has_value) {
+            default_pct = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--thresholds") && has_value) {
+            thresholds_path = argv[++i];
+        } else if (!strcmp(argv[i], "--alpha") && has_value) {
+            alpha = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--method") && has_value) {
+            std::string method = argv[++i];
+            if (method != "mannwhitney" && method != "bootstrap") return usage(argv[0]);
+            use_bootstrap = method == "bootstrap";
+        } else if (!strcmp(argv[i], "--update-baseline")) {
+            update_baseline = true;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    ThresholdTable thresholds(default_pct);
+    if (!thresholds_path.empty() && !thresholds.load(thresholds_path)) {
+        std::cerr << "failed to read thresholds from " << thresholds_path << std::endl;
+        return EXIT_USAGE;
+    }
+
+    std::vector<BenchUtil::BenchResult> current;
+    if (!BenchUtil::readJSON(current_path, current)) {
+        std::cerr << "failed to read " << current_path << std::endl;
+        return EXIT_USAGE;
+    }
+
+    std::vector<BenchUtil::BenchResult> baseline;
+    if (!std::ifstream(baseline_path).good()) {
+        if (!BenchUtil::writeJSON(baseline_path, current)) {
+            std::cerr << "failed to write " << baseline_path << std::endl;
+            return EXIT_USAGE;
+        }
+        std::cerr << "no baseline found, stored " << current_path << " as " << baseline_path
+                  << std::endl;
+        return 0;
+    }
+    if (!BenchUtil::readJSON(baseline_path, baseline)) {
+        std::cerr << "failed to read " << baseline_path << std::endl;
+        return EXIT_USAGE;
+    }
+
+    std::map<std::string, const BenchUtil::BenchResult*> baseline_by_name;
+    for (const auto& it: baseline) {
+        baseline_by_name[BenchUtil::fullName(it.name, it.params)] = &it;
+    }
+
+    std::cout << std::left << std::setw(64) << "benchmark" << std::right
+              << std::setw(14) << "base ns" << std::setw(14) << "new ns"
+              << std::setw(10) << "change" << std::setw(22) << "significance"
+              << std::setw(10) << "limit" << "  verdict" << std::endl;
+
+    int num_regressions = 0;
+    for (const auto& res: current) {
+        std::string name = BenchUtil::fullName(res.name, res.params);
+        auto base_it = baseline_by_name.find(name);
+        if (base_it == baseline_by_name.end()) {
+            std::cout << std::left << std::setw(64) << name << "  (new, no baseline)" << std::endl;
+            continue;
+        }
+        const BenchUtil::BenchResult& base = *base_it->second;
+
+        double base_median = BenchUtil::percentile(base.samples_ns, 50.0);
+        double new_median = BenchUtil::percentile(res.samples_ns, 50.0);
+        double change_pct = base_median > 0 ? 100.0 * (new_median / base_median - 1.0) : 0.0;
+        double limit_pct = thresholds.lookup(name);
+
+        std::ostringstream significance;
+        bool regressed;
+        if (use_bootstrap) {
+            auto ci = BenchUtil::bootstrapMedianChangeCI(res.samples_ns, base.samples_ns,
+                                                         1.0 - alpha, BOOTSTRAP_RESAMPLES,
+                                                         BOOTSTRAP_SEED);
+            significance << std::fixed << std::setprecision(1) << "CI [" << 100.0 * ci.first
+                         << ", " << 100.0 * ci.second << "]%";
+            regressed = 100.0 * ci.first > limit_pct;
+        } else {
+            double p_value = BenchUtil::mannWhitneyGreaterP(res.samples_ns, base.samples_ns);
+            significance << "p=" << std::setprecision(3) << p_value;
+            regressed = p_value < alpha && change_pct > limit_pct;
+        }
+        num_regressions += regressed ? 1 : 0;
+
+        std::cout << std::left << std::setw(64) << name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(14) << base_median
+                  << std::setw(14) << new_median
+                  << std::setw(9) << std::showpos << change_pct << "%" << std::noshowpos
+                  << std::setw(22) << significance.str()
+                  << std::setw(9) << limit_pct << "%"
+                  << "  " << (regressed ? "REGRESSION" : "ok") << std::endl;
+    }
+
+    if (update_baseline && !BenchUtil::writeJSON(baseline_path, current)) {
+        std::cerr << "failed to write " << baseline_path << std::endl;
+        return EXIT_USAGE;
+    }
+
+    std::cout << num_regressions << " regression(s)" << std::endl;
+    return num_regressions > 0 ? EXIT_REGRESSION : 0;
+}
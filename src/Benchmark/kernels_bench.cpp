@@ -0,0 +1,267 @@
+/**
+ * @file kernels_bench.cpp
+ * @brief Microbenchmarks for the EKF, data association and resampling kernels
+ *
+ * usage: bench_FastSLAM [--json <file>] [--csv <file>] [--samples <n>] [--filter <substr>]
+ *
+ * The summary table is printed to std::cerr.
+ */
+
+#include "bench-util.h"
+#include "landmark-ekf.h"
+#include "fastslam-bench.h"
+#include "particle-filter.h"
+#include "robot-manager.h"
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+constexpr float BENCH_PERCEPTUAL_RANGE = 10.0f;
+
+/**
+ * @brief builds the mock robot used by every fixture, parked at the origin
+ */
+std::shared_ptr<RobotManager2D> makeRobot() {
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0.f,
+                  0.f, 0.001f;
+    Eigen::Matrix3f process_noise;
+    process_noise << 0.01f, 0.f, 0.f,
+                     0.f, 0.01f, 0.f,
+                     0.f, 0.f, 0.001f;
+    return std::make_shared<MockManager2D>(Pose2D{.x = 0, .y = 0, .theta_rad = 0},
+                                           VelocityCommand2D{.vx_mps = 0, .wz_radps = 0},
+                                           meas_noise, BENCH_PERCEPTUAL_RANGE, process_noise);
+}
+
+/**
+ * @brief deterministic observation of the i-th of n synthetic landmarks
+ */
+struct Observation2D syntheticObs(int i, int n) {
+    float bearing = static_cast<float>(2 * M_PI * i / n - M_PI);
+    float range = 1.0f + 0.1f * static_cast<float>(i % 80);
+    return {.range_m = range, .bearing_rad = bearing, .landmarkID = std::nullopt};
+}
+
+/**
+ * @brief observation queue spawning n distinct landmarks
+ */
+std::queue<struct Observation2D> syntheticQueue(int n) {
+    std::queue<struct Observation2D> sightings;
+    for (int i = 0; i < n; i++) {
+        sightings.push(syntheticObs(i, n));
+    }
+    return sightings;
+}
+
+void printSummary(const BenchUtil::BenchResult& res) {
+    std::cerr << std::left << std::setw(56) << BenchUtil::fullName(res.name, res.params)
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << BenchUtil::percentile(res.samples_ns, 50.0)
+              << std::setw(14) << BenchUtil::stddev(res.samples_ns)
+              << std::setw(12) << res.iterations << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchUtil::BenchConfig config;
+    std::string json_path = "bench_FastSLAM.json";
+    std::string csv_path;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--json") && has_value) {
+            json_path = argv[++i];
+        } else if (!strcmp(argv[i], "--csv") && has_value) {
+            csv_path = argv[++i];
+        } else if (!strcmp(argv[i], "--samples") && has_value) {
+            config.num_samples = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--filter") && has_value) {
+            config.filter = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--json <file>] [--csv <file>] [--samples <n>] [--filter <substr>]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    std::shared_ptr<RobotManager2D> robot = makeRobot();
+    std::vector<BenchUtil::BenchResult> results;
+    auto record = [&results](BenchUtil::BenchResult&& res) {
+        if (res.samples_ns.empty()) return;
+        printSummary(res);
+        results.push_back(std::move(res));
+    };
+
+    std::cerr << std::left << std::setw(56) << "benchmark" << std::right
+              << std::setw(14) << "median ns" << std::setw(14) << "stddev ns"
+              << std::setw(12) << "iters" << std::endl;
+
+    // landmark EKF kernels
+    {
+        Eigen::Matrix2f init_cov = 0.1f * Eigen::Matrix2f::Identity();
+        LMEKF2D ekf({.x = 1.0f, .y = 1.0f}, init_cov, robot);
+        struct Observation2D obs = {.range_m = 1.45f, .bearing_rad = 0.80f};
+
+        record(BenchUtil::runBenchmark("LMEKF2D::update", {}, config, [&]() {
+            ekf.updateObservation(obs);
+            BenchUtil::doNotOptimize(ekf.update());
+        }));
+
+        // stable covariance forms, tagged by their KF_COV_FORM value
+        for (KF_COV_FORM form: {KF_COV_FORM::JOSEPH, KF_COV_FORM::SQUARE_ROOT}) {
+            LMEKF2D form_ekf({.x = 1.0f, .y = 1.0f}, init_cov, robot);
+            record(BenchUtil::runBenchmark("LMEKF2D::update", {{"form", static_cast<int>(form)}},
+                                           config, [&]() {
+                form_ekf.updateObservation(obs);
+                BenchUtil::doNotOptimize(form_ekf.update(form));
+            }));
+        }
+
+        record(BenchUtil::runBenchmark("LMEKF2D::calcCPD", {}, config, [&]() {
+            ekf.updateObservation(obs);
+            BenchUtil::doNotOptimize(ekf.calcCPD());
+        }));
+
+        // a burst of observations of one landmark: sequential updates versus information form
+        struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+        const int burst = 4;
+        LMEKF2D burst_ekf({.x = 1.0f, .y = 1.0f}, init_cov, robot);
+        record(BenchUtil::runBenchmark("LMEKF2D::burst", {{"obs", burst}, {"info", 0}}, config,
+                                       [&]() {
+            for (int i = 0; i < burst; i++) {
+                burst_ekf.updateObservation(obs);
+                BenchUtil::doNotOptimize(burst_ekf.update(origin));
+            }
+        }));
+        const Eigen::Matrix2f noise_inv = robot->getMeasNoise().inverse();
+        LMEKF2D info_ekf({.x = 1.0f, .y = 1.0f}, init_cov, robot);
+        record(BenchUtil::runBenchmark("LMEKF2D::burst", {{"obs", burst}, {"info", 1}}, config,
+                                       [&]() {
+            struct LMInformation info;
+            for (int i = 0; i < burst; i++) {
+                info_ekf.accumulate(origin, *robot, obs, noise_inv, info);
+            }
+            BenchUtil::doNotOptimize(info_ekf.applyInformation(info));
+        }));
+
+        // sightings of a converged landmark only check the innovation against the thaw gate
+        struct ConvergenceConfig convergence = {.trace_threshold = 1.0f};
+
+        // FastSLAM 1.0 sighting of the matched landmark: association, update, weighting. The
+        // update reuses the association terms, a converged landmark adds no work to them
+        for (int converged = 0; converged < 2; converged++) {
+            LMEKF2D seen_ekf({.x = 1.0f, .y = 1.0f}, init_cov, robot);
+            const struct ConvergenceConfig* policy = converged ? &convergence : nullptr;
+            record(BenchUtil::runBenchmark("LMEKF2D::sighting", {{"converged", converged}},
+                                           config, [&]() {
+                seen_ekf.updateObservation(obs);
+                BenchUtil::doNotOptimize(seen_ekf.calcCPD());
+                BenchUtil::doNotOptimize(seen_ekf.update(KF_COV_FORM::SIMPLE, policy));
+                BenchUtil::doNotOptimize(seen_ekf.calcCPD());
+            }));
+        }
+
+        for (int converged = 0; converged < 2; converged++) {
+            LMEKF2D conv_ekf({.x = 1.0f, .y = 1.0f}, init_cov, robot);
+            const struct ConvergenceConfig* policy = converged ? &convergence : nullptr;
+            record(BenchUtil::runBenchmark("LMEKF2D::update", {{"converged", converged}}, config,
+                                           [&]() {
+                conv_ekf.updateObservation(obs);
+                BenchUtil::doNotOptimize(conv_ekf.update(origin, *robot, KF_COV_FORM::SIMPLE,
+                                                         policy));
+            }));
+        }
+    }
+
+    // dimension-generic landmark EKF kernels, fixed-size per instantiation
+    {
+        struct Pose2D pose = {.x = 0, .y = 0, .theta_rad = 0};
+        PointLandmarkEKF2D point_ekf(Eigen::Vector2f(1.0f, 1.0f),
+                                     0.1f * Eigen::Matrix2f::Identity());
+        Eigen::Vector2f point_z(1.45f, 0.80f);
+        Eigen::Matrix2f point_noise = Eigen::Vector2f(0.01f, 0.001f).asDiagonal();
+
+        record(BenchUtil::runBenchmark("LandmarkEKF::update", {{"dim", 2}}, config, [&]() {
+            BenchUtil::doNotOptimize(point_ekf.update(pose, point_z, point_noise));
+        }));
+
+        PointLandmarkEKF3D point3_ekf(Eigen::Vector3f(1.0f, 1.0f, 0.5f),
+                                      0.1f * Eigen::Matrix3f::Identity());
+        Eigen::Vector3f point3_z(1.5f, 0.80f, 0.35f);
+        Eigen::Matrix3f point3_noise = Eigen::Vector3f(0.01f, 0.001f, 0.001f).asDiagonal();
+
+        record(BenchUtil::runBenchmark("LandmarkEKF::update", {{"dim", 3}}, config, [&]() {
+            BenchUtil::doNotOptimize(point3_ekf.update(pose, point3_z, point3_noise));
+        }));
+    }
+
+    // data association against a growing landmark bank
+    for (int num_landmarks: {10, 100, 1000}) {
+        // an infinite importance factor never matches, so every sighting spawns a landmark
+        FastSLAMParticles particle(FLT_MAX, {.x = 0, .y = 0, .theta_rad = 0}, robot);
+        for (int i = 0; i < num_landmarks; i++) {
+            particle.updateParticle(syntheticObs(i, num_landmarks),
+                                    {.x = 0, .y = 0, .theta_rad = 0});
+        }
+        struct Observation2D obs = syntheticObs(num_landmarks / 2, num_landmarks);
+
+        record(BenchUtil::runBenchmark("FastSLAMParticles::matchLandmark",
+                                       {{"landmarks", num_landmarks}}, config, [&]() {
+            BenchUtil::doNotOptimize(FastSLAMBench::matchLandmark(particle, obs));
+        }));
+    }
+
+    // resampling over particles carrying a fixed-size map
+    constexpr int RESAMPLE_LANDMARKS = 20;
+    for (int num_particles: {10, 100, 1000}) {
+        FastSLAMPF filter(robot, num_particles, {.x = 0, .y = 0, .theta_rad = 0}, FLT_MAX);
+        auto sightings = syntheticQueue(RESAMPLE_LANDMARKS);
+        filter.updateFilter({.x = 0, .y = 0, .theta_rad = 0}, sightings);
+
+        record(BenchUtil::runBenchmark("FastSLAMPF::reSampleParticles",
+                                       {{"particles", num_particles},
+                                        {"landmarks", RESAMPLE_LANDMARKS}}, config, [&]() {
+            FastSLAMBench::reSampleParticles(filter);
+        }));
+    }
+
+    // motion model sampling
+    {
+        FastSLAMPF filter(robot);
+        struct Pose2D mean = {.x = 1.0f, .y = 2.0f, .theta_rad = 0.5f};
+
+        record(BenchUtil::runBenchmark("FastSLAMPF::samplePose", {}, config, [&]() {
+            BenchUtil::doNotOptimize(FastSLAMBench::samplePose(filter, mean));
+        }));
+    }
+
+    // cdf table construction
+    for (int num_weights: {10, 100, 1000}) {
+        std::vector<float> pdf(num_weights, 1.0f / static_cast<float>(num_weights));
+        std::vector<float> cdf;
+        cdf.reserve(num_weights);
+
+        record(BenchUtil::runBenchmark("MathUtil::genCDF", {{"weights", num_weights}}, config,
+                                       [&]() {
+            cdf.clear();
+            BenchUtil::doNotOptimize(MathUtil::genCDF(pdf, cdf));
+        }));
+    }
+
+    if (!json_path.empty() && !BenchUtil::writeJSON(json_path, results)) {
+        std::cerr << "failed to write " << json_path << std::endl;
+        return 1;
+    }
+    if (!csv_path.empty() && !BenchUtil::writeCSV(csv_path, results)) {
+        std::cerr << "failed to write " << csv_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
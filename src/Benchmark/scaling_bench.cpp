@@ -0,0 +1,276 @@
+/**
+ * @file scaling_bench.cpp
+ * @brief End-to-end benchmark of FastSLAMPF::updateFilter over a synthetic trajectory
+ *
+ * usage: bench_FastSLAM_scaling [--particles 10,50,100] [--landmarks 50,200]
+ *                               [--obs 2,8] [--frames <n>] [--seed <n>]
+ *                               [--json <file>] [--csv <file>] [--trace <file>]
+ *                               [--deadline-us <us>] [--clutter <n>] [--staging <k>]
+ *                               [--localize]
+ *
+ * Every combination of particle count, map size and observations per frame is run
+ * on a fresh filter. Per-frame latencies are stored as the samples of each case;
+ * throughput and memory are stored as counters. With a PF_TRACING build, --trace
+ * records the whole sweep and writes it as Chrome trace-event JSON.
+ *
+ * --deadline-us enables the frame budget controller with the particle count of each case
+ * as its ceiling; the cases then also report deadline misses, the final particle count
+ * and the observations that were dropped.
+ *
+ * --clutter adds n false detections per frame. --staging stages unassociated sightings and
+ * promotes them after k sightings (FastSLAMPF::enableStaging); the cases then also report
+ * the tentative landmarks left in the staging list.
+ *
+ * --localize tracks the pose against the simulated landmarks as a fixed prior map
+ * (FastSLAMPF::enableLocalization) instead of mapping them.
+ */
+
+#include "bench-util.h"
+#include "particle-filter.h"
+#include "robot-manager.h"
+#include "sim-world.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+/**
+ * @brief parse a comma separated list of positive integers
+ */
+std::vector<int> parseList(const char* arg) {
+    std::vector<int> values;
+    std::stringstream list(arg);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        int value = atoi(item.c_str());
+        if (value > 0) values.push_back(value);
+    }
+    return values;
+}
+
+/**
+ * @brief drive a fresh filter through the synthetic world and time every frame
+ */
+BenchUtil::BenchResult runScenario(int num_particles, int num_landmarks, int obs_per_frame,
+                                   int num_frames, unsigned int seed, double deadline_us,
+                                   int clutter, int staging, bool localize) {
+    SimConfig sim_config;
+    sim_config.num_landmarks = num_landmarks;
+    sim_config.clutter_per_frame = clutter;
+    sim_config.max_obs_per_frame = obs_per_frame;
+    sim_config.seed = seed;
+    SimWorld world(sim_config);
+
+    std::shared_ptr<MockManager2D> robot = std::make_shared<MockManager2D>(
+        Pose2D{.x = 0, .y = 0, .theta_rad = 0},
+        VelocityCommand2D{.vx_mps = 0, .wz_radps = 0},
+        sim_config.meas_noise, sim_config.perceptual_range_m, sim_config.odom_noise);
+
+    long rss_before_kb = BenchUtil::currentRSSKb();
+    SimFrame first = world.step();
+    robot->setState(first.odom_pose);
+    FastSLAMPF filter(robot, num_particles, first.odom_pose, DEFAULT_IMPORTANCE_FACTOR);
+    Metrics::Registry registry;
+    Metrics::FilterMetrics metrics(registry);
+
+    BenchUtil::BenchResult result{"FastSLAMPF::updateFilter",
+                                  {{"particles", num_particles},
+                                   {"landmarks", num_landmarks},
+                                   {"obs_per_frame", obs_per_frame}},
+                                  1, {}, {}};
+    if (deadline_us > 0) {
+        struct BudgetConfig budget;
+        budget.deadline_us = deadline_us;
+        budget.min_particles = std::min(budget.min_particles,
+                                        static_cast<unsigned int>(num_particles));
+        budget.max_particles = num_particles;
+        filter.enableBudget(budget);
+        filter.attachMetrics(&metrics);
+        result.params["deadline_us"] = static_cast<long>(deadline_us);
+    }
+    if (clutter > 0) result.params["clutter"] = clutter;
+    if (staging > 0) {
+        filter.enableStaging({.min_sightings = staging});
+        result.params["staging"] = staging;
+    }
+    if (localize) {
+        std::vector<struct PriorLandmark> prior;
+        for (const auto& it: world.getLandmarks()) {
+            prior.push_back({.uid = static_cast<uint32_t>(prior.size()), .mean = it,
+                             .cov = 0.01f * Eigen::Matrix2f::Identity()});
+        }
+        filter.enableLocalization(std::make_shared<const PriorMap>(std::move(prior)));
+        result.params["localize"] = 1;
+    }
+    result.samples_ns.reserve(num_frames);
+
+    long total_obs = 0;
+    double total_ns = 0.0;
+    for (int i = 0; i < num_frames; i++) {
+        SimFrame frame = world.step();
+        robot->setState(frame.odom_pose);
+        std::queue<struct Observation2D> sightings;
+        for (const auto& it: frame.observations) {
+            sightings.push(it);
+        }
+        total_obs += static_cast<long>(frame.observations.size());
+
+        auto start = std::chrono::steady_clock::now();
+        filter.updateFilter(frame.odom_pose, sightings);
+        double frame_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+
+        result.samples_ns.push_back(frame_ns);
+        total_ns += frame_ns;
+    }
+
+    size_t set_size = filter.getWeights().size();
+    double lm_mean = 0.0;
+    for (int i = 0; i < set_size; i++) {
+        lm_mean += filter.getParticle(i).getNumLandMark();
+    }
+    lm_mean = set_size == 0 ? 0.0 : lm_mean / static_cast<double>(set_size);
+
+    result.counters["p50_ms"] = BenchUtil::percentile(result.samples_ns, 50.0) * 1e-6;
+    result.counters["p90_ms"] = BenchUtil::percentile(result.samples_ns, 90.0) * 1e-6;
+    result.counters["p99_ms"] = BenchUtil::percentile(result.samples_ns, 99.0) * 1e-6;
+    result.counters["p999_ms"] = BenchUtil::percentile(result.samples_ns, 99.9) * 1e-6;
+    result.counters["max_ms"] = BenchUtil::percentile(result.samples_ns, 100.0) * 1e-6;
+    result.counters["frames_per_s"] = total_ns > 0 ? num_frames / (total_ns * 1e-9) : 0.0;
+    result.counters["obs_per_s"] = total_ns > 0 ? total_obs / (total_ns * 1e-9) : 0.0;
+    result.counters["landmarks_per_particle"] = lm_mean;
+    result.counters["rss_delta_kb"] = BenchUtil::currentRSSKb() - rss_before_kb;
+    result.counters["peak_rss_kb"] = BenchUtil::peakRSSKb();
+    if (deadline_us > 0) {
+        long num_missed = std::count_if(result.samples_ns.begin(), result.samples_ns.end(),
+                                        [deadline_us](double ns) { return ns > deadline_us * 1e3; });
+        result.counters["deadline_miss_pct"] = 100.0 * num_missed / num_frames;
+        result.counters["final_particles"] = filter.getNumParticles();
+        result.counters["obs_shed"] = metrics.observations_shed.value();
+    }
+
+    if (staging > 0) {
+        result.counters["tentative_landmarks"] = filter.getStaging().getTentative().size();
+    }
+
+#ifdef PF_PROFILING
+    // per-stage split of the frame time
+    const Profiler::StageProfile& profile = filter.getStageProfile();
+    for (int i = 0; i < Profiler::NUM_STAGES; i++) {
+        const auto& stage = profile.stages[i];
+        if (stage.count() == 0) continue;
+        std::string name = Profiler::stageName(static_cast<Profiler::Stage>(i));
+        result.counters["stage_" + name + "_ms_per_frame"] = stage.totalNs() * 1e-6 / num_frames;
+        result.counters["stage_" + name + "_p99_us"] = stage.percentileNs(99.0) * 1e-3;
+        result.counters["stage_" + name + "_p999_us"] = stage.percentileNs(99.9) * 1e-3;
+        result.counters["stage_" + name + "_max_us"] = stage.maxNs() * 1e-3;
+    }
+#endif // PF_PROFILING
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<int> particle_counts = {10, 50, 100};
+    std::vector<int> landmark_counts = {50, 200};
+    std::vector<int> obs_counts = {2, 8};
+    int num_frames = 50;
+    unsigned int seed = 1;
+    std::string json_path = "bench_FastSLAM_scaling.json";
+    std::string csv_path;
+    std::string trace_path;
+    double deadline_us = 0.0;
+    int clutter = 0;
+    int staging = 0;
+    bool localize = false;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--particles") && has_value) {
+            particle_counts = parseList(argv[++i]);
+        } else if (!strcmp(argv[i], "--landmarks") && has_value) {
+            landmark_counts = parseList(argv[++i]);
+        } else if (!strcmp(argv[i], "--obs") && has_value) {
+            obs_counts = parseList(argv[++i]);
+        } else if (!strcmp(argv[i], "--frames") && has_value) {
+            num_frames = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--seed") && has_value) {
+            seed = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+        } else if (!strcmp(argv[i], "--json") && has_value) {
+            json_path = argv[++i];
+        } else if (!strcmp(argv[i], "--csv") && has_value) {
+            csv_path = argv[++i];
+        } else if (!strcmp(argv[i], "--trace") && has_value) {
+            trace_path = argv[++i];
+        } else if (!strcmp(argv[i], "--deadline-us") && has_value) {
+            deadline_us = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--clutter") && has_value) {
+            clutter = std::max(0, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--staging") && has_value) {
+            staging = std::max(0, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--localize")) {
+            localize = true;
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--particles 10,50,100] [--landmarks 50,200]"
+                      << " [--obs 2,8] [--frames <n>] [--seed <n>]"
+                      << " [--json <file>] [--csv <file>] [--trace <file>]"
+                      << " [--deadline-us <us>] [--clutter <n>] [--staging <k>]"
+                      << " [--localize]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cerr << std::left << std::setw(72) << "scenario" << std::right
+              << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms"
+              << std::setw(10) << "max ms" << std::setw(12) << "frames/s"
+              << std::setw(12) << "obs/s" << std::setw(12) << "rss kB" << std::endl;
+
+    if (!trace_path.empty()) {
+        Trace::setThreadName("main");
+        Trace::start();
+    }
+
+    std::vector<BenchUtil::BenchResult> results;
+    for (int num_particles: particle_counts) {
+        for (int num_landmarks: landmark_counts) {
+            for (int obs_per_frame: obs_counts) {
+                BenchUtil::BenchResult res = runScenario(num_particles, num_landmarks,
+                                                         obs_per_frame, num_frames, seed,
+                                                         deadline_us, clutter, staging,
+                                                         localize);
+                std::cerr << std::left << std::setw(72) << BenchUtil::fullName(res.name, res.params)
+                          << std::right << std::fixed << std::setprecision(2)
+                          << std::setw(10) << res.counters["p50_ms"]
+                          << std::setw(10) << res.counters["p99_ms"]
+                          << std::setw(10) << res.counters["max_ms"]
+                          << std::setw(12) << res.counters["frames_per_s"]
+                          << std::setw(12) << res.counters["obs_per_s"]
+                          << std::setw(12) << std::setprecision(0) << res.counters["rss_delta_kb"]
+                          << std::endl;
+                results.push_back(std::move(res));
+            }
+        }
+    }
+
+    if (!trace_path.empty()) {
+        Trace::stop();
+        if (!Trace::dumpChromeJson(trace_path)) {
+            std::cerr << "failed to write " << trace_path << std::endl;
+            return 1;
+        }
+    }
+    if (!json_path.empty() && !BenchUtil::writeJSON(json_path, results)) {
+        std::cerr << "failed to write " << json_path << std::endl;
+        return 1;
+    }
+    if (!csv_path.empty() && !BenchUtil::writeCSV(csv_path, results)) {
+        std::cerr << "failed to write " << csv_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file sim-world.cpp
+ * @brief Implements the synthetic landmark world
+ */
+
+#include "sim-world.h"
+#include "math-util.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float LANDMARK_SPACING_M = 2.0f;
+constexpr float MIN_WORLD_SIZE_M = 10.0f;
+
+} // namespace
+
+SimWorld::SimWorld(const SimConfig& config): m_config(config), m_gen(config.seed) {
+    if (m_config.world_size_m <= 0) {
+        m_config.world_size_m = std::max(MIN_WORLD_SIZE_M, LANDMARK_SPACING_M *
+                                         sqrtf(static_cast<float>(m_config.num_landmarks)));
+    }
+    float loop_radius = m_config.world_size_m / 4;
+    if (m_config.turn_rate_radps <= 0) {
+        m_config.turn_rate_radps = m_config.speed_mps / loop_radius;
+    }
+
+    float half_size = m_config.world_size_m / 2;
+    std::uniform_real_distribution<float> coord(-half_size, half_size);
+    m_landmarks.reserve(m_config.num_landmarks);
+    for (int i = 0; i < m_config.num_landmarks; i++) {
+        m_landmarks.push_back({.x = coord(m_gen), .y = coord(m_gen)});
+    }
+
+    m_true_pose = {.x = 0, .y = -loop_radius, .theta_rad = 0};
+    m_odom_pose = m_true_pose;
+}
+
+float SimWorld::sampleNoise(float variance) {
+    if (variance <= 0) return 0.0f;
+    std::normal_distribution<float> dist(0.0f, sqrtf(variance));
+    return dist(m_gen);
+}
+
+SimFrame SimWorld::step() {
+    SimFrame frame;
+
+    // body-frame motion increment, and its noisy odometry reading
+    float dx_body = m_config.speed_mps * m_config.dt_s;
+    float dtheta = m_config.turn_rate_radps * m_config.dt_s;
+    float odom_dx = dx_body + sampleNoise(m_config.odom_noise(0, 0));
+    float odom_dy = sampleNoise(m_config.odom_noise(1, 1));
+    float odom_dtheta = dtheta + sampleNoise(m_config.odom_noise(2, 2));
+
+    m_true_pose.x += dx_body * cosf(m_true_pose.theta_rad);
+    m_true_pose.y += dx_body * sinf(m_true_pose.theta_rad);
+    m_true_pose.theta_rad = MathUtil::wrapAngle(m_true_pose.theta_rad + dtheta);
+
+    m_odom_pose.x += odom_dx * cosf(m_odom_pose.theta_rad) - odom_dy * sinf(m_odom_pose.theta_rad);
+    m_odom_pose.y += odom_dx * sinf(m_odom_pose.theta_rad) + odom_dy * cosf(m_odom_pose.theta_rad);
+    m_odom_pose.theta_rad = MathUtil::wrapAngle(m_odom_pose.theta_rad + odom_dtheta);
+
+    frame.true_pose = m_true_pose;
+    frame.odom_pose = m_odom_pose;
+
+    // nearest landmarks within the perceptual range
+    std::vector<std::pair<float, int>> in_range;
+    for (int i = 0; i < static_cast<int>(m_landmarks.size()); i++) {
+        float dx = m_landmarks[i].x - m_true_pose.x;
+        float dy = m_landmarks[i].y - m_true_pose.y;
+        float range = sqrtf(dx * dx + dy * dy);
+        if (range <= m_config.perceptual_range_m) {
+            in_range.push_back({range, i});
+        }
+    }
+    std::sort(in_range.begin(), in_range.end());
+    if (static_cast<int>(in_range.size()) > m_config.max_obs_per_frame) {
+        in_range.resize(m_config.max_obs_per_frame);
+    }
+
+    for (const auto& it: in_range) {
+        const struct Point2D& lm = m_landmarks[it.second];
+        float bearing = atan2f(lm.y - m_true_pose.y, lm.x - m_true_pose.x) - m_true_pose.theta_rad;
+        frame.observations.push_back({
+            .range_m = it.first + sampleNoise(m_config.meas_noise(0, 0)),
+            .bearing_rad = MathUtil::wrapAngle(bearing + sampleNoise(m_config.meas_noise(1, 1))),
+            .landmarkID = std::nullopt});
+        frame.landmark_indices.push_back(it.second);
+    }
+
+    // false detections, drawn only when enabled so that clutter-free worlds replay unchanged
+    if (m_config.clutter_per_frame > 0) {
+        std::uniform_real_distribution<float> range(0.1f * m_config.perceptual_range_m,
+                                                    m_config.perceptual_range_m);
+        std::uniform_real_distribution<float> bearing(-M_PI, M_PI);
+        for (int i = 0; i < m_config.clutter_per_frame; i++) {
+            frame.observations.push_back({.range_m = range(m_gen),
+                                          .bearing_rad = bearing(m_gen),
+                                          .landmarkID = std::nullopt});
+            frame.landmark_indices.push_back(-1);
+        }
+    }
+    return frame;
+}
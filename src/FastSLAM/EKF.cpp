@@ -4,27 +4,40 @@
  */
 
 #include "EKF.h"
+#include <algorithm>
+#include <cfloat>
 
 
 LMEKF2D::LMEKF2D() {
    m_mu = { .x  = 0 , .y = 0 };
    m_sigma = Eigen::Matrix2f::Zero();
+   m_sigma_factor = Eigen::Matrix2f::Zero();
    m_curr_obs = { .range_m = 0, .bearing_rad = 0, .landmarkID = std::nullopt};
    m_robot = nullptr;
    m_meas_cov = Eigen::Matrix2f::Zero();
+   m_innovation = Eigen::Vector2f::Zero();
+   m_mahalanobis = 0;
+   m_cpd = 0;
 }
 
 LMEKF2D::LMEKF2D(struct Point2D init_obs, Eigen::Matrix2f init_cov,
                  std::shared_ptr<RobotManager2D> robot_ptr) : m_mu(init_obs),
    m_sigma(init_cov),
    m_robot(robot_ptr) {
+   m_sigma_factor = Eigen::Matrix2f::Zero();
    m_curr_obs = { .range_m = 0, .bearing_rad = 0, .landmarkID = std::nullopt};
    m_meas_cov = Eigen::Matrix2f::Zero();
+   m_innovation = Eigen::Vector2f::Zero();
+   m_mahalanobis = 0;
+   m_cpd = 0;
 }
 
 LMEKF2D::LMEKF2D(const LMEKF2D& ekf):
     m_mu(ekf.m_mu),m_sigma(ekf.m_sigma),
-    m_robot(ekf.m_robot), m_meas_cov(ekf.m_meas_cov), m_curr_obs(ekf.m_curr_obs){
+    m_sigma_factor(ekf.m_sigma_factor), m_has_factor(ekf.m_has_factor),
+    m_robot(ekf.m_robot), m_meas_cov(ekf.m_meas_cov), m_curr_obs(ekf.m_curr_obs),
+    m_innovation(ekf.m_innovation), m_mahalanobis(ekf.m_mahalanobis), m_cpd(ekf.m_cpd),
+    m_terms_fresh(ekf.m_terms_fresh), m_converged(ekf.m_converged){
 }
 
 Eigen::Matrix2f LMEKF2D::measJacobian() const {
@@ -47,22 +60,178 @@ Eigen::Matrix2f LMEKF2D::calcKalmanGain() const {
     return m_sigma * this->measJacobian() * (m_meas_cov.inverse());
 }
 
-KF_RET LMEKF2D::update() {
+KF_RET LMEKF2D::update(KF_COV_FORM form, const struct ConvergenceConfig* convergence) {
     if (m_robot == nullptr) {
         return KF_RET::EMPTY_ROBOT_MANAGER;
     }
-    this->calcMeasCov();
-    if (m_meas_cov.determinant() == 0) {
+    // the association usually left the terms of this observation already
+    bool reuse = m_terms_fresh;
+    if (!reuse) {
+        this->calcMeasCov();
+        if (m_meas_cov.determinant() == 0) {
+            return KF_RET::MATRIX_INVERSION_ERROR;
+        }
+        m_innovation = m_curr_obs - m_robot->predictMeas(m_mu);
+    }
+    bool thawed = m_converged && convergence != nullptr;
+    if (thawed) {
+        Eigen::Vector2f innovation = m_innovation;
+        innovation(1) = MathUtil::wrapAngle(innovation(1));
+        float mahalanobis = reuse && innovation == m_innovation ? m_mahalanobis :
+            innovation.dot(m_meas_cov.inverse() * innovation);
+        if (absorbConverged(innovation, mahalanobis, this->measJacobian().transpose(),
+                            convergence)) {
+            return KF_RET::SUCCESS;
+        }
+        // the thaw reopened the covariance, the innovation is unchanged
+        this->calcMeasCov();
+    }
+    Eigen::Matrix2f G_n = this->measJacobian();
+    Eigen::Matrix2f K = this->calcKalmanGain();
+
+    m_mu += K * m_innovation;
+
+    Eigen::Matrix2f H = G_n.transpose();
+    KF_RET status = correctSigma(K, H, m_robot->getMeasNoise(), form);
+    // a thawed landmark gets at least one more correction before converging again
+    if (!thawed) checkConvergence(convergence);
+    return status;
+}
+
+KF_RET LMEKF2D::correctSigma(const Eigen::Matrix2f& K, const Eigen::Matrix2f& H,
+                             const Eigen::Matrix2f& R, KF_COV_FORM form) {
+    m_terms_fresh = false;
+    if (form != KF_COV_FORM::SQUARE_ROOT) {
+        m_has_factor = false;
+        return correctCovariance(m_sigma, K, H, R, form);
+    }
+    if (!m_has_factor) {
+        Eigen::LLT<Eigen::Matrix2f> sigma_llt(m_sigma);
+        m_has_factor = sigma_llt.info() == Eigen::Success;
+        if (m_has_factor) m_sigma_factor = sigma_llt.matrixL();
+    }
+    if (m_has_factor && correctFactor(m_sigma_factor, H, R)) {
+        m_sigma = m_sigma_factor * m_sigma_factor.transpose();
+        m_sigma = 0.5f * (m_sigma + m_sigma.transpose()).eval();
+        return KF_RET::SUCCESS;
+    }
+    m_has_factor = false;
+    correctCovariance(m_sigma, K, H, R, KF_COV_FORM::JOSEPH);
+    return KF_RET::COV_FORM_FALLBACK;
+}
+
+KF_RET LMEKF2D::update(const struct Pose2D& rob_pose) {
+    if (m_robot == nullptr) {
+        return KF_RET::EMPTY_ROBOT_MANAGER;
+    }
+    return update(rob_pose, *m_robot);
+}
+
+KF_RET LMEKF2D::update(const struct Pose2D& rob_pose, RobotManager2D& observer,
+                       KF_COV_FORM form, const struct ConvergenceConfig* convergence) {
+    Eigen::Matrix2f H = observer.measJacobian(rob_pose, m_mu);
+    const Eigen::Matrix2f R = observer.getMeasNoise();
+    Eigen::Matrix2f S = H * m_sigma * H.transpose() + R;
+    float det = S.determinant();
+    if (det == 0 || !std::isfinite(det)) {
         return KF_RET::MATRIX_INVERSION_ERROR;
+    }
+    Eigen::Vector2f innovation = m_curr_obs - observer.predictMeas(rob_pose, m_mu);
+    innovation(1) = MathUtil::wrapAngle(innovation(1));
+    // m_meas_cov now belongs to another pose than the association terms
+    m_terms_fresh = false;
+    bool thawed = m_converged && convergence != nullptr;
+    if (thawed) {
+        if (absorbConverged(innovation, innovation.dot(S.inverse() * innovation), H,
+                            convergence)) {
+            m_meas_cov = S;
+            return KF_RET::SUCCESS;
+        }
+        S = H * m_sigma * H.transpose() + R;
+    }
+    m_meas_cov = S;
+
+    Eigen::Matrix2f K = m_sigma * H.transpose() * S.inverse();
+    m_mu += K * innovation;
+    KF_RET status = correctSigma(K, H, R, form);
+    if (!thawed) checkConvergence(convergence);
+    return status;
+}
+
+bool LMEKF2D::absorbConverged(const Eigen::Vector2f& innovation, float mahalanobis,
+                              const Eigen::Matrix2f& H,
+                              const struct ConvergenceConfig* convergence) {
+    if (!m_converged || convergence == nullptr) return false;
+    if (mahalanobis <= convergence->thaw_gate) return true;
+
+    // reopen the covariance by the discrepancy, so that the correction follows the landmark
+    m_converged = false;
+    m_terms_fresh = false;
+    float det = H.determinant();
+    if (det != 0 && std::isfinite(det)) {
+        Eigen::Vector2f offset = H.inverse() * innovation;
+        m_sigma += offset * offset.transpose();
     } else {
-        Eigen::Matrix2f G_n = this->measJacobian();
-        Eigen::Matrix2f K = this->calcKalmanGain();
+        m_sigma *= mahalanobis / std::max(convergence->thaw_gate, FLT_MIN);
+    }
+    m_has_factor = false;
+    return false;
+}
+
+bool LMEKF2D::absorbConverged(const struct Pose2D& rob_pose, RobotManager2D& observer,
+                              const struct Observation2D& obs,
+                              const struct ConvergenceConfig* convergence) {
+    if (!m_converged || convergence == nullptr) return false;
+    Eigen::Matrix2f H = observer.measJacobian(rob_pose, m_mu);
+    Eigen::Matrix2f S = H * m_sigma * H.transpose() + observer.getMeasNoise();
+    float det = S.determinant();
+    if (det == 0 || !std::isfinite(det)) return false;
+    Eigen::Vector2f innovation = obs - observer.predictMeas(rob_pose, m_mu);
+    innovation(1) = MathUtil::wrapAngle(innovation(1));
+    return absorbConverged(innovation, innovation.dot(S.inverse() * innovation), H,
+                           convergence);
+}
 
-        m_mu += K * ( m_curr_obs - m_robot->predictMeas(m_mu) );
-        
-        m_sigma = ( Eigen::Matrix2f::Identity() - K * G_n.transpose() ) * m_sigma;
+KF_RET LMEKF2D::fuse(const struct Point2D& mean, const Eigen::Matrix2f& cov,
+                     KF_COV_FORM form) {
+    Eigen::Matrix2f S = m_sigma + cov;
+    float det = S.determinant();
+    if (det == 0 || !std::isfinite(det)) {
+        return KF_RET::MATRIX_INVERSION_ERROR;
     }
+    Eigen::Matrix2f K = m_sigma * S.inverse();
+    m_mu += K * Eigen::Vector2f(mean.x - m_mu.x, mean.y - m_mu.y);
+    // the other estimate is a direct observation of the landmark, H = I
+    return correctSigma(K, Eigen::Matrix2f::Identity(), cov, form);
+}
 
+void LMEKF2D::accumulate(const struct Pose2D& rob_pose, RobotManager2D& observer,
+                         const struct Observation2D& obs, const Eigen::Matrix2f& noise_inv,
+                         struct LMInformation& info) const {
+    Eigen::Matrix2f H = observer.measJacobian(rob_pose, m_mu);
+    Eigen::Vector2f innovation = obs - observer.predictMeas(rob_pose, m_mu);
+    innovation(1) = MathUtil::wrapAngle(innovation(1));
+
+    Eigen::Matrix2f HtRinv = H.transpose() * noise_inv;
+    info.info_matrix += HtRinv * H;
+    info.info_vector += HtRinv * innovation;
+    info.count++;
+}
+
+KF_RET LMEKF2D::applyInformation(const struct LMInformation& info,
+                                 const struct ConvergenceConfig* convergence) {
+    if (info.count == 0) return KF_RET::SUCCESS;
+    Eigen::Matrix2f M = Eigen::Matrix2f::Identity() + info.info_matrix * m_sigma;
+    float det = M.determinant();
+    if (det == 0 || !std::isfinite(det)) {
+        return KF_RET::MATRIX_INVERSION_ERROR;
+    }
+    m_sigma = m_sigma * M.inverse();
+    m_sigma = 0.5f * (m_sigma + m_sigma.transpose()).eval();
+    m_has_factor = false;
+    m_terms_fresh = false;
+    m_mu += m_sigma * info.info_vector;
+    checkConvergence(convergence);
     return KF_RET::SUCCESS;
 }
 
@@ -70,18 +239,23 @@ float LMEKF2D::calcCPD() {
     if (m_robot == nullptr) {
         return -1.0f;
     }
+    if (m_terms_fresh) {
+        return m_cpd;
+    }
 
     this->calcMeasCov();
     if (m_meas_cov.determinant() == 0) {
         return -1.0f;
     }
 
-    Eigen::Vector2f residue = m_curr_obs - m_robot->predictMeas(m_mu);
+    m_innovation = m_curr_obs - m_robot->predictMeas(m_mu);
+    m_mahalanobis = m_innovation.dot(m_meas_cov.inverse() * m_innovation);
 
-    float weight = 1 / sqrtf( (2 * M_PI * m_meas_cov).determinant() );
-    weight = weight * expf( -0.5 * residue.transpose() * m_meas_cov.inverse() * residue );
+    m_cpd = 1 / sqrtf( (2 * M_PI * m_meas_cov).determinant() );
+    m_cpd = m_cpd * expf( -0.5f * m_mahalanobis );
+    m_terms_fresh = true;
 
-    return weight;
+    return m_cpd;
 }
 
 const struct Point2D& LMEKF2D::getLMEst() const {
@@ -89,7 +263,6 @@ const struct Point2D& LMEKF2D::getLMEst() const {
 }
 
 void LMEKF2D::updateObservation(const struct Observation2D &new_obs) {
-    std::cout << "Updating observation: range=" << new_obs.range_m 
-              << ", bearing=" << new_obs.bearing_rad << std::endl;
     m_curr_obs = new_obs;
+    m_terms_fresh = false;
 }
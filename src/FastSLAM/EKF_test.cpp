@@ -13,9 +13,9 @@ TEST_CASE("Empty EKF"){
         empty_landmark_ekf->predict();
         struct Point2D actual_res = empty_landmark_ekf->getLMEst();
 
-        REQUIRE_THAT( expected_res.x, Catch::Matchers::WithinRel(actual_res.x, 0.001f) ||
+        REQUIRE_THAT( expected_res.x, Catch::Matchers::WithinRel(actual_res.x, CoordScalar(0.001)) ||
                       Catch::Matchers::WithinAbs(actual_res.x, 0.00001f) );
-        REQUIRE_THAT( expected_res.y, Catch::Matchers::WithinRel(actual_res.y, 0.001f) ||
+        REQUIRE_THAT( expected_res.y, Catch::Matchers::WithinRel(actual_res.y, CoordScalar(0.001)) ||
                       Catch::Matchers::WithinAbs(actual_res.y, 0.00001f) );
     }
 
@@ -67,9 +67,9 @@ TEST_CASE("Non-empty EKF") {
         filled_landmark_ekf->predict();
         struct Point2D actual_res = filled_landmark_ekf->getLMEst();
 
-        REQUIRE_THAT( expected_res.x, Catch::Matchers::WithinRel(actual_res.x, 0.001f) ||
+        REQUIRE_THAT( expected_res.x, Catch::Matchers::WithinRel(actual_res.x, CoordScalar(0.001)) ||
                       Catch::Matchers::WithinAbs(actual_res.x, 0.00001f) );
-        REQUIRE_THAT( expected_res.y, Catch::Matchers::WithinRel(actual_res.y, 0.001f) ||
+        REQUIRE_THAT( expected_res.y, Catch::Matchers::WithinRel(actual_res.y, CoordScalar(0.001)) ||
                       Catch::Matchers::WithinAbs(actual_res.y, 0.00001f) );
 
     }
@@ -96,11 +96,241 @@ TEST_CASE("Non-empty EKF") {
                         0.f, 0.6667f;
         struct Point2D actual_res = filled_landmark_ekf->getLMEst();
 
-        REQUIRE_THAT(expected_state(0), Catch::Matchers::WithinRel(actual_res.x, 0.01f) ||
+        REQUIRE_THAT(expected_state(0), Catch::Matchers::WithinRel(actual_res.x, CoordScalar(0.01)) ||
                                         Catch::Matchers::WithinAbs(actual_res.x, 0.01f));
-        REQUIRE_THAT(expected_state(1), Catch::Matchers::WithinRel(actual_res.y, 0.01f) ||
+        REQUIRE_THAT(expected_state(1), Catch::Matchers::WithinRel(actual_res.y, CoordScalar(0.01)) ||
                                         Catch::Matchers::WithinAbs(actual_res.y, 0.01f));
 #endif //USE_MOCK
     }
 
 }
+
+/**
+ * @brief one Kalman covariance correction with the gain computed from sigma
+ */
+static KF_RET correctWith(Eigen::Matrix2f& sigma, const Eigen::Matrix2f& H,
+                          const Eigen::Matrix2f& R, KF_COV_FORM form) {
+    Eigen::Matrix2f S = H * sigma * H.transpose() + R;
+    Eigen::Matrix2f K = sigma * H.transpose() * S.inverse();
+    return correctCovariance(sigma, K, H, R, form);
+}
+
+TEST_CASE("Test covariance update forms") {
+    Eigen::Matrix2f prior;
+    prior << 2.0f, 0.5f,
+             0.5f, 1.0f;
+    Eigen::Matrix2f R = Eigen::Vector2f(0.1f, 0.05f).asDiagonal();
+
+    SECTION("forms agree on a well-conditioned update") {
+        Eigen::Matrix2f H;
+        H << 0.8f, 0.6f,
+             -0.3f, 0.4f;
+        Eigen::Matrix2f simple = prior, joseph = prior, sqrt_form = prior;
+        correctWith(simple, H, R, KF_COV_FORM::SIMPLE);
+        correctWith(joseph, H, R, KF_COV_FORM::JOSEPH);
+        REQUIRE( correctWith(sqrt_form, H, R, KF_COV_FORM::SQUARE_ROOT) == KF_RET::SUCCESS );
+        REQUIRE( joseph.isApprox(simple, 1e-4f) );
+        REQUIRE( sqrt_form.isApprox(simple, 1e-4f) );
+
+        // a stored factor is corrected in place, without refactoring the covariance
+        Eigen::Matrix2f L = prior.llt().matrixL();
+        REQUIRE( correctFactor(L, H, R) );
+        REQUIRE( (L * L.transpose()).isApprox(simple, 1e-4f) );
+    }
+
+    SECTION("stable forms stay symmetric positive definite under precise measurements") {
+        Eigen::Matrix2f precise = 1e-6f * Eigen::Matrix2f::Identity();
+        for (KF_COV_FORM form: {KF_COV_FORM::JOSEPH, KF_COV_FORM::SQUARE_ROOT}) {
+            Eigen::Matrix2f sigma = 1e4f * prior;
+            for (int i = 0; i < 2000; i++) {
+                float angle = 0.01f * i;
+                Eigen::Matrix2f H;
+                H << std::cos(angle), std::sin(angle),
+                     -std::sin(angle) / 5, std::cos(angle) / 5;
+                correctWith(sigma, H, precise, form);
+                REQUIRE( sigma(0, 1) == sigma(1, 0) );
+                REQUIRE( sigma.llt().info() == Eigen::Success );
+            }
+        }
+    }
+
+    SECTION("square root form falls back on a noiseless sensor") {
+        Eigen::Matrix2f fallback = prior;
+        Eigen::Matrix2f noiseless = Eigen::Matrix2f::Zero();
+        REQUIRE( correctWith(fallback, Eigen::Matrix2f::Identity(), noiseless,
+                             KF_COV_FORM::SQUARE_ROOT) == KF_RET::COV_FORM_FALLBACK );
+        REQUIRE( fallback.allFinite() );
+        REQUIRE( fallback.norm() < 1e-4f );
+
+        Eigen::Matrix2f L = prior.llt().matrixL();
+        const Eigen::Matrix2f prior_factor = L;
+        REQUIRE_FALSE( correctFactor(L, Eigen::Matrix2f::Identity().eval(), noiseless) );
+        REQUIRE( L == prior_factor );
+    }
+}
+
+#ifdef USE_MOCK
+TEST_CASE("Test square-root landmark updates") {
+    Eigen::Matrix2f meas_noise = Eigen::Vector2f(0.01f, 0.001f).asDiagonal();
+    struct Pose2D pose = {.x = 0.5f, .y = 0.2f, .theta_rad = 0.4f};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        pose, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+    Eigen::Matrix2f init_cov;
+    init_cov << 0.1f, 0.02f,
+                0.02f, 0.05f;
+    struct Observation2D obs = {.range_m = 1.6f, .bearing_rad = 0.1f};
+
+    SECTION("the stored factor tracks the Joseph covariance over many updates") {
+        LMEKF2D joseph({.x = 2, .y = 1}, init_cov, test_manager);
+        LMEKF2D sqrt_form = joseph;
+        for (int i = 0; i < 50; i++) {
+            struct Pose2D seen_from = {.x = 0.05f * i, .y = 0.2f, .theta_rad = 0.4f};
+            joseph.updateObservation(obs);
+            sqrt_form.updateObservation(obs);
+            REQUIRE( joseph.update(seen_from, *test_manager, KF_COV_FORM::JOSEPH) ==
+                     KF_RET::SUCCESS );
+            REQUIRE( sqrt_form.update(seen_from, *test_manager, KF_COV_FORM::SQUARE_ROOT) ==
+                     KF_RET::SUCCESS );
+        }
+        REQUIRE( sqrt_form.getLMCov().isApprox(joseph.getLMCov(), 1e-3f) );
+        REQUIRE( sqrt_form.getLMCov()(0, 1) == sqrt_form.getLMCov()(1, 0) );
+        REQUIRE_THAT( sqrt_form.getLMEst().x,
+                      Catch::Matchers::WithinAbs(joseph.getLMEst().x, 1e-4) );
+    }
+
+    SECTION("a noiseless sensor is corrected in Joseph form and reported") {
+        std::shared_ptr<RobotManager2D> noiseless = std::make_shared<MockManager2D>(
+            pose, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, Eigen::Matrix2f::Zero(), 10,
+            Eigen::Matrix3f::Zero());
+        LMEKF2D lm({.x = 2, .y = 1}, init_cov, noiseless);
+        lm.updateObservation(obs);
+        REQUIRE( lm.update(pose, *noiseless, KF_COV_FORM::SQUARE_ROOT) ==
+                 KF_RET::COV_FORM_FALLBACK );
+        REQUIRE( lm.getLMCov().allFinite() );
+        REQUIRE( lm.getLMCov().trace() < init_cov.trace() );
+    }
+}
+#endif //USE_MOCK
+
+#ifdef USE_MOCK
+TEST_CASE("Test information-form fusion") {
+    Eigen::Matrix2f meas_noise = Eigen::Vector2f(0.01f, 0.001f).asDiagonal();
+    struct Pose2D pose = {.x = 0.5f, .y = 0.2f, .theta_rad = 0.4f};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        pose, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+    Eigen::Matrix2f init_cov;
+    init_cov << 0.1f, 0.02f,
+                0.02f, 0.05f;
+    Eigen::Matrix2f noise_inv = meas_noise.inverse();
+    struct Observation2D obs = {.range_m = 1.6f, .bearing_rad = 0.1f};
+
+    SECTION("a single observation matches the EKF update") {
+        LMEKF2D reference({.x = 2, .y = 1}, init_cov, test_manager);
+        LMEKF2D fused = reference;
+        reference.updateObservation(obs);
+        REQUIRE( reference.update(pose) == KF_RET::SUCCESS );
+
+        struct LMInformation info;
+        fused.accumulate(pose, *test_manager, obs, noise_inv, info);
+        REQUIRE( info.count == 1 );
+        REQUIRE( fused.applyInformation(info) == KF_RET::SUCCESS );
+        REQUIRE_THAT( fused.getLMEst().x, Catch::Matchers::WithinAbs(reference.getLMEst().x, 1e-5) );
+        REQUIRE_THAT( fused.getLMEst().y, Catch::Matchers::WithinAbs(reference.getLMEst().y, 1e-5) );
+        REQUIRE( fused.getLMCov().isApprox(reference.getLMCov(), 1e-4f) );
+    }
+
+    SECTION("repeated observations add up in information form") {
+        LMEKF2D fused({.x = 2, .y = 1}, init_cov, test_manager);
+        Eigen::Matrix2f H = test_manager->measJacobian(pose, fused.getLMEst());
+        Eigen::Matrix2f expected_cov = (init_cov.inverse() +
+                                        3 * H.transpose() * noise_inv * H).inverse();
+
+        struct LMInformation info;
+        for (int i = 0; i < 3; i++) {
+            fused.accumulate(pose, *test_manager, obs, noise_inv, info);
+        }
+        REQUIRE( fused.applyInformation(info) == KF_RET::SUCCESS );
+        REQUIRE( fused.getLMCov().isApprox(expected_cov, 1e-4f) );
+        REQUIRE( fused.getLMCov()(0, 1) == fused.getLMCov()(1, 0) );
+    }
+
+    SECTION("an empty accumulator leaves the landmark unchanged") {
+        LMEKF2D fused({.x = 2, .y = 1}, init_cov, test_manager);
+        REQUIRE( fused.applyInformation(LMInformation()) == KF_RET::SUCCESS );
+        REQUIRE( fused.getLMCov() == init_cov );
+    }
+}
+
+TEST_CASE("Test converged landmarks") {
+    Eigen::Matrix2f meas_noise = Eigen::Vector2f(1e-4f, 1e-5f).asDiagonal();
+    struct Pose2D pose = {.x = 0.5f, .y = 0.2f, .theta_rad = 0.4f};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        pose, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+    struct ConvergenceConfig convergence = {.trace_threshold = 1e-3f, .thaw_gate = 9.21f};
+    LMEKF2D lm({.x = 2, .y = 1}, Eigen::Matrix2f::Identity() * 0.1f, test_manager);
+    struct Observation2D exact = test_manager->predictMeas(pose, lm.getLMEst());
+
+    while (!lm.isConverged()) {
+        lm.updateObservation(exact);
+        REQUIRE( lm.update(pose, *test_manager, KF_COV_FORM::SIMPLE, &convergence) ==
+                 KF_RET::SUCCESS );
+        REQUIRE( lm.getLMCov().trace() > 0 );
+    }
+    REQUIRE( lm.getLMCov().trace() < convergence.trace_threshold );
+    Eigen::Matrix2f converged_cov = lm.getLMCov();
+    struct Point2D converged_mean = lm.getLMEst();
+
+    SECTION("consistent sightings skip the correction") {
+        struct Observation2D nearby = {.range_m = exact.range_m + 0.005f,
+                                       .bearing_rad = exact.bearing_rad};
+        lm.updateObservation(nearby);
+        REQUIRE( lm.update(pose, *test_manager, KF_COV_FORM::SIMPLE, &convergence) ==
+                 KF_RET::SUCCESS );
+        REQUIRE( lm.isConverged() );
+        REQUIRE( lm.getLMCov() == converged_cov );
+        REQUIRE( lm.getLMEst().x == converged_mean.x );
+        REQUIRE( lm.absorbConverged(pose, *test_manager, nearby, &convergence) );
+    }
+
+    SECTION("the matched-landmark update reuses the association terms") {
+        struct Observation2D nearby = {.range_m = exact.range_m + 0.005f,
+                                       .bearing_rad = exact.bearing_rad};
+        LMEKF2D direct = lm;
+        direct.updateObservation(nearby);
+        lm.updateObservation(nearby);
+        float cpd = lm.calcCPD();
+        REQUIRE( lm.update(KF_COV_FORM::SIMPLE, &convergence) == KF_RET::SUCCESS );
+        REQUIRE( lm.isConverged() );
+        REQUIRE( lm.getLMCov() == converged_cov );
+        REQUIRE( lm.calcCPD() == cpd );
+
+        // corrections agree with and without the association, and invalidate its terms
+        REQUIRE( lm.update(KF_COV_FORM::JOSEPH) == KF_RET::SUCCESS );
+        REQUIRE( direct.update(KF_COV_FORM::JOSEPH) == KF_RET::SUCCESS );
+        REQUIRE( lm.getLMCov() == direct.getLMCov() );
+        REQUIRE( lm.getLMEst().x == direct.getLMEst().x );
+        REQUIRE( lm.getLMCov().trace() < converged_cov.trace() );
+        REQUIRE( lm.calcCPD() != cpd );
+    }
+
+    SECTION("an inconsistent sighting thaws the landmark") {
+        struct Observation2D moved = {.range_m = exact.range_m + 0.5f,
+                                      .bearing_rad = exact.bearing_rad};
+        lm.updateObservation(moved);
+        REQUIRE( lm.update(pose, *test_manager, KF_COV_FORM::SIMPLE, &convergence) ==
+                 KF_RET::SUCCESS );
+        REQUIRE_FALSE( lm.isConverged() );
+        REQUIRE( lm.getLMEst().x != converged_mean.x );
+    }
+
+    SECTION("without a policy every sighting is corrected") {
+        lm.updateObservation(exact);
+        REQUIRE( lm.update(pose, *test_manager) == KF_RET::SUCCESS );
+        REQUIRE( lm.getLMCov().trace() < converged_cov.trace() );
+        REQUIRE_FALSE( lm.absorbConverged(pose, *test_manager, exact, nullptr) );
+    }
+}
+#endif //USE_MOCK
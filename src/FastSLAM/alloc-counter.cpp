@@ -0,0 +1,91 @@
+/**
+ * @file alloc-counter.cpp
+ * @brief Replaces the global operator new/delete to count allocations per thread
+ */
+
+#include "alloc-counter.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local uint64_t t_allocations = 0;
+thread_local uint64_t t_deallocations = 0;
+thread_local uint64_t t_bytes = 0;
+
+void* countedAlloc(std::size_t size, std::size_t alignment) {
+    t_allocations++;
+    t_bytes += size;
+    if (size == 0) size = 1;
+    if (alignment <= alignof(std::max_align_t)) {
+        return malloc(size);
+    }
+    // aligned_alloc requires the size to be a multiple of the alignment
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void countedFree(void* ptr) {
+    if (ptr == nullptr) return;
+    t_deallocations++;
+    free(ptr);
+}
+
+} // namespace
+
+AllocCounter::AllocStats AllocCounter::threadStats() {
+    return {t_allocations, t_deallocations, t_bytes};
+}
+
+void* operator new(std::size_t size) {
+    void* ptr = countedAlloc(size, alignof(std::max_align_t));
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    void* ptr = countedAlloc(size, static_cast<std::size_t>(alignment));
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    countedFree(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    countedFree(ptr);
+}
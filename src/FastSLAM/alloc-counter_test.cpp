@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+#include "alloc-counter.h"
+#include "fastslam-bench.h"
+#include "logging.h"
+#include "particle-filter.h"
+#include "robot-manager.h"
+#include <memory>
+
+namespace {
+
+/**
+ * @brief noiseless-motion mock robot parked at the origin
+ */
+std::shared_ptr<RobotManager2D> makeRobot() {
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0.f,
+                  0.f, 0.001f;
+    return std::make_shared<MockManager2D>(Pose2D{.x = 0, .y = 0, .theta_rad = 0},
+                                           VelocityCommand2D{.vx_mps = 0, .wz_radps = 0},
+                                           meas_noise, 10, Eigen::Matrix3f::Zero());
+}
+
+std::queue<struct Observation2D> makeSightings() {
+    std::queue<struct Observation2D> sightings;
+    sightings.push({.range_m = 1, .bearing_rad = 0});
+    sightings.push({.range_m = 2, .bearing_rad = 1});
+    sightings.push({.range_m = 3, .bearing_rad = -1});
+    return sightings;
+}
+
+} // namespace
+
+TEST_CASE( "Test allocation counter" ){
+    AllocCounter::ScopedAllocCounter counter;
+    REQUIRE( counter.allocations() == 0 );
+
+    std::unique_ptr<int> value = std::make_unique<int>(1);
+    REQUIRE( counter.allocations() == 1 );
+    REQUIRE( counter.delta().bytes >= sizeof(int) );
+
+    value.reset();
+    REQUIRE( counter.delta().deallocations == 1 );
+}
+
+TEST_CASE( "Test log statements below the runtime level do not allocate" ){
+    AllocCounter::ScopedAllocCounter counter;
+    // compiled in regardless of PF_LOG_LEVEL, filtered by the runtime level it starts at
+    for (int level = PF_LOG_LEVEL_TRACE; level < PF_LOG_LEVEL; level++) {
+        Logging::log(static_cast<Logging::Level>(level), "filtered", "value", level);
+    }
+    REQUIRE( counter.allocations() == 0 );
+}
+
+TEST_CASE( "Test steady-state particle update does not allocate" ){
+    std::shared_ptr<RobotManager2D> robot = makeRobot();
+    FastSLAMParticles particle(0.5, {.x = 0, .y = 0, .theta_rad = 0}, robot);
+    struct Observation2D obs = {.range_m = 1, .bearing_rad = 0};
+    struct Pose2D pose = {.x = 0, .y = 0, .theta_rad = 0};
+
+    // the first sighting spawns the landmark
+    particle.updateParticle(obs, pose);
+    REQUIRE( particle.getNumLandMark() == 1 );
+
+    SECTION( "association" ){
+        AllocCounter::ScopedAllocCounter counter;
+        REQUIRE( FastSLAMBench::matchLandmark(particle, obs) == 0 );
+        REQUIRE( counter.allocations() == 0 );
+    }
+
+    SECTION( "association, update and weighting" ){
+        AllocCounter::ScopedAllocCounter counter;
+        particle.updateParticle(obs, pose);
+        REQUIRE( counter.allocations() == 0 );
+        REQUIRE( particle.getNumLandMark() == 1 );
+    }
+}
+
+TEST_CASE( "Test steady-state information fusion does not allocate" ){
+    std::shared_ptr<RobotManager2D> robot = makeRobot();
+    FastSLAMParticles particle(0.5, {.x = 0, .y = 0, .theta_rad = 0}, robot);
+    particle.setInformationFusion(true);
+    struct Pose2D pose = {.x = 0, .y = 0, .theta_rad = 0};
+    std::vector<struct Observation2D> burst = {{.range_m = 1, .bearing_rad = 0},
+                                               {.range_m = 2, .bearing_rad = 1},
+                                               {.range_m = 1.01f, .bearing_rad = 0}};
+    std::vector<int> labels;
+
+    // warm up: the landmarks are born, then the fusion scratch grows to the frame
+    particle.updateParticleProposal({burst[0], burst[1]}, pose, Eigen::Matrix3f::Zero(), labels);
+    particle.updateParticleProposal(burst, pose, Eigen::Matrix3f::Zero(), labels);
+    REQUIRE( particle.getNumLandMark() == 2 );
+
+    AllocCounter::ScopedAllocCounter counter;
+    particle.updateParticleProposal(burst, pose, Eigen::Matrix3f::Zero(), labels);
+    REQUIRE( counter.allocations() == 0 );
+    REQUIRE( labels == std::vector<int>{0, 1, 0} );
+}
+
+TEST_CASE( "Test steady-state filter update does not allocate" ){
+    FastSLAMPF filter(makeRobot(), 20, {.x = 0, .y = 0, .theta_rad = 0}, 0.5);
+    struct Pose2D pose = {.x = 0, .y = 0, .theta_rad = 0};
+
+    // warm up: landmarks are born and both particle buffers grow to their final size
+    for (int i = 0; i < 3; i++) {
+        std::queue<struct Observation2D> sightings = makeSightings();
+        filter.updateFilter(pose, sightings);
+    }
+
+    SECTION( "resample" ){
+        AllocCounter::ScopedAllocCounter counter;
+        FastSLAMBench::reSampleParticles(filter);
+        REQUIRE( counter.allocations() == 0 );
+    }
+
+    SECTION( "update" ){
+        std::queue<struct Observation2D> sightings = makeSightings();
+        AllocCounter::ScopedAllocCounter counter;
+        filter.updateFilter(pose, sightings);
+        REQUIRE( counter.allocations() == 0 );
+    }
+}
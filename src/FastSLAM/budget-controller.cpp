@@ -0,0 +1,129 @@
+/**
+ * @file budget-controller.cpp
+ * @brief implements the per-frame time budget controller
+ */
+
+#include "budget-controller.h"
+#include <algorithm>
+#include <cmath>
+
+BudgetController::BudgetController(const struct BudgetConfig& config,
+                                   unsigned int initial_particles):
+    m_config(config) {
+    m_config.min_particles = std::max(1u, config.min_particles);
+    m_config.max_particles = std::max(m_config.min_particles, config.max_particles);
+    m_config.low_water = std::min(config.low_water, config.high_water);
+    m_config.hysteresis_frames = std::max(1u, config.hysteresis_frames);
+    m_particle_budget = std::clamp(initial_particles, m_config.min_particles,
+                                   m_config.max_particles);
+}
+
+struct BudgetDecision BudgetController::update(const struct FrameCost& cost) {
+    struct BudgetDecision decision;
+    decision.overrun = cost.frame_us > m_config.deadline_us;
+
+    if (cost.num_observations > 0 && cost.num_particles > 0) {
+        m_smoothed_us = m_has_sample ? (1.0 - m_config.smoothing) * m_smoothed_us +
+                                       m_config.smoothing * cost.frame_us
+                                     : cost.frame_us;
+        if (cost.processed_observations > 0) {
+            double observation_us = cost.frame_us /
+                (static_cast<double>(cost.num_particles) * cost.processed_observations);
+            m_observation_us = m_observation_us > 0.0
+                ? (1.0 - m_config.smoothing) * m_observation_us +
+                  m_config.smoothing * observation_us
+                : observation_us;
+        }
+        m_has_sample = true;
+
+        double utilization = m_smoothed_us / m_config.deadline_us;
+        // observations cut by the in-frame deadline check mean the frame was overloaded
+        bool truncated = cost.processed_observations <
+                         std::min(cost.num_observations, m_observation_cap);
+        m_frames_over = (utilization > m_config.high_water || truncated) ? m_frames_over + 1 : 0;
+        m_frames_under = (utilization < m_config.low_water && !truncated) ? m_frames_under + 1 : 0;
+
+        if (m_frames_over >= m_config.hysteresis_frames) {
+            decision.action = shedLoad(cost);
+        } else if (m_frames_under >= m_config.hysteresis_frames) {
+            decision.action = addLoad(cost);
+        }
+        if (decision.action != PF_BUDGET_ACTION::HOLD) {
+            m_frames_over = 0;
+            m_frames_under = 0;
+        }
+    }
+
+    decision.particle_budget = m_particle_budget;
+    decision.observation_cap = m_observation_cap;
+    decision.smoothed_us = m_smoothed_us;
+    return decision;
+}
+
+PF_BUDGET_ACTION BudgetController::shedLoad(const struct FrameCost& cost) {
+    double scale = std::max(m_config.target_utilization * m_config.deadline_us / m_smoothed_us,
+                            1.0 - m_config.max_step);
+
+    // the filter may run fewer particles than budgeted, e.g. with KLD-sampling
+    unsigned int particles = std::min(m_particle_budget, cost.num_particles);
+    bool depleted = cost.effective_particles < m_config.min_effective_ratio * cost.num_particles;
+    if (particles > m_config.min_particles && !depleted) {
+        unsigned int target = static_cast<unsigned int>(std::floor(particles * scale));
+        m_particle_budget = std::clamp(target, m_config.min_particles, particles - 1);
+        // cost is roughly linear in the particle count, keep the average predictive
+        m_smoothed_us *= static_cast<double>(m_particle_budget) / cost.num_particles;
+        return PF_BUDGET_ACTION::SHRINK_PARTICLES;
+    }
+
+    unsigned int observations = cost.processed_observations;
+    if (observations > m_config.min_observations) {
+        unsigned int target = static_cast<unsigned int>(std::floor(observations * scale));
+        m_observation_cap = std::clamp(target, m_config.min_observations, observations - 1);
+        m_smoothed_us *= static_cast<double>(m_observation_cap) / observations;
+        return PF_BUDGET_ACTION::SHED_OBSERVATIONS;
+    }
+    return PF_BUDGET_ACTION::HOLD;
+}
+
+PF_BUDGET_ACTION BudgetController::addLoad(const struct FrameCost& cost) {
+    double scale = std::min(m_config.target_utilization * m_config.deadline_us / m_smoothed_us,
+                            1.0 + m_config.max_step);
+
+    if (m_observation_cap != UNLIMITED_OBSERVATIONS) {
+        unsigned int target = static_cast<unsigned int>(std::ceil(m_observation_cap * scale));
+        target = std::max(target, m_observation_cap + 1);
+        if (target >= cost.num_observations) {
+            m_observation_cap = UNLIMITED_OBSERVATIONS;
+            target = cost.num_observations;
+        } else {
+            m_observation_cap = target;
+        }
+        if (cost.processed_observations > 0) {
+            m_smoothed_us *= static_cast<double>(target) / cost.processed_observations;
+        }
+        return PF_BUDGET_ACTION::RESTORE_OBSERVATIONS;
+    }
+
+    if (m_particle_budget < m_config.max_particles) {
+        unsigned int target = static_cast<unsigned int>(std::ceil(m_particle_budget * scale));
+        target = std::clamp(target, m_particle_budget + 1, m_config.max_particles);
+        // a budget above the particles actually carried does not add cost right away
+        if (cost.num_particles >= m_particle_budget) {
+            m_smoothed_us *= static_cast<double>(target) / m_particle_budget;
+        }
+        m_particle_budget = target;
+        return PF_BUDGET_ACTION::GROW_PARTICLES;
+    }
+    return PF_BUDGET_ACTION::HOLD;
+}
+
+const char* budgetActionName(PF_BUDGET_ACTION action) {
+    switch (action) {
+        case PF_BUDGET_ACTION::HOLD: return "hold";
+        case PF_BUDGET_ACTION::SHRINK_PARTICLES: return "shrink_particles";
+        case PF_BUDGET_ACTION::GROW_PARTICLES: return "grow_particles";
+        case PF_BUDGET_ACTION::SHED_OBSERVATIONS: return "shed_observations";
+        case PF_BUDGET_ACTION::RESTORE_OBSERVATIONS: return "restore_observations";
+    }
+    return "unknown";
+}
@@ -0,0 +1,105 @@
+#include <catch2/catch_test_macros.hpp>
+#include "budget-controller.h"
+#include <algorithm>
+
+namespace {
+
+struct FrameCost frame(double frame_us, unsigned int particles, unsigned int obs,
+                       unsigned int processed, double neff) {
+    return {.frame_us = frame_us, .num_particles = particles, .num_observations = obs,
+            .processed_observations = processed, .effective_particles = neff};
+}
+
+} // namespace
+
+TEST_CASE( "Test budget controller" ){
+    BudgetConfig config;
+    config.deadline_us = 1000.0;
+    config.hysteresis_frames = 3;
+    config.smoothing = 1.0f;
+    config.min_particles = 10;
+    config.max_particles = 100;
+    config.min_observations = 2;
+    BudgetController controller(config, 40);
+    REQUIRE( controller.getParticleBudget() == 40 );
+    REQUIRE( controller.getObservationCap() == UNLIMITED_OBSERVATIONS );
+
+    SECTION( "costs inside the band hold the budgets" ){
+        for (int i = 0; i < 10; i++) {
+            BudgetDecision decision = controller.update(frame(800.0, 40, 8, 8, 40.0));
+            REQUIRE( decision.action == PF_BUDGET_ACTION::HOLD );
+            REQUIRE( decision.particle_budget == 40 );
+            REQUIRE( !decision.overrun );
+        }
+    }
+
+    SECTION( "particles shrink after the hysteresis, by at most max_step" ){
+        REQUIRE( controller.update(frame(4000.0, 40, 8, 8, 40.0)).action ==
+                 PF_BUDGET_ACTION::HOLD );
+        REQUIRE( controller.update(frame(4000.0, 40, 8, 8, 40.0)).action ==
+                 PF_BUDGET_ACTION::HOLD );
+        BudgetDecision decision = controller.update(frame(4000.0, 40, 8, 8, 40.0));
+        REQUIRE( decision.action == PF_BUDGET_ACTION::SHRINK_PARTICLES );
+        REQUIRE( decision.particle_budget == 30 );
+        REQUIRE( decision.overrun );
+        // the hysteresis starts over after every change
+        REQUIRE( controller.update(frame(4000.0, 30, 8, 8, 30.0)).action ==
+                 PF_BUDGET_ACTION::HOLD );
+    }
+
+    SECTION( "a depleted particle set sheds observations instead" ){
+        BudgetDecision decision;
+        for (int i = 0; i < 3; i++) {
+            decision = controller.update(frame(4000.0, 40, 8, 8, 2.0));
+        }
+        REQUIRE( decision.action == PF_BUDGET_ACTION::SHED_OBSERVATIONS );
+        REQUIRE( decision.particle_budget == 40 );
+        REQUIRE( decision.observation_cap == 6 );
+    }
+
+    SECTION( "both floors are respected under sustained overload" ){
+        for (int i = 0; i < 200; i++) {
+            unsigned int particles = controller.getParticleBudget();
+            unsigned int processed = std::min(8u, controller.getObservationCap());
+            controller.update(frame(1e6, particles, 8, processed, particles));
+        }
+        REQUIRE( controller.getParticleBudget() == 10 );
+        REQUIRE( controller.getObservationCap() == 2 );
+        REQUIRE( controller.update(frame(1e6, 10, 8, 2, 10.0)).action == PF_BUDGET_ACTION::HOLD );
+    }
+
+    SECTION( "observations are restored before particles grow" ){
+        for (int i = 0; i < 3; i++) {
+            controller.update(frame(4000.0, 40, 8, 8, 2.0));
+        }
+        REQUIRE( controller.getObservationCap() == 6 );
+
+        BudgetDecision decision;
+        for (int i = 0; i < 3; i++) {
+            decision = controller.update(frame(100.0, 40, 8, 6, 40.0));
+        }
+        REQUIRE( decision.action == PF_BUDGET_ACTION::RESTORE_OBSERVATIONS );
+        REQUIRE( decision.observation_cap == UNLIMITED_OBSERVATIONS );
+        REQUIRE( decision.particle_budget == 40 );
+
+        for (int i = 0; i < 3; i++) {
+            decision = controller.update(frame(100.0, 40, 8, 8, 40.0));
+        }
+        REQUIRE( decision.action == PF_BUDGET_ACTION::GROW_PARTICLES );
+        REQUIRE( decision.particle_budget == 50 );
+    }
+
+    SECTION( "frames without observations are ignored" ){
+        for (int i = 0; i < 10; i++) {
+            REQUIRE( controller.update(frame(1.0, 40, 0, 0, 40.0)).action ==
+                     PF_BUDGET_ACTION::HOLD );
+        }
+        REQUIRE( controller.getSmoothedCostUs() == 0.0 );
+        REQUIRE( controller.getObservationCostUs() == 0.0 );
+    }
+
+    SECTION( "the cost of one observation in one particle is tracked" ){
+        controller.update(frame(800.0, 40, 8, 4, 40.0));
+        REQUIRE( controller.getObservationCostUs() == 5.0 );
+    }
+}
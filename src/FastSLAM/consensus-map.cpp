@@ -0,0 +1,74 @@
+/**
+ * @file consensus-map.cpp
+ * @brief implements the weight-averaged landmark map
+ */
+
+#include "consensus-map.h"
+#include "particle-filter.h"
+#include <algorithm>
+
+namespace {
+
+bool uidLess(const struct ConsensusLandmark& lm, uint32_t uid) {
+    return lm.uid < uid;
+}
+
+} // namespace
+
+void ConsensusMap::refresh(const std::vector<FastSLAMParticles>& particles,
+                           const std::vector<WeightScalar>& weights) {
+    if (m_dirty_uids.empty()) return;
+
+    // ascending uids keep the insertions near the end of the sorted map
+    std::sort(m_dirty_uids.begin(), m_dirty_uids.end());
+    for (const auto& uid: m_dirty_uids) {
+        m_dirty_flags[uid] = 0;
+
+        // moments are taken about the first holder's estimate: the offsets are small and fit
+        // the float covariance, while the mean keeps CoordScalar precision
+        WeightScalar weight_sum = 0;
+        struct Point2D ref;
+        Eigen::Vector2f offset_sum = Eigen::Vector2f::Zero();
+        Eigen::Matrix2f second_moment_sum = Eigen::Matrix2f::Zero();
+        for (int i = 0; i < particles.size(); i++) {
+            struct Point2D lm_mean;
+            Eigen::Matrix2f lm_cov;
+            if (!particles[i].getLandmarkEstimate(uid, lm_mean, lm_cov)) continue;
+            if (weight_sum == 0) ref = lm_mean;
+            Eigen::Vector2f d(lm_mean.x - ref.x, lm_mean.y - ref.y);
+            float w = static_cast<float>(weights[i]);
+            weight_sum += weights[i];
+            offset_sum += w * d;
+            second_moment_sum += w * (lm_cov + d * d.transpose());
+        }
+
+        auto it = std::lower_bound(m_landmarks.begin(), m_landmarks.end(), uid, uidLess);
+        bool exists = it != m_landmarks.end() && it->uid == uid;
+        if (weight_sum <= 0) {
+            // no particle holds the landmark any more
+            if (exists) m_landmarks.erase(it);
+            continue;
+        }
+
+        float inv_sum = static_cast<float>(1 / weight_sum);
+        Eigen::Vector2f offset = offset_sum * inv_sum;
+        struct ConsensusLandmark entry = {
+            .uid = uid,
+            .mean = {.x = ref.x + offset(0), .y = ref.y + offset(1)},
+            .cov = second_moment_sum * inv_sum - offset * offset.transpose(),
+            .support = weight_sum};
+        if (exists) {
+            *it = entry;
+        } else {
+            m_landmarks.insert(it, entry);
+        }
+    }
+
+    m_dirty_uids.clear();
+    m_version++;
+}
+
+const struct ConsensusLandmark* ConsensusMap::find(uint32_t uid) const {
+    auto it = std::lower_bound(m_landmarks.begin(), m_landmarks.end(), uid, uidLess);
+    return it != m_landmarks.end() && it->uid == uid ? &*it : nullptr;
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "consensus-map.h"
+#include "particle-filter.h"
+#include "robot-manager.h"
+
+#ifdef USE_MOCK
+TEST_CASE( "Test consensus map" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+
+    SECTION( "landmarks are averaged by particle weight" ){
+        FastSLAMParticles first(0.5, origin, test_manager);
+        FastSLAMParticles second(0.5, origin, test_manager);
+        first.updateParticle({.range_m = 2, .bearing_rad = 0}, origin, 5);
+        second.updateParticle({.range_m = 2, .bearing_rad = 0}, {.x = 1, .y = 0, .theta_rad = 0},
+                              5);
+        second.updateParticle({.range_m = 3, .bearing_rad = 1}, origin, 6);
+        REQUIRE( second.findLandmark(6) == 1 );
+        REQUIRE( second.findLandmark(7) == -1 );
+
+        std::vector<FastSLAMParticles> particles = {first, second};
+        ConsensusMap map;
+        map.touch(6);
+        map.touch(5);
+        map.touch(5);
+        REQUIRE( map.isStale() );
+        map.refresh(particles, {0.25f, 0.75f});
+        REQUIRE( !map.isStale() );
+        REQUIRE( map.getVersion() == 1 );
+        REQUIRE( map.getLandmarks().size() == 2 );
+        REQUIRE( map.getLandmarks()[0].uid == 5 );
+
+        const ConsensusLandmark* shared = map.find(5);
+        REQUIRE( shared != nullptr );
+        REQUIRE_THAT( shared->mean.x, Catch::Matchers::WithinAbs(0.25 * 2 + 0.75 * 3, 1e-4) );
+        REQUIRE_THAT( shared->support, Catch::Matchers::WithinAbs(1.0, 1e-6) );
+        // the spread between the particles shows up in the covariance
+        REQUIRE( shared->cov(0, 0) > 0.25 * 0.75 );
+        REQUIRE_THAT( map.find(6)->support, Catch::Matchers::WithinAbs(0.75, 1e-6) );
+
+        // refreshing without touched landmarks keeps the version
+        map.refresh(particles, {0.25f, 0.75f});
+        REQUIRE( map.getVersion() == 1 );
+
+        // landmarks no particle holds any more are dropped
+        particles = {first, first};
+        map.touch(6);
+        map.refresh(particles, {0.5f, 0.5f});
+        REQUIRE( map.getVersion() == 2 );
+        REQUIRE( map.find(6) == nullptr );
+        REQUIRE( map.getLandmarks().size() == 1 );
+    }
+
+    SECTION( "the filter only recomputes landmarks it touched" ){
+        FastSLAMPF test_pf(test_manager, 20, origin, 0.5);
+        std::queue<struct Observation2D> sightings;
+        sightings.push({.range_m = 2, .bearing_rad = 0});
+        sightings.push({.range_m = 3, .bearing_rad = 1});
+        test_pf.updateFilter(origin, sightings);
+
+        const ConsensusMap& map = test_pf.getConsensusMap();
+        REQUIRE( map.getLandmarks().size() == 2 );
+        uint64_t version = map.getVersion();
+        REQUIRE( test_pf.getConsensusMap().getVersion() == version );
+
+        const ConsensusLandmark first = map.getLandmarks()[0];
+        const ConsensusLandmark second = map.getLandmarks()[1];
+        REQUIRE_THAT( first.mean.x, Catch::Matchers::WithinAbs(2.0, 1e-4) );
+        REQUIRE_THAT( first.support, Catch::Matchers::WithinAbs(1.0, 1e-5) );
+
+        sightings.push({.range_m = 2, .bearing_rad = 0});
+        test_pf.updateFilter(origin, sightings);
+        REQUIRE( test_pf.getConsensusMap().getVersion() == version + 1 );
+        REQUIRE( map.getLandmarks().size() == 2 );
+        REQUIRE( map.getLandmarks()[0].cov(0, 0) < first.cov(0, 0) );
+        REQUIRE( map.getLandmarks()[1].cov == second.cov );
+
+        // the full map recomputes every landmark into the same view
+        const ConsensusMap& full = test_pf.getFullConsensusMap();
+        REQUIRE( &full == &map );
+        REQUIRE( full.getLandmarks().size() == 2 );
+        REQUIRE( full.getLandmarks()[1].cov == second.cov );
+    }
+}
+#endif //USE_MOCK
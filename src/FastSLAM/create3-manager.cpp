@@ -55,6 +55,43 @@ Eigen::Matrix2f Create3Manager::measJacobian(const struct Point2D& mu_prev) cons
     return G;
 }
 
+struct Observation2D Create3Manager::predictMeas(const struct Pose2D& rob_pose,
+                                      const struct Point2D& lm) const {
+    float dx = lm.x - rob_pose.x;
+    float dy = lm.y - rob_pose.y;
+    float bearing = MathUtil::wrapAngle(atan2f(dy, dx) - rob_pose.theta_rad);
+
+    return {.range_m = sqrtf(dx * dx + dy * dy), .bearing_rad = bearing,
+            .landmarkID = static_cast<int>(NONE_OBS_LM::prediction)};
+}
+
+Eigen::Matrix2f Create3Manager::measJacobian(const struct Pose2D& rob_pose,
+                                  const struct Point2D& lm) const {
+    float dx = lm.x - rob_pose.x;
+    float dy = lm.y - rob_pose.y;
+    float q = dx * dx + dy * dy;
+    Eigen::Matrix2f H;
+    if (q == 0) {
+        H << NAN, NAN,
+             NAN, NAN;
+        return H;
+    }
+    float r = sqrtf(q);
+    H << dx / r, dy / r,
+         -dy / q, dx / q;
+    return H;
+}
+
+Eigen::Matrix<float, 2, 3> Create3Manager::poseJacobian(const struct Pose2D& rob_pose,
+                                             const struct Point2D& lm) const {
+    // moving the robot is the opposite of moving the landmark, turning it shifts the bearing
+    Eigen::Matrix<float, 2, 3> H;
+    H.leftCols<2>() = -measJacobian(rob_pose, lm);
+    H(0, 2) = 0;
+    H(1, 2) = -1;
+    return H;
+}
+
 Eigen::Matrix2f Create3Manager::getMeasNoise() const {
     return m_meas_noise;
 }
@@ -0,0 +1,142 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "landmark-ekf.h"
+#include "robot-manager.h"
+#include <type_traits>
+
+static_assert(!std::is_polymorphic<PointLandmarkEKF3D>::value);
+// stateless models take no storage, the 3D point model carries its sensor height
+struct PointStorage2D { Eigen::Vector2f mu; Eigen::Matrix2f sigma; };
+static_assert(sizeof(PointLandmarkEKF2D) == sizeof(PointStorage2D));
+static_assert(sizeof(PointLandmarkEKF3D) == (3 + 9 + 1) * sizeof(float));
+// equal dimensions do not make two landmark types interchangeable
+static_assert(!std::is_same<PointLandmarkEKF3D, OrientedLandmarkEKF2D>::value);
+static_assert(!std::is_convertible<PointLandmarkEKF3D, OrientedLandmarkEKF2D>::value);
+
+/**
+ * @brief compare a model jacobian against central differences of its prediction
+ */
+template <class Model>
+void checkJacobian(const Model& model, const struct Pose2D& pose,
+                   const typename Model::State& lm) {
+    using State = typename Model::State;
+    const typename Model::Jacobian H = model.jacobian(pose, lm);
+    const double step = 1e-4;
+    for (int col = 0; col < Model::state_dim; col++) {
+        State plus = lm, minus = lm;
+        plus(col) += step;
+        minus(col) -= step;
+        auto diff = model.residual(model.predict(pose, plus), model.predict(pose, minus));
+        for (int row = 0; row < Model::meas_dim; row++) {
+            REQUIRE_THAT( H(row, col), Catch::Matchers::WithinAbs(diff(row) / (2 * step), 1e-6) );
+        }
+    }
+}
+
+TEST_CASE( "Test landmark models" ){
+    struct Pose2D pose = {.x = 1, .y = -2, .theta_rad = 0.3f};
+
+    SECTION( "2D points" ){
+        LandmarkModels::PointModel2D<double> model;
+        Eigen::Vector2d lm(4, 1);
+        checkJacobian(model, pose, lm);
+        REQUIRE( model.inverse(pose, model.predict(pose, lm)).isApprox(lm, 1e-6) );
+    }
+
+    SECTION( "3D points" ){
+        LandmarkModels::PointModel3D<double> model;
+        model.sensor_height = 0.5;
+        Eigen::Vector3d lm(4, 1, 2);
+        checkJacobian(model, pose, lm);
+        Eigen::Vector3d z = model.predict(pose, lm);
+        REQUIRE( z(2) > 0 );
+        REQUIRE( model.inverse(pose, z).isApprox(lm, 1e-6) );
+    }
+
+    SECTION( "oriented 2D landmarks" ){
+        LandmarkModels::OrientedModel2D<double> model;
+        Eigen::Vector3d lm(4, 1, 3.0);
+        checkJacobian(model, pose, lm);
+        Eigen::Vector3d z = model.predict(pose, lm);
+        REQUIRE_THAT( z(2), Catch::Matchers::WithinAbs(2.7, 1e-6) );
+        REQUIRE( model.inverse(pose, z).isApprox(lm, 1e-6) );
+    }
+}
+
+TEST_CASE( "Test generic landmark EKF" ){
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    struct Pose2D moved = {.x = 2, .y = -1, .theta_rad = 1.0f};
+
+    SECTION( "a 3D landmark converges from two poses" ){
+        LandmarkModels::PointModel3D<float> model;
+        model.sensor_height = 0.3f;
+        Eigen::Vector3f truth(3, 2, 1.5f);
+        Eigen::Matrix3f noise = Eigen::Vector3f(0.01f, 0.001f, 0.001f).asDiagonal();
+
+        Eigen::Vector3f first_z = model.predict(origin, truth);
+        first_z(0) += 0.05f;
+        PointLandmarkEKF3D ekf(Eigen::Vector3f::Zero(), Eigen::Matrix3f::Identity(), model);
+        REQUIRE( ekf.initialize(origin, first_z, noise) == KF_RET::SUCCESS );
+        float initial_error = (ekf.getMean() - truth).norm();
+        float initial_trace = ekf.getCov().trace();
+
+        Eigen::Vector3f z = model.predict(moved, truth);
+        REQUIRE( ekf.likelihood(moved, z, noise) > 0 );
+        REQUIRE( ekf.update(moved, z, noise) == KF_RET::SUCCESS );
+        REQUIRE( (ekf.getMean() - truth).norm() < initial_error );
+        REQUIRE( ekf.getCov().trace() < initial_trace );
+    }
+
+    SECTION( "oriented landmarks keep their heading wrapped" ){
+        Eigen::Matrix3f noise = Eigen::Vector3f(0.01f, 0.001f, 0.1f).asDiagonal();
+        OrientedLandmarkEKF2D ekf(Eigen::Vector3f(2, 0, 3.1f), Eigen::Matrix3f::Identity());
+        // the tag is seen at -3.1, across the wrap from the estimate
+        REQUIRE( ekf.update(origin, Eigen::Vector3f(2, 0, -3.1f), noise) == KF_RET::SUCCESS );
+        REQUIRE( std::abs(ekf.getMean()(2)) > 3.1f );
+        REQUIRE( std::abs(ekf.getMean()(2)) <= static_cast<float>(M_PI) );
+    }
+
+    SECTION( "singular innovation covariance is rejected" ){
+        PointLandmarkEKF2D ekf(Eigen::Vector2f(1, 0), Eigen::Matrix2f::Zero());
+        REQUIRE( ekf.update(origin, Eigen::Vector2f(1, 0), Eigen::Matrix2f::Zero()) ==
+                 KF_RET::MATRIX_INVERSION_ERROR );
+        REQUIRE( ekf.likelihood(origin, Eigen::Vector2f(1, 0), Eigen::Matrix2f::Zero()) == -1 );
+    }
+
+    SECTION( "a measurement that does not place the landmark starts nothing" ){
+        Eigen::Matrix2f noise = Eigen::Vector2f(0.01f, 0.001f).asDiagonal();
+        PointLandmarkEKF2D ekf(Eigen::Vector2f(1, 0), 0.5f * Eigen::Matrix2f::Identity());
+        // zero range has a singular jacobian, a non-finite bearing places nothing
+        REQUIRE( ekf.initialize(origin, Eigen::Vector2f(0, 0.3f), noise) ==
+                 KF_RET::MATRIX_INVERSION_ERROR );
+        REQUIRE( ekf.initialize(origin, Eigen::Vector2f(1, NAN), noise) ==
+                 KF_RET::MATRIX_INVERSION_ERROR );
+        REQUIRE( ekf.getMean() == Eigen::Vector2f(1, 0) );
+        REQUIRE( ekf.getCov() == 0.5f * Eigen::Matrix2f::Identity() );
+    }
+}
+
+#ifdef USE_MOCK
+TEST_CASE( "Test generic 2D point EKF against LMEKF2D" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    struct Pose2D pose = {.x = 0.5f, .y = 0.2f, .theta_rad = 0.4f};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        pose, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+    Eigen::Matrix2f init_cov = 0.1f * Eigen::Matrix2f::Identity();
+
+    LMEKF2D reference({.x = 2, .y = 1}, init_cov, test_manager);
+    PointLandmarkEKF2D ekf(Eigen::Vector2f(2, 1), init_cov);
+    struct Observation2D obs = {.range_m = 1.6f, .bearing_rad = 0.1f};
+
+    reference.updateObservation(obs);
+    REQUIRE( reference.update(pose) == KF_RET::SUCCESS );
+    REQUIRE( ekf.update(pose, Eigen::Vector2f(obs.range_m, obs.bearing_rad), meas_noise) ==
+             KF_RET::SUCCESS );
+    REQUIRE_THAT( ekf.getMean()(0), Catch::Matchers::WithinAbs(reference.getLMEst().x, 1e-5) );
+    REQUIRE_THAT( ekf.getMean()(1), Catch::Matchers::WithinAbs(reference.getLMEst().y, 1e-5) );
+    REQUIRE( ekf.getCov().isApprox(reference.getLMCov(), 1e-4f) );
+}
+#endif //USE_MOCK
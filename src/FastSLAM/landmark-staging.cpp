@@ -0,0 +1,59 @@
+/**
+ * @file landmark-staging.cpp
+ * @brief implements the staging list of tentative landmarks
+ */
+
+#include "landmark-staging.h"
+#include <algorithm>
+
+void LandmarkStaging::configure(const struct StagingConfig& config) {
+    m_config = config;
+    m_config.min_sightings = std::max(config.min_sightings, 1);
+    m_config.window_frames = std::max(config.window_frames, 1);
+    m_config.gate_m = std::max(config.gate_m, 0.0f);
+}
+
+void LandmarkStaging::beginFrame() {
+    m_frame++;
+    uint64_t window = m_config.window_frames;
+    m_tentative.erase(std::remove_if(m_tentative.begin(), m_tentative.end(),
+                                     [&](const struct TentativeLandmark& lm) {
+                                         return m_frame - lm.first_frame >= window;
+                                     }),
+                      m_tentative.end());
+}
+
+bool LandmarkStaging::addSighting(const struct Point2D& position) {
+    if (m_config.min_sightings <= 1) return true;
+
+    int nearest = -1;
+    double nearest_dist2 = static_cast<double>(m_config.gate_m) * m_config.gate_m;
+    for (int i = 0; i < m_tentative.size(); i++) {
+        double dx = static_cast<double>(position.x) - m_tentative[i].position.x;
+        double dy = static_cast<double>(position.y) - m_tentative[i].position.y;
+        double dist2 = dx * dx + dy * dy;
+        if (dist2 <= nearest_dist2) {
+            nearest = i;
+            nearest_dist2 = dist2;
+        }
+    }
+
+    if (nearest < 0) {
+        m_tentative.push_back({.position = position, .sightings = 1, .first_frame = m_frame,
+                               .last_frame = m_frame});
+        return false;
+    }
+
+    struct TentativeLandmark& lm = m_tentative[nearest];
+    if (lm.last_frame == m_frame) return false;
+    lm.sightings++;
+    lm.last_frame = m_frame;
+    lm.position.x += (position.x - lm.position.x) / lm.sightings;
+    lm.position.y += (position.y - lm.position.y) / lm.sightings;
+    if (lm.sightings < m_config.min_sightings) return false;
+
+    // order does not matter, move the last entry into the slot
+    lm = m_tentative.back();
+    m_tentative.pop_back();
+    return true;
+}
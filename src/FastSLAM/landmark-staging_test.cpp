@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "landmark-staging.h"
+
+TEST_CASE( "Test landmark staging" ){
+    LandmarkStaging staging;
+    staging.configure({.min_sightings = 3, .window_frames = 4, .gate_m = 0.5f});
+
+    SECTION( "consistent sightings are promoted" ){
+        staging.beginFrame();
+        REQUIRE_FALSE( staging.addSighting({.x = 1.0f, .y = 2.0f}) );
+        staging.beginFrame();
+        REQUIRE_FALSE( staging.addSighting({.x = 1.2f, .y = 2.0f}) );
+        REQUIRE( staging.getTentative().size() == 1 );
+        REQUIRE( staging.getTentative()[0].sightings == 2 );
+        REQUIRE_THAT( staging.getTentative()[0].position.x,
+                      Catch::Matchers::WithinAbs(1.1, 1e-6) );
+        staging.beginFrame();
+        REQUIRE( staging.addSighting({.x = 1.1f, .y = 1.9f}) );
+        REQUIRE( staging.getTentative().empty() );
+    }
+
+    SECTION( "sightings within one frame count once" ){
+        staging.beginFrame();
+        REQUIRE_FALSE( staging.addSighting({.x = 1.0f, .y = 2.0f}) );
+        REQUIRE_FALSE( staging.addSighting({.x = 1.0f, .y = 2.0f}) );
+        REQUIRE_FALSE( staging.addSighting({.x = 1.0f, .y = 2.0f}) );
+        REQUIRE( staging.getTentative()[0].sightings == 1 );
+    }
+
+    SECTION( "sightings outside the gate start separate landmarks" ){
+        staging.beginFrame();
+        staging.addSighting({.x = 1.0f, .y = 2.0f});
+        staging.addSighting({.x = 1.0f, .y = 2.6f});
+        REQUIRE( staging.getTentative().size() == 2 );
+    }
+
+    SECTION( "one-off detections expire" ){
+        staging.beginFrame();
+        staging.addSighting({.x = 1.0f, .y = 2.0f});
+        for (int i = 0; i < 3; i++) {
+            staging.beginFrame();
+            REQUIRE( staging.getTentative().size() == 1 );
+        }
+        staging.beginFrame();
+        REQUIRE( staging.getTentative().empty() );
+        // a late second sighting starts over
+        REQUIRE_FALSE( staging.addSighting({.x = 1.0f, .y = 2.0f}) );
+        REQUIRE( staging.getTentative()[0].sightings == 1 );
+    }
+
+    SECTION( "a single required sighting promotes immediately" ){
+        staging.configure({.min_sightings = 0, .window_frames = 0, .gate_m = -1.0f});
+        REQUIRE( staging.getConfig().min_sightings == 1 );
+        REQUIRE( staging.getConfig().window_frames == 1 );
+        staging.beginFrame();
+        REQUIRE( staging.addSighting({.x = 1.0f, .y = 2.0f}) );
+        REQUIRE( staging.getTentative().empty() );
+    }
+}
@@ -0,0 +1,222 @@
+/**
+ * @file logging.cpp
+ * @brief Implements the log ring buffer and the background logging thread
+ */
+
+#include "logging.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr size_t RING_CAPACITY = 4096;
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds(2);
+
+/**
+ * @brief runtime level, read by every compiled-in log statement
+ * @details starts at the compile-time level, so that every compiled-in statement is
+ * emitted until setLevel raises it. Constant-initialized, so filtering a record never
+ * constructs the logger
+ */
+std::atomic<int> g_level{PF_LOG_LEVEL};
+
+/**
+ * @brief the process-wide logger; its ring and thread are created by the first submitted
+ * record
+ */
+class Logger {
+
+private:
+    std::unique_ptr<Logging::LogRing> m_ring;
+    std::atomic<uint64_t> m_pushed{0};
+    std::atomic<uint64_t> m_written{0};
+    std::once_flag m_started;
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    std::condition_variable m_drained;
+    bool m_stop = false;
+    Logging::Sink m_sink = [](const std::string& line) { std::cerr << line << "\n"; };
+
+    void run() {
+        std::unique_lock<std::mutex> guard(m_lock);
+        while (true) {
+            Logging::Record record;
+            while (m_ring->tryPop(record)) {
+                m_sink(Logging::format(record));
+                m_written.fetch_add(1, std::memory_order_release);
+            }
+            m_drained.notify_all();
+            if (m_stop) break;
+            // producers never notify, so poll; flush() and shutdown wake the thread early
+            m_wake.wait_for(guard, POLL_INTERVAL);
+        }
+    }
+
+public:
+    std::atomic<uint64_t> dropped{0};
+
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+    void submit(const Logging::Record& record) {
+        std::call_once(m_started, [this]() {
+            m_ring = std::make_unique<Logging::LogRing>(RING_CAPACITY);
+            m_thread = std::thread(&Logger::run, this);
+            m_running.store(true, std::memory_order_release);
+        });
+        if (m_ring->tryPush(record)) {
+            m_pushed.fetch_add(1, std::memory_order_release);
+        } else {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void flush() {
+        uint64_t target = m_pushed.load(std::memory_order_acquire);
+        if (!m_running.load(std::memory_order_acquire)) return;
+        std::unique_lock<std::mutex> guard(m_lock);
+        m_wake.notify_all();
+        m_drained.wait(guard, [&]() {
+            return m_written.load(std::memory_order_acquire) >= target;
+        });
+    }
+
+    void setSink(Logging::Sink sink) {
+        flush();
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_sink = std::move(sink);
+    }
+};
+
+Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+const std::chrono::steady_clock::time_point& epoch() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+} // namespace
+
+Logging::LogRing::LogRing(size_t capacity) {
+    size_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+    m_slots = std::vector<Slot>(rounded);
+    m_mask = rounded - 1;
+    for (size_t i = 0; i < rounded; i++) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool Logging::LogRing::tryPush(const Record& record) {
+    uint64_t pos = m_head.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = m_slots[pos & m_mask];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            // the slot is free for this position; claim it
+            if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.record = record;
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // the consumer has not released this slot yet: full
+            return false;
+        } else {
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool Logging::LogRing::tryPop(Record& record) {
+    Slot& slot = m_slots[m_tail & m_mask];
+    if (slot.sequence.load(std::memory_order_acquire) != m_tail + 1) return false;
+    record = slot.record;
+    slot.sequence.store(m_tail + m_slots.size(), std::memory_order_release);
+    m_tail++;
+    return true;
+}
+
+const char* Logging::levelName(Level level) {
+    switch (level) {
+        case Level::TRACE:
+            return "trace";
+        case Level::DEBUG:
+            return "debug";
+        case Level::INFO:
+            return "info";
+        case Level::WARN:
+            return "warn";
+        case Level::ERROR:
+            return "error";
+        default:
+            return "off";
+    }
+}
+
+std::string Logging::format(const Record& record) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "ts=%llu.%06llu level=",
+             static_cast<unsigned long long>(record.timestamp_ns / 1000000000),
+             static_cast<unsigned long long>(record.timestamp_ns / 1000 % 1000000));
+    std::string line = buf;
+    line += levelName(record.level);
+    line += " msg=\"";
+    line += record.message;
+    line += "\"";
+    for (int i = 0; i < record.num_fields; i++) {
+        snprintf(buf, sizeof(buf), "%g", record.fields[i].value);
+        line += " ";
+        line += record.fields[i].key;
+        line += "=";
+        line += buf;
+    }
+    return line;
+}
+
+void Logging::setSink(Sink sink) {
+    logger().setSink(std::move(sink));
+}
+
+void Logging::setLevel(Level level) {
+    g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+bool Logging::isEnabled(Level level) {
+    return static_cast<int>(level) >= g_level.load(std::memory_order_relaxed);
+}
+
+void Logging::flush() {
+    logger().flush();
+}
+
+uint64_t Logging::droppedCount() {
+    return logger().dropped.load(std::memory_order_relaxed);
+}
+
+void Logging::submit(const Record& record) {
+    logger().submit(record);
+}
+
+uint64_t Logging::nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch()).count());
+}
@@ -0,0 +1,113 @@
+#include <catch2/catch_test_macros.hpp>
+#include "logging.h"
+#include <mutex>
+#include <thread>
+
+namespace {
+
+/**
+ * @brief collects the lines written by the logging thread
+ */
+struct CapturedLines {
+    std::mutex lock;
+    std::vector<std::string> lines;
+
+    Logging::Sink sink() {
+        return [this](const std::string& line) {
+            std::lock_guard<std::mutex> guard(lock);
+            lines.push_back(line);
+        };
+    }
+};
+
+} // namespace
+
+TEST_CASE( "Test log ring" ){
+    Logging::LogRing ring(3);
+    REQUIRE( ring.capacity() == 4 );
+
+    Logging::Record record{Logging::Level::INFO, 0, "msg", 0, {}};
+    for (int i = 0; i < 4; i++) {
+        record.timestamp_ns = i;
+        REQUIRE( ring.tryPush(record) );
+    }
+    REQUIRE_FALSE( ring.tryPush(record) );
+
+    Logging::Record popped;
+    for (int i = 0; i < 4; i++) {
+        REQUIRE( ring.tryPop(popped) );
+        REQUIRE( popped.timestamp_ns == i );
+    }
+    REQUIRE_FALSE( ring.tryPop(popped) );
+
+    // slots are reused once the consumer releases them
+    REQUIRE( ring.tryPush(record) );
+    REQUIRE( ring.tryPop(popped) );
+}
+
+TEST_CASE( "Test log record format" ){
+    Logging::Record record{Logging::Level::WARN, 1500000000, "bad jacobian", 2,
+                           {{"det", 0}, {"range", 1.5}}};
+    REQUIRE( Logging::format(record) ==
+             "ts=1.500000 level=warn msg=\"bad jacobian\" det=0 range=1.5" );
+}
+
+TEST_CASE( "Test asynchronous logging" ){
+    CapturedLines captured;
+    Logging::setSink(captured.sink());
+    Logging::setLevel(Logging::Level::INFO);
+
+#if PF_LOG_LEVEL <= PF_LOG_LEVEL_WARN
+    SECTION( "records reach the sink after a flush" ){
+        PF_LOG_WARN("first", "value", 1);
+        PF_LOG_ERROR("second");
+        Logging::flush();
+        REQUIRE( captured.lines.size() == 2 );
+        REQUIRE( captured.lines[0].find("level=warn msg=\"first\" value=1") != std::string::npos );
+        REQUIRE( captured.lines[1].find("level=error msg=\"second\"") != std::string::npos );
+    }
+#endif
+
+#if PF_LOG_LEVEL <= PF_LOG_LEVEL_ERROR
+    SECTION( "the runtime level filters records" ){
+        Logging::setLevel(Logging::Level::ERROR);
+        PF_LOG_WARN("filtered");
+        PF_LOG_ERROR("kept");
+        Logging::flush();
+        REQUIRE( captured.lines.size() == 1 );
+        Logging::setLevel(Logging::Level::INFO);
+    }
+#endif
+
+#if PF_LOG_LEVEL <= PF_LOG_LEVEL_INFO
+    SECTION( "records from several threads are all delivered" ){
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; t++) {
+            workers.emplace_back([t]() {
+                for (int i = 0; i < 100; i++) {
+                    PF_LOG_INFO("worker", "thread", t, "i", i);
+                }
+            });
+        }
+        for (auto& it: workers) {
+            it.join();
+        }
+        Logging::flush();
+        REQUIRE( captured.lines.size() + Logging::droppedCount() == 400 );
+    }
+#endif
+
+#if PF_LOG_LEVEL > PF_LOG_LEVEL_TRACE
+    SECTION( "statements below the compile-time level are stripped" ){
+        Logging::setLevel(Logging::Level::TRACE);
+        int evaluated = 0;
+        PF_LOG_TRACE("stripped", "value", ++evaluated);
+        Logging::flush();
+        REQUIRE( evaluated == 0 );
+        REQUIRE( captured.lines.empty() );
+        Logging::setLevel(Logging::Level::INFO);
+    }
+#endif
+
+    Logging::setSink([](const std::string&) {});
+}
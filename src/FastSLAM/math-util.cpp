@@ -29,30 +29,83 @@ std::pair<float, float> MathUtil::bodyToWorld2D( const std::pair<float,
 
 }
 
+namespace {
+
+/**
+ * @brief per-thread generator, seeded once so that sampling stays cheap and allocation-free
+ */
+std::mt19937& threadGenerator(){
+   thread_local std::mt19937 gen{std::random_device{}()};
+   return gen;
+}
+
+} // namespace
+
 float MathUtil::sampleNormal( const float aMean, const float aVariance ){
 
    if (aVariance < 0.0) return std::numeric_limits<double>::quiet_NaN();
 
-   std::random_device rd{};
-   std::mt19937 gen{rd()};
    std::normal_distribution d{aMean, sqrtf(aVariance)};
 
-   return d(gen);
+   return d(threadGenerator());
+}
+
+template< class T >
+T MathUtil::sampleUniform( const T& aMin, const T& aMax ){
+    std::uniform_real_distribution<T> dist(aMin, aMax);
+    return dist(threadGenerator());
+}
+
+template float MathUtil::sampleUniform<float>(const float& aMin, const float& aMax);
+template double MathUtil::sampleUniform<double>(const double& aMin, const double& aMax);
+
+Eigen::Vector3f MathUtil::sampleMultivariateNormal( const Eigen::Matrix3f& aCov ){
+    Eigen::Matrix3f l_cholesky;
+    Eigen::LLT<Eigen::Matrix3f> cholSolver(aCov);
+    if (cholSolver.info()==Eigen::Success) {
+        l_cholesky = cholSolver.matrixL();
+    } else {
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> eigenSolver(aCov);
+        l_cholesky = eigenSolver.eigenvectors()
+            * eigenSolver.eigenvalues().cwiseMax(0.0f).cwiseSqrt().asDiagonal();
+    }
+    Eigen::Vector3f z;
+    for (auto& it: z){
+        it = sampleNormal(0.0f, 1.0f);
+    }
+    return l_cholesky * z;
+}
+
+float MathUtil::gaussianPdf2D( const Eigen::Vector2f& aResidual, const Eigen::Matrix2f& aCov ){
+    float det = aCov.determinant();
+    if (!(det > 0.0f)) return 0.0f;
+    float mahalanobis = aResidual.dot(aCov.inverse() * aResidual);
+    return expf(-0.5f * mahalanobis) / (2.0f * static_cast<float>(M_PI) * sqrtf(det));
+}
+
+unsigned int MathUtil::kldSampleBound( const int aNumBins, const float aEpsilon,
+                                       const float aZQuantile ){
+    if (aNumBins < 2) return 0;
+    double k = aNumBins - 1;
+    double a = 2.0 / (9.0 * k);
+    double cube = 1.0 - a + sqrt(a) * aZQuantile;
+    return static_cast<unsigned int>(ceil(k / (2.0 * aEpsilon) * cube * cube * cube));
 }
 
-float MathUtil::sampleUniform( const float& aMin, const float& aMax ){
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dist(aMin, aMax);
-    return dist(gen);
+float MathUtil::wrapAngle( const float aAngle_rad ){
+   return atan2f(sinf(aAngle_rad), cosf(aAngle_rad));
 }
 
-float MathUtil::findDist( const struct Point2D& aPointA, const struct Point2D& aPointB ){
-   return sqrtf( powf((aPointA.x - aPointB.x), 2) + powf((aPointA.y - aPointB.y), 2) );
+CoordScalar MathUtil::findDist( const struct Point2D& aPointA, const struct Point2D& aPointB ){
+   CoordScalar dx = aPointA.x - aPointB.x;
+   CoordScalar dy = aPointA.y - aPointB.y;
+   return std::sqrt( dx * dx + dy * dy );
 }
 
-float MathUtil::findDist( const struct Point2D& aLandMark, const struct Pose2D& aRobPose ){
-   return sqrtf( powf((aLandMark.x - aRobPose.x), 2) + powf((aLandMark.y - aRobPose.y), 2) );
+CoordScalar MathUtil::findDist( const struct Point2D& aLandMark, const struct Pose2D& aRobPose ){
+   CoordScalar dx = aLandMark.x - aRobPose.x;
+   CoordScalar dy = aLandMark.y - aRobPose.y;
+   return std::sqrt( dx * dx + dy * dy );
 }
 
 template< class T >
@@ -70,5 +123,7 @@ T MathUtil::genCDF( const std::vector<T>& aPdfVec, std::vector<T>& aTargetVec ){
 
 template float MathUtil::genCDF<float>(const std::vector<float> &aPdfVec,
                                        std::vector<float> &aTargetVec);
+template double MathUtil::genCDF<double>(const std::vector<double> &aPdfVec,
+                                         std::vector<double> &aTargetVec);
 template int MathUtil::genCDF<int>(const std::vector<int> &aPdfVec,
                                        std::vector<int> &aTargetVec);
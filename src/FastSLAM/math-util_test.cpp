@@ -9,9 +9,9 @@ TEST_CASE("Test overloaded 2D point addition operator") {
 
    struct Point2D res = { .x = 1.7f, .y = 1.0f };
    init += corrector;
-   REQUIRE_THAT( init.x, Catch::Matchers::WithinRel(res.x, 0.001f) ||
+   REQUIRE_THAT( init.x, Catch::Matchers::WithinRel(res.x, CoordScalar(0.001)) ||
                             Catch::Matchers::WithinAbs(res.x, 0.00001f) );
-   REQUIRE_THAT( init.y, Catch::Matchers::WithinRel(res.y, 0.001f) ||
+   REQUIRE_THAT( init.y, Catch::Matchers::WithinRel(res.y, CoordScalar(0.001)) ||
                             Catch::Matchers::WithinAbs(res.y, 0.00001f) );
 
 }
@@ -171,3 +171,15 @@ TEST_CASE( "Test CDF table generation" ){
       REQUIRE( cdf.empty() );
    }
 }
+
+TEST_CASE( "Test KLD sample bound" ){
+   REQUIRE( MathUtil::kldSampleBound(0, 0.05f, 2.326f) == 0 );
+   REQUIRE( MathUtil::kldSampleBound(1, 0.05f, 2.326f) == 0 );
+   // (1 / 0.1) * (1 - 2/9 + sqrt(2/9) * 2.326)^3 = 65.75
+   REQUIRE( MathUtil::kldSampleBound(2, 0.05f, 2.326f) == 66 );
+   // more occupied bins and a tighter bound both need more samples
+   REQUIRE( MathUtil::kldSampleBound(50, 0.05f, 2.326f) >
+            MathUtil::kldSampleBound(10, 0.05f, 2.326f) );
+   REQUIRE( MathUtil::kldSampleBound(10, 0.01f, 2.326f) >
+            MathUtil::kldSampleBound(10, 0.05f, 2.326f) );
+}
@@ -0,0 +1,176 @@
+/**
+ * @file metrics.cpp
+ * @brief Implements the metrics registry and its Prometheus text exposition
+ */
+
+#include "metrics.h"
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <set>
+
+namespace {
+
+std::string joinLabels(const std::string& lhs, const std::string& rhs) {
+    if (lhs.empty()) return rhs;
+    if (rhs.empty()) return lhs;
+    return lhs + "," + rhs;
+}
+
+} // namespace
+
+Metrics::Counter& Metrics::Registry::counter(const std::string& name, const std::string& help,
+                                             const std::string& labels) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    for (const auto& it: m_entries) {
+        if (it.type == Type::COUNTER && it.family == name && it.labels == labels) {
+            return *it.counter;
+        }
+    }
+    m_counters.emplace_back();
+    m_entries.push_back({name, labels, help, Type::COUNTER, &m_counters.back(), nullptr});
+    return m_counters.back();
+}
+
+Metrics::Gauge& Metrics::Registry::gauge(const std::string& name, const std::string& help,
+                                         const std::string& labels) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    for (const auto& it: m_entries) {
+        if (it.type == Type::GAUGE && it.family == name && it.labels == labels) {
+            return *it.gauge;
+        }
+    }
+    m_gauges.emplace_back();
+    m_entries.push_back({name, labels, help, Type::GAUGE, nullptr, &m_gauges.back()});
+    return m_gauges.back();
+}
+
+void Metrics::Registry::writePrometheus(std::ostream& out) const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    std::set<std::string> written_families;
+
+    // series of one family must be contiguous and preceded by a single HELP/TYPE pair
+    for (const auto& family: m_entries) {
+        if (!written_families.insert(family.family).second) continue;
+
+        out << "# HELP " << family.family << " " << family.help << "\n";
+        out << "# TYPE " << family.family << " "
+            << (family.type == Type::COUNTER ? "counter" : "gauge") << "\n";
+        for (const auto& it: m_entries) {
+            if (it.family != family.family) continue;
+            out << it.family;
+            if (!it.labels.empty()) out << "{" << it.labels << "}";
+            if (it.type == Type::COUNTER) {
+                out << " " << it.counter->value() << "\n";
+            } else {
+                out << " " << std::setprecision(9) << it.gauge->value() << "\n";
+            }
+        }
+    }
+}
+
+bool Metrics::Registry::writePrometheusFile(const std::string& path) const {
+    // write then rename, so a scraper never reads a half-written file
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path);
+        if (!out.is_open()) return false;
+        writePrometheus(out);
+        if (!out.good()) return false;
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+Metrics::PeriodicWriter::PeriodicWriter(const Registry& registry, const std::string& path,
+                                        std::chrono::milliseconds interval):
+    m_registry(registry), m_path(path), m_interval(interval) {
+    m_thread = std::thread(&PeriodicWriter::run, this);
+}
+
+void Metrics::PeriodicWriter::run() {
+    std::unique_lock<std::mutex> guard(m_lock);
+    while (!m_stop) {
+        m_registry.writePrometheusFile(m_path);
+        m_wake.wait_for(guard, m_interval, [this]() { return m_stop; });
+    }
+    m_registry.writePrometheusFile(m_path);
+}
+
+void Metrics::PeriodicWriter::stop() {
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+Metrics::FilterMetrics::FilterMetrics(Registry& registry, const std::string& labels):
+    frames(registry.counter("fastslam_frames_total",
+                            "Filter updates processed.", labels)),
+    observations(registry.counter("fastslam_observations_total",
+                                  "Landmark observations processed.", labels)),
+    update_seconds_us(registry.counter("fastslam_update_microseconds_total",
+                                       "Wall time spent in updateFilter.", labels)),
+    resamples(registry.counter("fastslam_resamples_total",
+                               "Particle resampling steps.", labels)),
+    assoc_matched(registry.counter("fastslam_associations_total",
+                                   "Per-particle data association outcomes.",
+                                   joinLabels(labels, "outcome=\"matched\""))),
+    assoc_new(registry.counter("fastslam_associations_total",
+                               "Per-particle data association outcomes.",
+                               joinLabels(labels, "outcome=\"new\""))),
+    assoc_rejected(registry.counter("fastslam_associations_total",
+                                    "Per-particle data association outcomes.",
+                                    joinLabels(labels, "outcome=\"rejected\""))),
+    assoc_tentative(registry.counter("fastslam_associations_total",
+                                     "Per-particle data association outcomes.",
+                                     joinLabels(labels, "outcome=\"tentative\""))),
+    matrix_inversion_failures(registry.counter("fastslam_matrix_inversion_failures_total",
+                                               "Landmark EKF updates with a singular innovation "
+                                               "covariance.", labels)),
+    landmarks_min(registry.gauge("fastslam_landmarks_per_particle",
+                                 "Landmarks tracked per particle.",
+                                 joinLabels(labels, "stat=\"min\""))),
+    landmarks_mean(registry.gauge("fastslam_landmarks_per_particle",
+                                  "Landmarks tracked per particle.",
+                                  joinLabels(labels, "stat=\"mean\""))),
+    landmarks_max(registry.gauge("fastslam_landmarks_per_particle",
+                                 "Landmarks tracked per particle.",
+                                 joinLabels(labels, "stat=\"max\""))),
+    effective_particles(registry.gauge("fastslam_effective_particles",
+                                       "Effective sample size of the particle weights before "
+                                       "resampling.", labels)),
+    particles(registry.gauge("fastslam_particles",
+                             "Particles carried after resampling.", labels)),
+    budget_hold(registry.counter("fastslam_budget_decisions_total",
+                                 "Frame budget controller decisions.",
+                                 joinLabels(labels, "action=\"hold\""))),
+    budget_shrink_particles(registry.counter("fastslam_budget_decisions_total",
+                                             "Frame budget controller decisions.",
+                                             joinLabels(labels, "action=\"shrink_particles\""))),
+    budget_grow_particles(registry.counter("fastslam_budget_decisions_total",
+                                           "Frame budget controller decisions.",
+                                           joinLabels(labels, "action=\"grow_particles\""))),
+    budget_shed_observations(registry.counter("fastslam_budget_decisions_total",
+                                              "Frame budget controller decisions.",
+                                              joinLabels(labels,
+                                                         "action=\"shed_observations\""))),
+    budget_restore_observations(registry.counter("fastslam_budget_decisions_total",
+                                                 "Frame budget controller decisions.",
+                                                 joinLabels(labels,
+                                                            "action=\"restore_observations\""))),
+    deadline_overruns(registry.counter("fastslam_deadline_overruns_total",
+                                       "Frames that exceeded the frame deadline.", labels)),
+    observations_shed(registry.counter("fastslam_observations_shed_total",
+                                       "Observations dropped to stay within the frame deadline.",
+                                       labels)),
+    frame_cost_us(registry.gauge("fastslam_frame_cost_microseconds",
+                                 "Moving average of the frame cost seen by the budget "
+                                 "controller.", labels)),
+    particle_budget(registry.gauge("fastslam_particle_budget",
+                                   "Particle count allowed by the budget controller.", labels)),
+    observation_cap(registry.gauge("fastslam_observation_cap",
+                                   "Observations processed per frame, 0 when unlimited.",
+                                   labels)) {
+}
@@ -0,0 +1,136 @@
+#include <catch2/catch_test_macros.hpp>
+#include "metrics.h"
+#include "particle-filter.h"
+#include "robot-manager.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+TEST_CASE( "Test metrics registry" ){
+    Metrics::Registry registry;
+    Metrics::Counter& frames = registry.counter("test_frames_total", "Frames.");
+    Metrics::Gauge& neff = registry.gauge("test_neff", "Effective particles.");
+
+    SECTION( "counters and gauges hold their values" ){
+        frames.inc();
+        frames.inc(4);
+        neff.set(12.5);
+        REQUIRE( frames.value() == 5 );
+        REQUIRE( neff.value() == 12.5 );
+    }
+
+    SECTION( "registering twice returns the same metric" ){
+        REQUIRE( &registry.counter("test_frames_total", "Frames.") == &frames );
+        REQUIRE( &registry.counter("test_frames_total", "Frames.", "robot=\"a\"") != &frames );
+    }
+
+    SECTION( "exposition groups labelled series under one family" ){
+        registry.counter("test_assoc_total", "Associations.", "outcome=\"new\"").inc(2);
+        registry.counter("test_assoc_total", "Associations.", "outcome=\"matched\"").inc(7);
+        frames.inc(3);
+        neff.set(4);
+
+        std::ostringstream out;
+        registry.writePrometheus(out);
+        REQUIRE( out.str() ==
+                 "# HELP test_frames_total Frames.\n"
+                 "# TYPE test_frames_total counter\n"
+                 "test_frames_total 3\n"
+                 "# HELP test_neff Effective particles.\n"
+                 "# TYPE test_neff gauge\n"
+                 "test_neff 4\n"
+                 "# HELP test_assoc_total Associations.\n"
+                 "# TYPE test_assoc_total counter\n"
+                 "test_assoc_total{outcome=\"new\"} 2\n"
+                 "test_assoc_total{outcome=\"matched\"} 7\n" );
+    }
+
+    SECTION( "the periodic writer leaves a complete file behind" ){
+        std::string path = "metrics_test.prom";
+        frames.inc(9);
+        {
+            Metrics::PeriodicWriter writer(registry, path, std::chrono::milliseconds(10));
+        }
+        std::ifstream in(path);
+        std::stringstream contents;
+        contents << in.rdbuf();
+        REQUIRE( contents.str().find("test_frames_total 9\n") != std::string::npos );
+        std::remove(path.c_str());
+    }
+}
+
+#ifdef USE_MOCK
+TEST_CASE( "Test filter metrics" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0.f,
+                  0.f, 0.001f;
+    std::shared_ptr<RobotManager2D> robot = std::make_shared<MockManager2D>(
+        Pose2D{.x = 0, .y = 0, .theta_rad = 0}, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0},
+        meas_noise, 10, Eigen::Matrix3f::Zero());
+    FastSLAMPF filter(robot, 10, {.x = 0, .y = 0, .theta_rad = 0}, 0.5);
+
+    Metrics::Registry registry;
+    Metrics::FilterMetrics metrics(registry, "robot=\"test\"");
+    filter.attachMetrics(&metrics);
+
+    for (int i = 0; i < 2; i++) {
+        std::queue<struct Observation2D> sightings;
+        sightings.push({.range_m = 1, .bearing_rad = 0});
+        sightings.push({.range_m = 2, .bearing_rad = 1});
+        filter.updateFilter({.x = 0, .y = 0, .theta_rad = 0}, sightings);
+    }
+
+    REQUIRE( metrics.frames.value() == 2 );
+    REQUIRE( metrics.observations.value() == 4 );
+    REQUIRE( metrics.resamples.value() == 2 );
+    // two landmarks are born in the first frame and re-observed in the second
+    REQUIRE( metrics.assoc_new.value() == 20 );
+    REQUIRE( metrics.assoc_matched.value() == 20 );
+    REQUIRE( metrics.assoc_rejected.value() == 0 );
+    REQUIRE( metrics.matrix_inversion_failures.value() == 0 );
+    REQUIRE( metrics.landmarks_min.value() == 2 );
+    REQUIRE( metrics.landmarks_mean.value() == 2 );
+    REQUIRE( metrics.landmarks_max.value() == 2 );
+    REQUIRE( metrics.effective_particles.value() > 9.99 );
+    REQUIRE( metrics.effective_particles.value() < 10.01 );
+    REQUIRE( metrics.particles.value() == 10 );
+
+    std::ostringstream out;
+    registry.writePrometheus(out);
+    REQUIRE( out.str().find("fastslam_associations_total{robot=\"test\",outcome=\"new\"} 20\n")
+             != std::string::npos );
+}
+
+TEST_CASE( "Test invalid sightings in the filter metrics" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0.f,
+                  0.f, 0.001f;
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    std::shared_ptr<RobotManager2D> robot = std::make_shared<MockManager2D>(
+        origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+
+    // every update path rejects the bad sighting without calling it an inversion failure
+    for (int path = 0; path < 3; path++) {
+        FastSLAMPF filter(robot, 10, origin, 0.5);
+        filter.setProposal(path == 0 ? PF_PROPOSAL::MOTION : PF_PROPOSAL::OBSERVATION);
+        Metrics::Registry registry;
+        Metrics::FilterMetrics metrics(registry);
+        filter.attachMetrics(&metrics);
+
+        if (path < 2) {
+            std::queue<struct Observation2D> sightings;
+            sightings.push({.range_m = 0, .bearing_rad = 0});
+            sightings.push({.range_m = 2, .bearing_rad = 1});
+            filter.updateFilter(origin, sightings);
+        } else {
+            filter.updateFleet({{.robot_id = 0, .pose_mean = origin,
+                                 .observations = {{.range_m = 0, .bearing_rad = 0},
+                                                  {.range_m = 2, .bearing_rad = 1}}}});
+        }
+        REQUIRE( metrics.assoc_new.value() == 10 );
+        REQUIRE( metrics.assoc_rejected.value() == 10 );
+        REQUIRE( metrics.matrix_inversion_failures.value() == 0 );
+    }
+}
+#endif // USE_MOCK
@@ -4,17 +4,21 @@
  */
 #ifdef USE_MOCK
 #include "robot-manager.h"
+#include "logging.h"
 
 void MockManager2D::sampleIMU(){
-    std::cout << m_curr_pose.x << m_curr_pose.y << m_curr_pose.theta_rad << std::endl;
+    PF_LOG_DEBUG("mock imu sample", "x", m_curr_pose.x, "y", m_curr_pose.y,
+                 "theta", m_curr_pose.theta_rad);
 }
 
 void MockManager2D::sampleLandMark() {
-    std::cout << m_curr_obs.range_m << " " << m_curr_obs.bearing_rad << std::endl;
+    PF_LOG_DEBUG("mock landmark sample", "range", m_curr_obs.range_m,
+                 "bearing", m_curr_obs.bearing_rad);
 }
 
 void MockManager2D::sampleControl() {
-    std::cout << m_curr_command.vx_mps << " " << m_curr_command.wz_radps << std::endl;
+    PF_LOG_DEBUG("mock control sample", "vx", m_curr_command.vx_mps,
+                 "wz", m_curr_command.wz_radps);
 }
 
 struct Pose2D MockManager2D::motionUpdate() {
@@ -57,6 +61,43 @@ Eigen::Matrix2f MockManager2D::measJacobian(const struct Point2D& mu_prev) const
     return G;
 }
 
+struct Observation2D MockManager2D::predictMeas(const struct Pose2D& rob_pose,
+                                      const struct Point2D& lm) const {
+    float dx = lm.x - rob_pose.x;
+    float dy = lm.y - rob_pose.y;
+    float bearing = MathUtil::wrapAngle(atan2f(dy, dx) - rob_pose.theta_rad);
+
+    return {.range_m = sqrtf(dx * dx + dy * dy), .bearing_rad = bearing,
+            .landmarkID = static_cast<int>(NONE_OBS_LM::prediction)};
+}
+
+Eigen::Matrix2f MockManager2D::measJacobian(const struct Pose2D& rob_pose,
+                                  const struct Point2D& lm) const {
+    float dx = lm.x - rob_pose.x;
+    float dy = lm.y - rob_pose.y;
+    float q = dx * dx + dy * dy;
+    Eigen::Matrix2f H;
+    if (q == 0) {
+        H << NAN, NAN,
+             NAN, NAN;
+        return H;
+    }
+    float r = sqrtf(q);
+    H << dx / r, dy / r,
+         -dy / q, dx / q;
+    return H;
+}
+
+Eigen::Matrix<float, 2, 3> MockManager2D::poseJacobian(const struct Pose2D& rob_pose,
+                                             const struct Point2D& lm) const {
+    // moving the robot is the opposite of moving the landmark, turning it shifts the bearing
+    Eigen::Matrix<float, 2, 3> H;
+    H.leftCols<2>() = -measJacobian(rob_pose, lm);
+    H(0, 2) = 0;
+    H(1, 2) = -1;
+    return H;
+}
+
 struct Point2D MockManager2D::inverseMeas(const struct Pose2D& rob_pose,
                            const struct Observation2D& curr_obs) const {
     float x = curr_obs.range_m * cosf( curr_obs.bearing_rad + rob_pose.theta_rad );
@@ -18,9 +18,9 @@ TEST_CASE( "Test MockManager Numerical Sim" ) {
     SECTION( "MockManager: Test Motion Update" ){
         struct Pose2D expected = { .x = 1, .y = 0, .theta_rad = 0 };
         auto res = test_manager->motionUpdate();
-        REQUIRE_THAT( res.x, Catch::Matchers::WithinRel(expected.x, 0.001f) ||
+        REQUIRE_THAT( res.x, Catch::Matchers::WithinRel(expected.x, CoordScalar(0.001)) ||
                       Catch::Matchers::WithinAbs(expected.x, 0.00001f) );
-        REQUIRE_THAT( res.y, Catch::Matchers::WithinRel(expected.y, 0.001f) ||
+        REQUIRE_THAT( res.y, Catch::Matchers::WithinRel(expected.y, CoordScalar(0.001)) ||
                       Catch::Matchers::WithinAbs(expected.y, 0.00001f) );
         REQUIRE_THAT( res.theta_rad, Catch::Matchers::WithinRel(expected.theta_rad, 0.001f) ||
                       Catch::Matchers::WithinAbs(expected.theta_rad, 0.00001f) );
@@ -154,21 +154,60 @@ TEST_CASE( "Test MockManager Numerical Sim" ) {
         SECTION( "Position 1: Landmark behind robot" ){
             struct Point2D expected = {.x = -1, .y = 0};
             auto res = test_manager->inverseMeas({.x = 0, .y = 0, .theta_rad = 0}, {.range_m = 1, .bearing_rad = M_PI});
-            REQUIRE_THAT( res.x, Catch::Matchers::WithinRel(expected.x, 0.001f) ||
+            REQUIRE_THAT( res.x, Catch::Matchers::WithinRel(expected.x, CoordScalar(0.001)) ||
                           Catch::Matchers::WithinAbs(expected.x, 0.00001f) );
-            REQUIRE_THAT( res.y, Catch::Matchers::WithinRel(expected.y, 0.001f) ||
+            REQUIRE_THAT( res.y, Catch::Matchers::WithinRel(expected.y, CoordScalar(0.001)) ||
                           Catch::Matchers::WithinAbs(expected.y, 0.00001f) );
         }
 
         SECTION( "Position 2: Landmark next to robot, Robot at non-zero" ){
             struct Point2D expected = {.x = 1, .y = 1};
             auto res = test_manager->inverseMeas({.x = 1, .y = 0, .theta_rad = 0}, {.range_m = 1, .bearing_rad = M_PI/2});
-            REQUIRE_THAT( res.x, Catch::Matchers::WithinRel(expected.x, 0.001f) ||
+            REQUIRE_THAT( res.x, Catch::Matchers::WithinRel(expected.x, CoordScalar(0.001)) ||
                           Catch::Matchers::WithinAbs(expected.x, 0.00001f) );
-            REQUIRE_THAT( res.y, Catch::Matchers::WithinRel(expected.y, 0.001f) ||
+            REQUIRE_THAT( res.y, Catch::Matchers::WithinRel(expected.y, CoordScalar(0.001)) ||
                           Catch::Matchers::WithinAbs(expected.y, 0.00001f) );
         }
     }
 }
 
+TEST_CASE( "MockManager: pose-conditioned measurement model" ){
+    std::shared_ptr<MockManager2D> test_manager = std::make_shared<MockManager2D>(
+        Pose2D{.x = 0, .y = 0, .theta_rad = 0}, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0},
+        Eigen::Matrix2f::Identity(), 10, Eigen::Matrix3f::Identity());
+    struct Pose2D pose = {.x = 1, .y = 2, .theta_rad = 0.5};
+    struct Point2D lm = {.x = 4, .y = -1};
+
+    SECTION( "prediction inverts the inverse measurement" ){
+        auto meas = test_manager->predictMeas(pose, lm);
+        auto res = test_manager->inverseMeas(pose, meas);
+        REQUIRE_THAT( res.x, Catch::Matchers::WithinAbs(lm.x, 0.0001f) );
+        REQUIRE_THAT( res.y, Catch::Matchers::WithinAbs(lm.y, 0.0001f) );
+        REQUIRE( meas.bearing_rad >= -M_PI );
+        REQUIRE( meas.bearing_rad <= M_PI );
+    }
+
+    SECTION( "jacobians match finite differences" ){
+        const float eps = 1e-3f;
+        auto base = test_manager->predictMeas(pose, lm);
+        Eigen::Matrix2f H_m = test_manager->measJacobian(pose, lm);
+        Eigen::Matrix<float, 2, 3> H_x = test_manager->poseJacobian(pose, lm);
+
+        for (int col = 0; col < 2; col++) {
+            struct Point2D moved = lm;
+            (col == 0 ? moved.x : moved.y) += eps;
+            Eigen::Vector2f diff = test_manager->predictMeas(pose, moved) - base;
+            REQUIRE_THAT( diff(0) / eps, Catch::Matchers::WithinAbs(H_m(0, col), 0.01f) );
+            REQUIRE_THAT( diff(1) / eps, Catch::Matchers::WithinAbs(H_m(1, col), 0.01f) );
+        }
+        for (int col = 0; col < 3; col++) {
+            struct Pose2D moved = pose;
+            moved += Eigen::Vector3f::Unit(col) * eps;
+            Eigen::Vector2f diff = test_manager->predictMeas(moved, lm) - base;
+            REQUIRE_THAT( diff(0) / eps, Catch::Matchers::WithinAbs(H_x(0, col), 0.01f) );
+            REQUIRE_THAT( diff(1) / eps, Catch::Matchers::WithinAbs(H_x(1, col), 0.01f) );
+        }
+    }
+}
+
 #endif // USE_MOCK
@@ -4,22 +4,36 @@
  */
 
 #include "particle-filter.h"
+#include "logging.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+float logLikelihood(float likelihood) {
+    return likelihood > 0 ? std::max(std::log(likelihood), MIN_LOG_LIKELIHOOD)
+                          : MIN_LOG_LIKELIHOOD;
+}
+
+} // namespace
 
 FastSLAMPF::FastSLAMPF(std::shared_ptr<RobotManager2D> rob_ptr,
                        unsigned int num_particles,
                        const struct Pose2D& starting_pose,
                        const float& lm_importance_factor):
     m_robot(rob_ptr),
-    m_num_particles(DEFAULT_NUM_PARTICLE){
+    m_fleet{rob_ptr},
+    m_num_particles(num_particles){
 
+    m_particle_set.reserve(m_num_particles);
     for (int i = 0; i < m_num_particles; i++) {
-        std::unique_ptr<FastSLAMParticles> new_particle = std::make_unique<FastSLAMParticles>
-            (lm_importance_factor, starting_pose, m_robot);
-        auto particle_pair = std::make_pair(i, std::move(new_particle));
-        m_particle_set.insert(std::move(particle_pair));
-
-        m_particle_weights.push_back(1.0f / static_cast<float>(m_num_particles));
+        m_particle_set.emplace_back(lm_importance_factor, starting_pose, m_robot);
+        m_particle_weights.push_back(1 / static_cast<WeightScalar>(m_num_particles));
+        m_log_weights.push_back(0.0f);
     }
+    m_aux_particle_set = m_particle_set;
+    m_cdf_table.reserve(m_num_particles);
 }
 
 
@@ -29,84 +43,831 @@ FastSLAMPF::FastSLAMPF(std::shared_ptr<RobotManager2D> rob_ptr):
 }
 
 struct Pose2D FastSLAMPF::samplePose(const struct Pose2D& a_pose_mean) {
-    Eigen::Matrix3f l_cholesky;
-    Eigen::LLT<Eigen::Matrix3f> cholSolver(m_robot->getProcessNoise());
-    if (cholSolver.info()==Eigen::Success) {
-        // Use cholesky solver
-        l_cholesky = cholSolver.matrixL();
-    } else {
-        // Use eigen solver
-        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> eigenSolver(m_robot->getProcessNoise());
-        l_cholesky = eigenSolver.eigenvectors()
-            * eigenSolver.eigenvalues().cwiseSqrt().asDiagonal();
-    }
-    Eigen::Vector3f z = Eigen::Vector3f::Zero();
-    for (auto& it: z){
-        it = MathUtil::sampleNormal(0.0f, 1.0f);
-    }
     struct Pose2D ret = a_pose_mean;
-    ret += l_cholesky * z;
+    ret += MathUtil::sampleMultivariateNormal(m_robot->getProcessNoise());
     return ret;
 }
 
-int FastSLAMPF::drawWithReplacement(const std::vector<float>& cdf_vec, float sample) const{
+int FastSLAMPF::drawWithReplacement(const std::vector<WeightScalar>& cdf_vec,
+                                    WeightScalar sample) const{
     int start = 0;
     int end = cdf_vec.size()-1;
     if (sample < 0 || sample > cdf_vec[end]) return -1;
 
     // binary search, if the sample falls between the [prev, next) interval,
     // then consider the sample drawn from that interval
-    int middle;
     while (start != end) {
-        middle = (start + end) / 2;
+        int middle = (start + end) / 2;
         if (sample >= cdf_vec[middle]) {
             start = middle+1;
         } else {
             end = middle;
         }
     }
-    return middle;
+    return start;
 }
 
 void FastSLAMPF::reSampleParticles(){
-    std::vector<float> cdf_table;
-    float total_weight = MathUtil::genCDF(m_particle_weights, cdf_table);
-    float sampled_weight;
-    std::unordered_map<int, std::unique_ptr<FastSLAMParticles>> aux_set;
-
-    for (const auto& it: m_particle_set){
-        sampled_weight = MathUtil::sampleUniform(0.0, total_weight);
-        int sampled_idx = drawWithReplacement(cdf_table, sampled_weight);
+    m_cdf_table.clear();
+    WeightScalar total_weight = MathUtil::genCDF(m_particle_weights, m_cdf_table);
+    WeightScalar sampled_weight;
+
+    // copy-assign into the spare set so that particles keep their landmark storage;
+    // m_num_particles differs from the set size when the frame budget resized it
+    size_t num_current = m_particle_set.size();
+    int best_idx = 0;
+    WeightScalar best_weight = -1;
+    for (int i = 0; i < m_num_particles; i++){
+        sampled_weight = MathUtil::sampleUniform<WeightScalar>(0, total_weight);
+        int sampled_idx = drawWithReplacement(m_cdf_table, sampled_weight);
         // leave original particle if sampling goes wrong
-        sampled_idx = sampled_idx >= 0 ? sampled_idx : it.first;
-        std::unique_ptr<FastSLAMParticles> particle_drew =
-            std::make_unique<FastSLAMParticles>(*m_particle_set[sampled_idx]);
-        aux_set.insert({it.first, std::move(particle_drew)});
+        sampled_idx = sampled_idx >= 0 ? sampled_idx : i % num_current;
+        if (m_particle_weights[sampled_idx] > best_weight) {
+            best_weight = m_particle_weights[sampled_idx];
+            best_idx = i;
+        }
+        if (i < m_aux_particle_set.size()) {
+            m_aux_particle_set[i] = m_particle_set[sampled_idx];
+        } else {
+            m_aux_particle_set.push_back(m_particle_set[sampled_idx]);
+        }
+    }
+
+    m_aux_particle_set.erase(m_aux_particle_set.begin() + m_num_particles,
+                             m_aux_particle_set.end());
+    m_particle_set.swap(m_aux_particle_set);
+    resetWeights(best_idx);
+}
+
+void FastSLAMPF::normalizeWeights() {
+    // the tracked best particle holds the largest log weight
+    WeightScalar max_log_weight = m_log_weights[m_best_idx];
+    WeightScalar weight_sum = 0;
+    for (int i = 0; i < m_log_weights.size(); i++) {
+        m_log_weights[i] -= max_log_weight;
+        m_particle_weights[i] = std::exp(m_log_weights[i]);
+        weight_sum += m_particle_weights[i];
+    }
+    for (auto& it: m_particle_weights) {
+        it /= weight_sum;
+    }
+}
+
+void FastSLAMPF::resetWeights(int best_idx) {
+    m_particle_weights.assign(m_particle_set.size(),
+                              1 / static_cast<WeightScalar>(m_particle_set.size()));
+    m_log_weights.assign(m_particle_set.size(), 0);
+    m_best_idx = best_idx;
+}
+
+void FastSLAMPF::enableKLDSampling(const struct KLDConfig& config) {
+    m_kld_config = config;
+    m_kld_config.min_particles = std::max(1u, config.min_particles);
+    m_kld_config.max_particles = std::max(m_kld_config.min_particles, config.max_particles);
+    m_kld_enabled = true;
+
+    m_particle_set.reserve(m_kld_config.max_particles);
+    m_aux_particle_set.reserve(m_kld_config.max_particles);
+    m_particle_weights.reserve(m_kld_config.max_particles);
+    m_log_weights.reserve(m_kld_config.max_particles);
+    m_cdf_table.reserve(m_kld_config.max_particles);
+
+    // at most one bin per particle; keep the table at most half full
+    size_t table_size = 1;
+    while (table_size < 2 * m_kld_config.max_particles) table_size <<= 1;
+    m_kld_bins.assign(table_size, 0);
+}
+
+bool FastSLAMPF::insertKLDBin(const struct Pose2D& pose) {
+    auto bin = [](float value, float size) {
+        return static_cast<uint64_t>(static_cast<int64_t>(floorf(value / size))) & 0x1FFFFF;
+    };
+    uint64_t key = (uint64_t{1} << 63) | (bin(pose.x, m_kld_config.bin_size_m) << 42) |
+        (bin(pose.y, m_kld_config.bin_size_m) << 21) |
+        bin(MathUtil::wrapAngle(pose.theta_rad), m_kld_config.bin_size_rad);
+
+    uint64_t mask = m_kld_bins.size() - 1;
+    uint64_t slot = (key * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+    while (m_kld_bins[slot] != 0) {
+        if (m_kld_bins[slot] == key) return false;
+        slot = (slot + 1) & mask;
     }
+    m_kld_bins[slot] = key;
+    return true;
+}
+
+void FastSLAMPF::reSampleParticlesKLD(){
+    m_cdf_table.clear();
+    WeightScalar total_weight = MathUtil::genCDF(m_particle_weights, m_cdf_table);
+    std::fill(m_kld_bins.begin(), m_kld_bins.end(), 0);
 
-    m_particle_set = std::move(aux_set);
+    // the frame budget, if any, caps both bounds
+    unsigned int max_particles = std::min(m_kld_config.max_particles, m_particle_budget);
+    unsigned int min_particles = std::min(m_kld_config.min_particles, max_particles);
+    unsigned int num_drawn = 0;
+    unsigned int required = min_particles;
+    int num_bins = 0;
+    int best_idx = 0;
+    WeightScalar best_weight = -1;
+    while (num_drawn < max_particles && (num_drawn < required || num_drawn < min_particles)) {
+        WeightScalar sampled_weight = MathUtil::sampleUniform<WeightScalar>(0, total_weight);
+        int sampled_idx = drawWithReplacement(m_cdf_table, sampled_weight);
+        // fall back to cycling through the set if sampling goes wrong
+        sampled_idx = sampled_idx >= 0 ? sampled_idx : num_drawn % m_particle_set.size();
+        const FastSLAMParticles& drawn = m_particle_set[sampled_idx];
+        if (m_particle_weights[sampled_idx] > best_weight) {
+            best_weight = m_particle_weights[sampled_idx];
+            best_idx = num_drawn;
+        }
+
+        if (num_drawn < m_aux_particle_set.size()) {
+            m_aux_particle_set[num_drawn] = drawn;
+        } else {
+            m_aux_particle_set.push_back(drawn);
+        }
+        num_drawn++;
 
+        if (insertKLDBin(drawn.getPose())) {
+            num_bins++;
+            required = MathUtil::kldSampleBound(num_bins, m_kld_config.epsilon,
+                                                m_kld_config.z_quantile);
+        }
+    }
+
+    m_aux_particle_set.erase(m_aux_particle_set.begin() + num_drawn, m_aux_particle_set.end());
+    m_particle_set.swap(m_aux_particle_set);
+    m_num_particles = num_drawn;
+    resetWeights(best_idx);
 }
 
 void FastSLAMPF::updateFilter(const struct Pose2D &a_robot_pose_mean,
                          std::queue<struct Observation2D> &a_sighting_queue) {
-    while (!a_sighting_queue.empty()){
-        int idx = 0;
-        for (auto& it: m_particle_set){
-            auto rob_pose_sampled = samplePose(a_robot_pose_mean);
-            m_particle_weights[idx] += it.second->updateParticle(
-                a_sighting_queue.front(), rob_pose_sampled);
-            idx++;
+    PF_PROFILE_BIND(m_stage_profile);
+    PF_PROFILE_TIMER(Profiler::Stage::FRAME);
+    PF_TRACE_SPAN_ARG("updateFilter", "frame", static_cast<int64_t>(a_sighting_queue.size()));
+    if (m_submaps_enabled) updateActiveRegion(a_robot_pose_mean);
+    if (m_staging_enabled) m_staging.beginFrame();
+    auto frame_start = (m_metrics || m_budget_enabled) ? std::chrono::steady_clock::now()
+                                                       : std::chrono::steady_clock::time_point{};
+    unsigned int num_obs = a_sighting_queue.size();
+    unsigned int num_processed = 0;
+    // association outcomes are tallied locally and published once per frame
+    uint64_t num_matched = 0, num_new = 0, num_rejected = 0, num_inversion_failures = 0;
+    uint64_t num_tentative = 0;
+
+    unsigned int obs_cap = UNLIMITED_OBSERVATIONS, min_obs = 0;
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if (m_budget_enabled) {
+        obs_cap = m_budget.getObservationCap();
+        min_obs = m_budget.getConfig().min_observations;
+        deadline = frame_start + std::chrono::microseconds(
+            static_cast<int64_t>(m_budget.getConfig().deadline_us));
+    }
+
+    if (m_prior_map != nullptr) {
+        // localization: poses from the motion model, weighted against the shared map
+        gatherFrame(a_sighting_queue, obs_cap, min_obs, deadline);
+        num_processed = m_frame_obs.size();
+
+        PF_TRACE_SPAN_ARG("particles", "chunk", static_cast<int64_t>(m_particle_set.size()));
+        for (int i = 0; i < m_particle_set.size(); i++) {
+            struct Pose2D rob_pose_sampled;
+            {
+                PF_PROFILE_SCOPE(Profiler::Stage::SAMPLE_POSE);
+                rob_pose_sampled = samplePose(a_robot_pose_mean);
+            }
+            int num_localized = 0;
+            m_log_weights[i] += m_particle_set[i].localizeParticle(
+                m_frame_obs, rob_pose_sampled, *m_prior_map, m_localization_config,
+                num_localized);
+            if (i == 0 || m_log_weights[i] > m_log_weights[m_best_idx]) m_best_idx = i;
+            num_matched += num_localized;
+            num_rejected += num_processed - num_localized;
         }
-        a_sighting_queue.pop();
+    } else if (m_proposal == PF_PROPOSAL::OBSERVATION) {
+        // the proposal conditions on the whole frame, so gather it first
+        gatherFrame(a_sighting_queue, obs_cap, min_obs, deadline);
+        num_processed = m_frame_obs.size();
+        const Eigen::Matrix3f process_noise = m_robot->getProcessNoise();
+        if (m_staging_enabled) m_frame_staged.assign(m_particle_set.size() * num_processed, 0);
+
+        PF_TRACE_SPAN_ARG("particles", "chunk", static_cast<int64_t>(m_particle_set.size()));
+        for (int i = 0; i < m_particle_set.size(); i++) {
+            m_log_weights[i] += m_particle_set[i].updateParticleProposal(
+                m_frame_obs, a_robot_pose_mean, process_noise, m_frame_labels, m_next_uid,
+                m_staging_enabled);
+            if (i == 0 || m_log_weights[i] > m_log_weights[m_best_idx]) m_best_idx = i;
+            for (int j = 0; j < m_frame_labels.size(); j++) {
+                int label = m_frame_labels[j];
+                if (label >= 0) {
+                    m_consensus.touch(m_particle_set[i].getLandmarkUid(label));
+                } else if (label == LABEL_NEW_LANDMARK) {
+                    m_consensus.touch(m_next_uid + j);
+                }
+                num_matched += label >= 0;
+                num_new += label == LABEL_NEW_LANDMARK;
+                num_rejected += label == LABEL_REJECTED || label == LABEL_INVALID;
+                num_inversion_failures += label == LABEL_REJECTED;
+                if (label == LABEL_TENTATIVE) {
+                    m_frame_staged[i * num_processed + j] = 1;
+                    num_tentative++;
+                }
+            }
+        }
+
+        if (m_staging_enabled) {
+            for (int j = 0; j < num_processed; j++) {
+                num_new += promoteStaged(m_frame_obs[j], m_next_uid + j, a_robot_pose_mean,
+                                         num_processed, j);
+            }
+        }
+    } else {
+        // motion proposal (FastSLAM 1.0)
+        while (!a_sighting_queue.empty()){
+            // every particle sees the same observations, so the frame can stop between two;
+            // stop once the next observation, at the average cost so far, would miss the
+            // deadline
+            if (num_processed >= obs_cap) break;
+            if (m_budget_enabled && num_processed >= min_obs && num_processed > 0) {
+                auto now = std::chrono::steady_clock::now();
+                if (now + (now - frame_start) / num_processed > deadline) break;
+            }
+
+            // once per observation, outside the per-particle and per-landmark loops
+            PF_LOG_TRACE("processing observation", "range", a_sighting_queue.front().range_m,
+                         "bearing", a_sighting_queue.front().bearing_rad);
+            PF_TRACE_SPAN_ARG("particles", "chunk",
+                              static_cast<int64_t>(m_particle_set.size()));
+            if (m_staging_enabled) m_frame_staged.assign(m_particle_set.size(), 0);
+            int idx = 0;
+            for (auto& it: m_particle_set){
+                struct Pose2D rob_pose_sampled;
+                {
+                    PF_PROFILE_SCOPE(Profiler::Stage::SAMPLE_POSE);
+                    rob_pose_sampled = samplePose(a_robot_pose_mean);
+                }
+                m_log_weights[idx] += logLikelihood(it.updateParticle(
+                    a_sighting_queue.front(), rob_pose_sampled, m_next_uid + num_processed,
+                    m_staging_enabled));
+                m_consensus.touch(it.getLastLandmarkUid());
+                // every weight changes, so the running maximum restarts with each observation
+                if (idx == 0 || m_log_weights[idx] > m_log_weights[m_best_idx]) {
+                    m_best_idx = idx;
+                }
+                num_matched += it.getLastAssociation() == PF_ASSOC::MATCHED;
+                num_new += it.getLastAssociation() == PF_ASSOC::NEW_LANDMARK;
+                num_rejected += it.getLastAssociation() == PF_ASSOC::REJECTED;
+                num_inversion_failures +=
+                    it.getLastUpdateStatus() == PF_RET::MATRIX_INVERSION_ERROR;
+                if (it.getLastAssociation() == PF_ASSOC::TENTATIVE) {
+                    m_frame_staged[idx] = 1;
+                    num_tentative++;
+                }
+                idx++;
+            }
+            if (m_staging_enabled) {
+                num_new += promoteStaged(a_sighting_queue.front(), m_next_uid + num_processed,
+                                         a_robot_pose_mean, 1, 0);
+            }
+            a_sighting_queue.pop();
+            num_processed++;
+        }
+    }
+
+    m_next_uid += num_processed;
+
+    // observations beyond the frame budget are dropped
+    unsigned int num_shed = a_sighting_queue.size();
+    while (!a_sighting_queue.empty()) a_sighting_queue.pop();
+
+    normalizeWeights();
+    if (m_metrics) publishMetrics();
+    unsigned int num_updated = m_particle_set.size();
+    double effective_particles = effectiveParticles();
+    bool resample = resampleIfNeeded(effective_particles);
+
+    uint64_t frame_us = 0;
+    if (m_metrics || m_budget_enabled) {
+        frame_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - frame_start).count());
+    }
+    if (m_budget_enabled) {
+        applyBudget({.frame_us = static_cast<double>(frame_us), .num_particles = num_updated,
+                     .num_observations = num_obs, .processed_observations = num_processed,
+                     .effective_particles = effective_particles});
+    }
+
+    if (m_metrics) {
+        m_metrics->frames.inc();
+        m_metrics->observations.inc(num_processed);
+        m_metrics->observations_shed.inc(num_shed);
+        m_metrics->resamples.inc(resample ? 1 : 0);
+        m_metrics->particles.set(m_num_particles);
+        m_metrics->assoc_matched.inc(num_matched);
+        m_metrics->assoc_new.inc(num_new);
+        m_metrics->assoc_rejected.inc(num_rejected);
+        m_metrics->assoc_tentative.inc(num_tentative);
+        m_metrics->matrix_inversion_failures.inc(num_inversion_failures);
+        m_metrics->update_seconds_us.inc(frame_us);
     }
-    reSampleParticles();
+}
+
+void FastSLAMPF::gatherFrame(std::queue<struct Observation2D>& sightings,
+                             unsigned int obs_cap, unsigned int min_obs,
+                             std::chrono::steady_clock::time_point deadline) {
+    m_frame_obs.clear();
+    // the frame is not processed yet, so one observation costs what it did in past frames
+    double obs_us = m_budget_enabled
+        ? m_budget.getObservationCostUs() * m_particle_set.size() : 0.0;
+    auto now = obs_us > 0.0 ? std::chrono::steady_clock::now()
+                            : std::chrono::steady_clock::time_point{};
+    while (!sightings.empty() && m_frame_obs.size() < obs_cap) {
+        if (obs_us > 0.0 && m_frame_obs.size() >= min_obs) {
+            auto frame_us = std::chrono::microseconds(
+                static_cast<int64_t>((m_frame_obs.size() + 1) * obs_us));
+            if (now + frame_us > deadline) break;
+        }
+        m_frame_obs.push_back(sightings.front());
+        sightings.pop();
+    }
+}
+
+bool FastSLAMPF::resampleIfNeeded(double effective_particles) {
+    bool resample = m_kld_enabled || m_num_particles != m_particle_set.size() ||
+                    m_resample_threshold >= 1.0f ||
+                    effective_particles < m_resample_threshold * m_particle_set.size();
+    if (!resample) return false;
+
+    PF_PROFILE_SCOPE(Profiler::Stage::RESAMPLE);
+    if (m_kld_enabled) {
+        reSampleParticlesKLD();
+    } else {
+        reSampleParticles();
+    }
+    return true;
+}
+
+int FastSLAMPF::addRobot(std::shared_ptr<RobotManager2D> robot,
+                         const struct Pose2D& starting_pose) {
+    if (robot == nullptr) {
+        PF_LOG_ERROR("no robot manager specified");
+        return -1;
+    }
+    m_fleet.push_back(robot);
+    for (auto& it: m_particle_set) {
+        it.addRobotPose(starting_pose);
+    }
+    return m_fleet.size() - 1;
+}
+
+int FastSLAMPF::mergeRobot(std::shared_ptr<RobotManager2D> robot, const FastSLAMPF& other,
+                           float gate) {
+    if (robot == nullptr) {
+        PF_LOG_ERROR("no robot manager specified");
+        return -1;
+    }
+    if (m_prior_map != nullptr) {
+        PF_LOG_ERROR("mergeRobot is not supported in localization mode");
+        return -1;
+    }
+    PF_TRACE_SPAN("mergeRobot", "merge");
+
+    // the other map is taken whole, including the landmarks frozen in its submaps
+    struct MergedLandmark {
+        struct Point2D mean;
+        Eigen::Matrix2f cov;
+    };
+    const FastSLAMParticles& source = other.returnEst();
+    std::vector<struct MergedLandmark> merged;
+    merged.reserve(source.getNumLandMark() + source.getNumFrozenLandMark());
+    for (int i = 0; i < source.getNumLandMark(); i++) {
+        merged.push_back({source.getLandmark(i).getLMEst(), source.getLandmark(i).getLMCov()});
+    }
+    for (const auto& submap: source.getFrozenSubmaps()) {
+        for (const auto& it: submap->landmarks) {
+            Eigen::Matrix2f cov;
+            cov << it.cov_xx, it.cov_xy,
+                   it.cov_xy, it.cov_yy;
+            merged.push_back({{.x = it.x, .y = it.y}, cov});
+        }
+    }
+
+    // frozen landmarks of this map can only be fused once thawed; the window is re-applied
+    // by the next updateFilter call
+    if (m_submaps_enabled) {
+        for (auto& it: m_particle_set) {
+            it.thawAll();
+        }
+        m_has_active_region = false;
+    }
+    const FastSLAMParticles& target = returnEst();
+
+    // associate once, on the best particles; the uids carry the result to every particle
+    std::vector<uint32_t> matched_uids(merged.size(), LM_UID_NONE);
+    for (int i = 0; i < merged.size(); i++) {
+        float best_dist = gate;
+        for (int j = 0; j < target.getNumLandMark(); j++) {
+            const LMEKF2D& candidate = target.getLandmark(j);
+            Eigen::Vector2f diff(merged[i].mean.x - candidate.getLMEst().x,
+                                 merged[i].mean.y - candidate.getLMEst().y);
+            Eigen::Matrix2f S = merged[i].cov + candidate.getLMCov();
+            if (S.determinant() <= 0) continue;
+            float dist = diff.dot(S.inverse() * diff);
+            if (dist < best_dist) {
+                best_dist = dist;
+                matched_uids[i] = target.getLandmarkUid(j);
+            }
+        }
+    }
+
+    // draw the new robot's pose hypotheses from the other filter, by weight
+    const std::vector<WeightScalar>& other_weights = other.getWeights();
+    WeightScalar step = 1 / static_cast<WeightScalar>(m_particle_set.size());
+    WeightScalar offset = MathUtil::sampleUniform<WeightScalar>(0, step);
+    WeightScalar cumulative = other_weights[0];
+    int drawn = 0;
+    for (int i = 0; i < m_particle_set.size(); i++) {
+        WeightScalar sample = offset + i * step;
+        while (sample > cumulative && drawn < other_weights.size() - 1) {
+            cumulative += other_weights[++drawn];
+        }
+        m_particle_set[i].addRobotPose(other.m_particle_set[drawn].getPose());
+    }
+
+    // merged landmark i gets uid first_new_uid + i where it is appended: always if it
+    // matched nothing, and in the particles that do not hold the match (e.g. they never
+    // saw it). Appended uids stay ascending
+    uint32_t first_new_uid = m_next_uid;
+    std::vector<uint8_t> appended(merged.size(), 0);
+    for (auto& it: m_particle_set) {
+        for (int i = 0; i < merged.size(); i++) {
+            if (matched_uids[i] != LM_UID_NONE &&
+                it.fuseLandmark(matched_uids[i], merged[i].mean, merged[i].cov, 1)) {
+                continue;
+            }
+            it.appendLandmark(first_new_uid + i, merged[i].mean, merged[i].cov, 1);
+            appended[i] = 1;
+        }
+    }
+    unsigned int num_new = 0, num_fallback = 0;
+    for (int i = 0; i < merged.size(); i++) {
+        if (matched_uids[i] != LM_UID_NONE) m_consensus.touch(matched_uids[i]);
+        if (appended[i]) m_consensus.touch(first_new_uid + i);
+        num_new += matched_uids[i] == LM_UID_NONE;
+        num_fallback += matched_uids[i] != LM_UID_NONE && appended[i];
+    }
+    m_next_uid += merged.size();
+
+    m_fleet.push_back(robot);
+    PF_LOG_INFO("merged robot map", "robot", m_fleet.size() - 1,
+                "landmarks", merged.size(), "new", num_new, "unfused", num_fallback);
+    return m_fleet.size() - 1;
+}
+
+void FastSLAMPF::updateFleet(const std::vector<struct RobotFrame>& frames,
+                             unsigned int num_threads) {
+    PF_PROFILE_BIND(m_stage_profile);
+    PF_PROFILE_TIMER(Profiler::Stage::FRAME);
+    PF_TRACE_SPAN_ARG("updateFleet", "frame", static_cast<int64_t>(frames.size()));
+    if (m_prior_map != nullptr) {
+        PF_LOG_ERROR("updateFleet is not supported in localization mode");
+        return;
+    }
+    auto frame_start = m_metrics ? std::chrono::steady_clock::now()
+                                 : std::chrono::steady_clock::time_point{};
+
+    // frame f starts its landmarks at first_uids[f], as if the frames were one long frame
+    std::vector<uint32_t> first_uids;
+    unsigned int num_obs = 0;
+    for (const auto& frame: frames) {
+        first_uids.push_back(m_next_uid + num_obs);
+        if (frame.robot_id < m_fleet.size()) num_obs += frame.observations.size();
+    }
+
+    struct WorkerTally {
+        std::vector<int> labels;
+        std::vector<uint32_t> touched;
+        uint64_t matched = 0, created = 0, rejected = 0, inversion_failures = 0;
+    };
+    num_threads = std::max(1u, std::min<unsigned int>(num_threads, m_particle_set.size()));
+    std::vector<WorkerTally> tallies(num_threads);
+#ifdef PF_PROFILING
+    if (m_worker_profiles.size() < num_threads) m_worker_profiles.resize(num_threads);
+#endif // PF_PROFILING
+
+    auto work = [&](unsigned int worker) {
+        // pool threads are not bound to the filter's profile, so every worker has its own
+        PF_PROFILE_BIND(m_worker_profiles[worker]);
+        PF_TRACE_SPAN("particles", "chunk");
+        WorkerTally& tally = tallies[worker];
+        int begin = m_particle_set.size() * worker / num_threads;
+        int end = m_particle_set.size() * (worker + 1) / num_threads;
+        for (int i = begin; i < end; i++) {
+            for (int f = 0; f < frames.size(); f++) {
+                const struct RobotFrame& frame = frames[f];
+                if (frame.robot_id >= m_fleet.size()) continue;
+                const std::shared_ptr<RobotManager2D>& robot = m_fleet[frame.robot_id];
+                m_log_weights[i] += m_particle_set[i].updateRobotProposal(
+                    frame.robot_id, robot, frame.observations, frame.pose_mean,
+                    robot->getProcessNoise(), tally.labels, first_uids[f]);
+                for (int j = 0; j < tally.labels.size(); j++) {
+                    int label = tally.labels[j];
+                    if (label >= 0) {
+                        tally.touched.push_back(m_particle_set[i].getLandmarkUid(label));
+                    }
+                    tally.matched += label >= 0;
+                    tally.created += label == LABEL_NEW_LANDMARK;
+                    tally.rejected += label == LABEL_REJECTED || label == LABEL_INVALID;
+                    tally.inversion_failures += label == LABEL_REJECTED;
+                }
+            }
+        }
+    };
+
+    m_workers.run(num_threads, work);
+#ifdef PF_PROFILING
+    for (unsigned int w = 0; w < num_threads; w++) {
+        m_stage_profile.merge(m_worker_profiles[w]);
+        m_worker_profiles[w].reset();
+    }
+#endif // PF_PROFILING
+
+    uint64_t num_matched = 0, num_new = 0, num_rejected = 0, num_inversion_failures = 0;
+    for (const auto& tally: tallies) {
+        for (const auto& uid: tally.touched) {
+            m_consensus.touch(uid);
+        }
+        num_matched += tally.matched;
+        num_new += tally.created;
+        num_rejected += tally.rejected;
+        num_inversion_failures += tally.inversion_failures;
+    }
+    for (uint32_t uid = m_next_uid; uid < m_next_uid + num_obs; uid++) {
+        m_consensus.touch(uid);
+    }
+    m_next_uid += num_obs;
+
+    m_best_idx = 0;
+    for (int i = 1; i < m_log_weights.size(); i++) {
+        if (m_log_weights[i] > m_log_weights[m_best_idx]) m_best_idx = i;
+    }
+    normalizeWeights();
+    if (m_metrics) publishMetrics();
+    bool resample = resampleIfNeeded(effectiveParticles());
+
+    if (m_metrics) {
+        uint64_t frame_us = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - frame_start).count());
+        m_metrics->frames.inc();
+        m_metrics->observations.inc(num_obs);
+        m_metrics->resamples.inc(resample ? 1 : 0);
+        m_metrics->particles.set(m_num_particles);
+        m_metrics->assoc_matched.inc(num_matched);
+        m_metrics->assoc_new.inc(num_new);
+        m_metrics->assoc_rejected.inc(num_rejected);
+        m_metrics->matrix_inversion_failures.inc(num_inversion_failures);
+        m_metrics->update_seconds_us.inc(frame_us);
+    }
+}
+
+void FastSLAMPF::setCovarianceForm(KF_COV_FORM form) {
+    m_cov_form = form;
+    for (auto& it: m_particle_set) {
+        it.setCovarianceForm(form);
+    }
+    for (auto& it: m_aux_particle_set) {
+        it.setCovarianceForm(form);
+    }
+}
+
+void FastSLAMPF::setProposal(PF_PROPOSAL proposal) {
+    m_proposal = proposal;
+    if (m_info_fusion && m_proposal == PF_PROPOSAL::MOTION) {
+        PF_LOG_WARN("information fusion only applies to updateFleet with the motion proposal");
+    }
+}
+
+void FastSLAMPF::setInformationFusion(bool enabled) {
+    m_info_fusion = enabled;
+    if (m_info_fusion && m_proposal == PF_PROPOSAL::MOTION) {
+        PF_LOG_WARN("information fusion only applies to updateFleet with the motion proposal");
+    }
+    for (auto& it: m_particle_set) {
+        it.setInformationFusion(enabled);
+    }
+    for (auto& it: m_aux_particle_set) {
+        it.setInformationFusion(enabled);
+    }
+}
+
+void FastSLAMPF::enableConvergence(const struct ConvergenceConfig& config) {
+    for (auto& it: m_particle_set) {
+        it.enableConvergence(config);
+    }
+    for (auto& it: m_aux_particle_set) {
+        it.enableConvergence(config);
+    }
+}
+
+void FastSLAMPF::disableConvergence() {
+    for (auto& it: m_particle_set) {
+        it.disableConvergence();
+    }
+    for (auto& it: m_aux_particle_set) {
+        it.disableConvergence();
+    }
+}
+
+void FastSLAMPF::enableLocalization(std::shared_ptr<const PriorMap> map,
+                                    const struct LocalizationConfig& config) {
+    if (map == nullptr) {
+        PF_LOG_ERROR("no prior map specified");
+        return;
+    }
+    m_prior_map = std::move(map);
+    m_localization_config = config;
+    // every landmark leaves the consensus map with the particle maps
+    for (uint32_t uid = 0; uid < m_next_uid; uid++) {
+        m_consensus.touch(uid);
+    }
+    for (auto& it: m_particle_set) {
+        it.clearLandmarks();
+    }
+    for (auto& it: m_aux_particle_set) {
+        it.clearLandmarks();
+    }
+    m_staging.clear();
+    PF_LOG_INFO("localizing against a prior map", "landmarks", m_prior_map->size());
+}
+
+void FastSLAMPF::disableLocalization() {
+    m_prior_map = nullptr;
+}
+
+void FastSLAMPF::enableStaging(const struct StagingConfig& config) {
+    m_staging.configure(config);
+    m_staging_enabled = true;
+}
+
+void FastSLAMPF::disableStaging() {
+    m_staging_enabled = false;
+    m_staging.clear();
+}
+
+unsigned int FastSLAMPF::promoteStaged(const struct Observation2D& obs, uint32_t uid,
+                                       const struct Pose2D& pose_mean, size_t stride,
+                                       size_t offset) {
+    bool staged = false;
+    for (size_t i = 0; i < m_particle_set.size() && !staged; i++) {
+        staged = m_frame_staged[i * stride + offset];
+    }
+    if (!staged || !m_staging.addSighting(m_robot->inverseMeas(pose_mean, obs))) return 0;
+
+    unsigned int num_started = 0;
+    for (size_t i = 0; i < m_particle_set.size(); i++) {
+        if (m_frame_staged[i * stride + offset] && m_particle_set[i].promoteLandmark(obs, uid)) {
+            num_started++;
+        }
+    }
+    if (num_started > 0) m_consensus.touch(uid);
+    PF_LOG_DEBUG("promoted tentative landmark", "uid", uid, "particles", num_started);
+    return num_started;
+}
+
+void FastSLAMPF::enableSubmaps(const struct SubmapConfig& config) {
+    m_submap_config = config;
+    m_submap_config.region_size_m = std::max(config.region_size_m, 1e-3f);
+    m_submap_config.active_radius = std::max(config.active_radius, 0);
+    m_submaps_enabled = true;
+    m_has_active_region = false;
+}
+
+void FastSLAMPF::disableSubmaps() {
+    m_submaps_enabled = false;
+    for (auto& it: m_particle_set) {
+        it.thawAll();
+    }
+}
+
+void FastSLAMPF::updateActiveRegion(const struct Pose2D& robot_pose) {
+    int32_t center_ix = regionIndex(robot_pose.x, m_submap_config.region_size_m);
+    int32_t center_iy = regionIndex(robot_pose.y, m_submap_config.region_size_m);
+    int64_t key = regionKey(center_ix, center_iy);
+    if (m_has_active_region && key == m_active_region_key) return;
+
+    PF_TRACE_SPAN("submaps", "stage");
+    for (auto& it: m_particle_set) {
+        it.updateActiveRegion(center_ix, center_iy, m_submap_config);
+    }
+    m_active_region_key = key;
+    m_has_active_region = true;
+}
+
+void FastSLAMPF::enableBudget(const struct BudgetConfig& config) {
+    m_budget = BudgetController(config, m_num_particles);
+    m_budget_enabled = true;
+    m_particle_budget = m_budget.getParticleBudget();
+    if (!m_kld_enabled) m_num_particles = m_particle_budget;
+    m_last_budget_decision = BudgetDecision{};
+
+    unsigned int max_particles = m_budget.getConfig().max_particles;
+    m_particle_set.reserve(max_particles);
+    m_aux_particle_set.reserve(max_particles);
+    m_particle_weights.reserve(max_particles);
+    m_log_weights.reserve(max_particles);
+    m_cdf_table.reserve(max_particles);
+}
+
+void FastSLAMPF::disableBudget() {
+    m_budget_enabled = false;
+    m_particle_budget = UINT_MAX;
+    m_num_particles = m_particle_set.size();
+}
+
+void FastSLAMPF::applyBudget(const struct FrameCost& cost) {
+    const struct BudgetDecision& decision = m_budget.update(cost);
+    m_last_budget_decision = decision;
+    m_particle_budget = decision.particle_budget;
+    // KLD-sampling picks its own count below the budget
+    if (!m_kld_enabled) m_num_particles = m_particle_budget;
+
+    unsigned int obs_cap = decision.observation_cap == UNLIMITED_OBSERVATIONS
+                               ? 0 : decision.observation_cap;
+    if (decision.action != PF_BUDGET_ACTION::HOLD) {
+        PF_LOG_INFO("frame budget adjusted", "action", static_cast<int>(decision.action),
+                    "cost_us", decision.smoothed_us, "particles", decision.particle_budget,
+                    "observation_cap", obs_cap);
+    }
+    if (decision.overrun) {
+        PF_LOG_DEBUG("frame deadline overrun", "frame_us", cost.frame_us,
+                     "deadline_us", m_budget.getConfig().deadline_us);
+    }
+
+    if (!m_metrics) return;
+    switch (decision.action) {
+        case PF_BUDGET_ACTION::HOLD: m_metrics->budget_hold.inc(); break;
+        case PF_BUDGET_ACTION::SHRINK_PARTICLES: m_metrics->budget_shrink_particles.inc(); break;
+        case PF_BUDGET_ACTION::GROW_PARTICLES: m_metrics->budget_grow_particles.inc(); break;
+        case PF_BUDGET_ACTION::SHED_OBSERVATIONS: m_metrics->budget_shed_observations.inc(); break;
+        case PF_BUDGET_ACTION::RESTORE_OBSERVATIONS:
+            m_metrics->budget_restore_observations.inc();
+            break;
+    }
+    m_metrics->deadline_overruns.inc(decision.overrun ? 1 : 0);
+    m_metrics->frame_cost_us.set(decision.smoothed_us);
+    m_metrics->particle_budget.set(decision.particle_budget);
+    m_metrics->observation_cap.set(obs_cap);
+}
+
+double FastSLAMPF::effectiveParticles() const {
+    double weight_sum = 0.0, weight_sq_sum = 0.0;
+    for (const auto& it: m_particle_weights) {
+        weight_sum += it;
+        weight_sq_sum += static_cast<double>(it) * it;
+    }
+    return weight_sq_sum > 0 ? weight_sum * weight_sum / weight_sq_sum : 0.0;
+}
+
+void FastSLAMPF::publishMetrics() {
+    m_metrics->effective_particles.set(effectiveParticles());
+
+    if (m_particle_set.empty()) return;
+    int lm_min = m_particle_set.front().getNumLandMark();
+    int lm_max = lm_min;
+    double lm_sum = 0.0;
+    for (const auto& it: m_particle_set) {
+        lm_min = std::min(lm_min, it.getNumLandMark());
+        lm_max = std::max(lm_max, it.getNumLandMark());
+        lm_sum += it.getNumLandMark();
+    }
+    m_metrics->landmarks_min.set(lm_min);
+    m_metrics->landmarks_mean.set(lm_sum / m_particle_set.size());
+    m_metrics->landmarks_max.set(lm_max);
+}
+
+const ConsensusMap& FastSLAMPF::getConsensusMap() const {
+    m_consensus.refresh(m_particle_set, m_particle_weights);
+    return m_consensus;
+}
+
+const ConsensusMap& FastSLAMPF::getFullConsensusMap() const {
+    for (uint32_t uid = 0; uid < m_next_uid; uid++) {
+        m_consensus.touch(uid);
+    }
+    return getConsensusMap();
 }
 
 const std::vector<struct Point2D> FastSLAMPF::sampleLandmarks() const {
-    std::vector<float> cdf_table;
-    float total_weight = MathUtil::genCDF(m_particle_weights, cdf_table);
-    float sampled_weight = MathUtil::sampleUniform(0.0, total_weight);
-    int sampled_idx = drawWithReplacement(cdf_table, sampled_weight); 
-    return (m_particle_set.at(sampled_idx))->getLandmarkCoordinates();  
+    // the weights are normalized, so one uniform draw walks the pdf without building a cdf
+    WeightScalar sampled_weight = MathUtil::sampleUniform<WeightScalar>(0, 1);
+    int sampled_idx = m_particle_set.size() - 1;
+    for (int i = 0; i < m_particle_weights.size(); i++) {
+        sampled_weight -= m_particle_weights[i];
+        if (sampled_weight < 0) {
+            sampled_idx = i;
+            break;
+        }
+    }
+    return m_particle_set.at(sampled_idx).getLandmarkCoordinates();
 }
@@ -1,7 +1,13 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include "robot-manager.h"
+#include "fastslam-bench.h"
 #include "particle-filter.h"
+#include "logging.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <limits>
 
 TEST_CASE( "Default Particle" ){
     // set-up
@@ -58,7 +64,7 @@ TEST_CASE( "Test Particle Filter" ){
     std::unique_ptr<FastSLAMPF> test_pf = std::make_unique<FastSLAMPF>(nullptr);
 #endif //USE_MOCK
 
-    std::vector<float> cdf_table = {0.1, 0.4, 0.8, 1};
+    std::vector<WeightScalar> cdf_table = {0.1, 0.4, 0.8, 1};
 
     REQUIRE( test_pf->drawWithReplacement(cdf_table, 0.5) == 2);
     REQUIRE( test_pf->drawWithReplacement(cdf_table, 0.09) == 0);
@@ -66,3 +72,661 @@ TEST_CASE( "Test Particle Filter" ){
     REQUIRE( test_pf->drawWithReplacement(cdf_table, 2) == -1);
 
 }
+
+#ifdef USE_MOCK
+TEST_CASE( "Test FastSLAM 2.0 proposal" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.001f, 0,
+        0, 0.0001f;
+    Eigen::Matrix3f process_noise;
+    process_noise << 0.05f, 0, 0,
+        0, 0.05f, 0,
+        0, 0, 0.01f;
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        Pose2D{.x = 0, .y = 0, .theta_rad = 0}, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0},
+        meas_noise, 10, process_noise);
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    std::vector<struct Observation2D> frame_obs = {{.range_m = 2, .bearing_rad = 0},
+                                                   {.range_m = 3, .bearing_rad = 1.5},
+                                                   {.range_m = 2.5, .bearing_rad = -2}};
+
+    SECTION( "observations pull the sampled pose toward the map" ){
+        // map three landmarks from the true pose
+        FastSLAMParticles particle(0.5, origin, test_manager);
+        for (const auto& it: frame_obs) {
+            particle.updateParticle(it, origin);
+        }
+        REQUIRE( particle.getNumLandMark() == 3 );
+
+        // odometry is off by ~0.36 m, the observations say the robot did not move
+        std::vector<int> labels;
+        float weight = particle.updateParticleProposal(frame_obs, {.x = 0.3, .y = -0.2,
+                                                                   .theta_rad = 0.05},
+                                                       process_noise, labels);
+        REQUIRE( labels == std::vector<int>{0, 1, 2} );
+        // every observation matched, so each one beats the new-landmark factor
+        REQUIRE( weight > 3 * std::log(0.5f) );
+        REQUIRE( particle.getNumLandMark() == 3 );
+        REQUIRE( std::hypot(particle.getPose().x, particle.getPose().y) < 0.1 );
+        REQUIRE( std::abs(particle.getPose().theta_rad) < 0.05 );
+    }
+
+    SECTION( "a particle without a robot manager gets the lowest log weight" ){
+        FastSLAMParticles particle(0.5, origin, nullptr);
+        std::vector<int> labels;
+        float weight = particle.updateParticleProposal(frame_obs, origin,
+                                                       Eigen::Matrix3f::Zero(), labels);
+        REQUIRE( weight == MIN_LOG_LIKELIHOOD );
+        REQUIRE( labels.empty() );
+    }
+
+    SECTION( "unmatched observations start landmarks from the sampled pose" ){
+        FastSLAMParticles particle(0.5, origin, test_manager);
+        std::vector<int> labels;
+        particle.updateParticleProposal(frame_obs, origin, Eigen::Matrix3f::Zero(), labels);
+        REQUIRE( labels == std::vector<int>(3, LABEL_NEW_LANDMARK) );
+        REQUIRE( particle.getNumLandMark() == 3 );
+        REQUIRE_THAT( particle.getLandmarkCoordinates()[0].x, Catch::Matchers::WithinAbs(2.0f, 0.0001f) );
+    }
+
+    SECTION( "new landmarks start in closed form, degenerate sightings are rejected" ){
+        FastSLAMParticles particle(0.5, origin, test_manager);
+        struct Pose2D pose = {.x = 1, .y = -0.5f, .theta_rad = 0.7f};
+        std::vector<struct Observation2D> sightings = {{.range_m = 2, .bearing_rad = 0.3f},
+                                                       {.range_m = 0, .bearing_rad = 0.1f},
+                                                       {.range_m = 4, .bearing_rad = -2.5f}};
+        std::vector<int> labels;
+        particle.updateParticleProposal(sightings, pose, Eigen::Matrix3f::Zero(), labels, 10);
+        REQUIRE( labels == std::vector<int>{LABEL_NEW_LANDMARK, LABEL_INVALID,
+                                            LABEL_NEW_LANDMARK} );
+        REQUIRE( particle.getNumLandMark() == 2 );
+        REQUIRE( particle.getLandmarkUid(1) == 12 );
+
+        for (int i = 0; i < 2; i++) {
+            const LMEKF2D& lm = particle.getLandmark(i);
+            struct Point2D expected = test_manager->inverseMeas(pose, sightings[2 * i]);
+            REQUIRE_THAT( lm.getLMEst().x, Catch::Matchers::WithinAbs(expected.x, 1e-5) );
+            REQUIRE_THAT( lm.getLMEst().y, Catch::Matchers::WithinAbs(expected.y, 1e-5) );
+            Eigen::Matrix2f H_inv = test_manager->measJacobian(pose, expected).inverse();
+            REQUIRE( lm.getLMCov().isApprox(H_inv * meas_noise * H_inv.transpose(), 1e-4f) );
+        }
+    }
+
+    SECTION( "information fusion updates a landmark once per burst" ){
+        FastSLAMParticles sequential(0.5, origin, test_manager);
+        for (const auto& it: frame_obs) {
+            sequential.updateParticle(it, origin);
+        }
+        FastSLAMParticles fused = sequential;
+        fused.setInformationFusion(true);
+        REQUIRE( fused.getInformationFusion() );
+
+        // three readings of the first landmark and one of the second
+        std::vector<struct Observation2D> burst = {{.range_m = 2.01f, .bearing_rad = 0.001f},
+                                                   {.range_m = 3, .bearing_rad = 1.5},
+                                                   {.range_m = 1.99f, .bearing_rad = -0.002f},
+                                                   {.range_m = 2.0f, .bearing_rad = 0.0005f}};
+        std::vector<int> sequential_labels, fused_labels;
+        sequential.updateParticleProposal(burst, origin, Eigen::Matrix3f::Zero(),
+                                          sequential_labels);
+        fused.updateParticleProposal(burst, origin, Eigen::Matrix3f::Zero(), fused_labels);
+        REQUIRE( fused_labels == std::vector<int>{0, 1, 0, 0} );
+        REQUIRE( fused_labels == sequential_labels );
+        REQUIRE( fused.getNumLandMark() == 3 );
+
+        for (int i = 0; i < 2; i++) {
+            const LMEKF2D& expected = sequential.getLandmark(i);
+            const LMEKF2D& actual = fused.getLandmark(i);
+            REQUIRE_THAT( actual.getLMEst().x, Catch::Matchers::WithinAbs(expected.getLMEst().x, 1e-3) );
+            REQUIRE_THAT( actual.getLMEst().y, Catch::Matchers::WithinAbs(expected.getLMEst().y, 1e-3) );
+            REQUIRE( actual.getLMCov().isApprox(expected.getLMCov(), 1e-2f) );
+            REQUIRE( actual.getLMCov()(0, 1) == actual.getLMCov()(1, 0) );
+        }
+    }
+
+    SECTION( "fusion with the motion proposal is reported" ){
+        std::atomic<int> warnings{0};
+        Logging::setSink([&warnings](const std::string& line) {
+            warnings += line.find("information fusion") != std::string::npos;
+        });
+        FastSLAMPF test_pf(test_manager, 10, origin, 0.5);
+        test_pf.setInformationFusion(true);
+        test_pf.setProposal(PF_PROPOSAL::OBSERVATION);
+        test_pf.setProposal(PF_PROPOSAL::MOTION);
+        Logging::flush();
+        Logging::setSink([](const std::string& line) { std::cerr << line << "\n"; });
+        REQUIRE( warnings == 2 );
+    }
+
+    SECTION( "the filter runs in observation-proposal mode" ){
+        FastSLAMPF test_pf(test_manager, 10, origin, 0.5);
+        test_pf.setProposal(PF_PROPOSAL::OBSERVATION);
+        REQUIRE( test_pf.getProposal() == PF_PROPOSAL::OBSERVATION );
+        for (int i = 0; i < 3; i++) {
+            std::queue<struct Observation2D> sightings;
+            for (const auto& it: frame_obs) {
+                sightings.push(it);
+            }
+            test_pf.updateFilter(origin, sightings);
+            REQUIRE( sightings.empty() );
+        }
+        for (const auto& it: test_pf.sampleLandmarks()) {
+            REQUIRE( std::isfinite(it.x) );
+            REQUIRE( std::isfinite(it.y) );
+        }
+    }
+}
+#endif //USE_MOCK
+
+#ifdef USE_MOCK
+TEST_CASE( "Test importance weights" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Identity() * 0.01f);
+    FastSLAMPF test_pf(test_manager, 20, origin, 0.5);
+
+    auto runFrame = [&origin, &test_pf]() {
+        std::queue<struct Observation2D> sightings;
+        sightings.push({.range_m = 2, .bearing_rad = 0});
+        sightings.push({.range_m = 3, .bearing_rad = 1});
+        test_pf.updateFilter(origin, sightings);
+    };
+    auto weightSum = [&test_pf]() {
+        float sum = 0.0f;
+        for (const auto& it: test_pf.getWeights()) {
+            sum += it;
+        }
+        return sum;
+    };
+
+    SECTION( "weights are reset to uniform after every resample" ){
+        runFrame();
+        runFrame();
+        for (const auto& it: test_pf.getWeights()) {
+            REQUIRE_THAT( it, Catch::Matchers::WithinAbs(1.0 / 20, 1e-6) );
+        }
+        REQUIRE( test_pf.returnEst().getNumLandMark() >= 2 );
+    }
+
+    SECTION( "without resampling, weights accumulate and stay normalized" ){
+        test_pf.setResampleThreshold(1e-6f);
+        runFrame();
+        runFrame();
+        runFrame();
+        const std::vector<WeightScalar>& weights = test_pf.getWeights();
+        REQUIRE( weights.size() == 20 );
+        REQUIRE_THAT( weightSum(), Catch::Matchers::WithinAbs(1.0, 1e-5) );
+
+        // the tracked best particle is the highest-weight one
+        int best_idx = test_pf.getBestParticleIndex();
+        REQUIRE( weights[best_idx] == *std::max_element(weights.begin(), weights.end()) );
+        REQUIRE( weights[best_idx] > 1.0f / 20 );
+
+        test_pf.setResampleThreshold(1.0f);
+        runFrame();
+        REQUIRE_THAT( test_pf.getWeights()[0], Catch::Matchers::WithinAbs(1.0 / 20, 1e-6) );
+    }
+}
+
+TEST_CASE( "Test KLD-sampling" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    struct KLDConfig config;
+    config.min_particles = 8;
+    config.max_particles = 200;
+
+    auto runFrames = [&origin](FastSLAMPF& test_pf) {
+        for (int i = 0; i < 3; i++) {
+            std::queue<struct Observation2D> sightings;
+            sightings.push({.range_m = 2, .bearing_rad = 0});
+            test_pf.updateFilter(origin, sightings);
+        }
+    };
+
+    SECTION( "a concentrated posterior shrinks to the minimum" ){
+        std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+            origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+            Eigen::Matrix3f::Zero());
+        FastSLAMPF test_pf(test_manager, 50, origin, 0.5);
+        test_pf.enableKLDSampling(config);
+        runFrames(test_pf);
+        REQUIRE( test_pf.getNumParticles() == config.min_particles );
+        REQUIRE( test_pf.sampleLandmarks().size() == 1 );
+    }
+
+    SECTION( "a spread posterior grows to the maximum" ){
+        // a vague sensor keeps the weights even, so resampling keeps the pose spread
+        std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+            origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0},
+            Eigen::Matrix2f::Identity() * 10, 10, Eigen::Matrix3f::Identity() * 0.05f);
+        FastSLAMPF test_pf(test_manager, 50, origin, 0.5);
+        test_pf.enableKLDSampling(config);
+        std::queue<struct Observation2D> sightings;
+        sightings.push({.range_m = 2, .bearing_rad = 0});
+        test_pf.updateFilter(origin, sightings);
+        REQUIRE( test_pf.getNumParticles() == config.max_particles );
+    }
+
+    SECTION( "disabling keeps the current count" ){
+        std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+            origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+            Eigen::Matrix3f::Zero());
+        FastSLAMPF test_pf(test_manager, 50, origin, 0.5);
+        test_pf.enableKLDSampling(config);
+        runFrames(test_pf);
+        test_pf.disableKLDSampling();
+        runFrames(test_pf);
+        REQUIRE( test_pf.getNumParticles() == config.min_particles );
+    }
+}
+TEST_CASE( "Test frame budget" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+    FastSLAMPF test_pf(test_manager, 10, origin, 0.5);
+    Metrics::Registry registry;
+    Metrics::FilterMetrics metrics(registry);
+    test_pf.attachMetrics(&metrics);
+
+    struct BudgetConfig config;
+    config.hysteresis_frames = 1;
+    config.min_particles = 5;
+    config.max_particles = 40;
+    config.min_observations = 2;
+
+    auto runFrames = [&origin, &test_pf](int num_frames) {
+        for (int i = 0; i < num_frames; i++) {
+            std::queue<struct Observation2D> sightings;
+            for (int j = 0; j < 6; j++) {
+                sightings.push({.range_m = 1.0f + j, .bearing_rad = 0.5f * j});
+            }
+            test_pf.updateFilter(origin, sightings);
+            REQUIRE( sightings.empty() );
+        }
+    };
+
+    SECTION( "an impossible deadline degrades to the floors" ){
+        config.deadline_us = 1.0;
+        test_pf.enableBudget(config);
+        runFrames(10);
+        REQUIRE( test_pf.getNumParticles() == config.min_particles );
+        REQUIRE( test_pf.sampleLandmarks().size() == 2 );
+        REQUIRE( metrics.observations.value() == 2 * 10 );
+        REQUIRE( metrics.observations_shed.value() == 4 * 10 );
+        REQUIRE( metrics.deadline_overruns.value() == 10 );
+        REQUIRE( metrics.budget_shrink_particles.value() > 0 );
+        REQUIRE( metrics.particle_budget.value() == config.min_particles );
+    }
+
+    SECTION( "the observation proposal drops what past frames say will not fit" ){
+        test_pf.setProposal(PF_PROPOSAL::OBSERVATION);
+        config.deadline_us = 1.0;
+        test_pf.enableBudget(config);
+        runFrames(10);
+        REQUIRE( test_pf.getNumParticles() == config.min_particles );
+        // the first frame has no cost estimate yet and takes every observation
+        REQUIRE( metrics.observations.value() == 6 + 2 * 9 );
+        REQUIRE( metrics.observations_shed.value() == 4 * 9 );
+        REQUIRE( metrics.deadline_overruns.value() == 10 );
+    }
+
+    SECTION( "a generous deadline grows to the ceiling" ){
+        config.deadline_us = 1e7;
+        test_pf.enableBudget(config);
+        runFrames(20);
+        REQUIRE( test_pf.getNumParticles() == config.max_particles );
+        REQUIRE( test_pf.getLastBudgetDecision().observation_cap == UNLIMITED_OBSERVATIONS );
+        REQUIRE( metrics.observations_shed.value() == 0 );
+        REQUIRE( metrics.budget_grow_particles.value() > 0 );
+
+        test_pf.disableBudget();
+        runFrames(1);
+        REQUIRE( test_pf.getNumParticles() == config.max_particles );
+    }
+}
+
+TEST_CASE( "Test world coordinates far from the origin" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    // coordinates keep CoordScalar precision, relative quantities stay float
+    const CoordScalar far_x = 1e6;
+    const double tolerance =
+        std::max<double>(1e-4, 4 * far_x * std::numeric_limits<CoordScalar>::epsilon());
+    struct Pose2D far_pose = {.x = far_x + CoordScalar(0.3), .y = 0, .theta_rad = 0};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        far_pose, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+
+    FastSLAMParticles particle(0.5, far_pose, test_manager);
+    particle.updateParticle({.range_m = 2, .bearing_rad = 0}, far_pose, 0);
+    REQUIRE_THAT( particle.getLandmark(0).getLMEst().x - far_x,
+                  Catch::Matchers::WithinAbs(2.3, tolerance) );
+    REQUIRE_THAT( MathUtil::findDist(particle.getLandmark(0).getLMEst(), far_pose),
+                  Catch::Matchers::WithinAbs(2.0, tolerance) );
+
+    // the consensus mean is taken in CoordScalar as well
+    FastSLAMParticles other(0.5, far_pose, test_manager);
+    other.updateParticle({.range_m = 3, .bearing_rad = 0}, far_pose, 0);
+    std::vector<FastSLAMParticles> particles = {particle, other};
+    ConsensusMap map;
+    map.touch(0);
+    map.refresh(particles, {0.25f, 0.75f});
+    REQUIRE_THAT( map.find(0)->mean.x - far_x,
+                  Catch::Matchers::WithinAbs(0.25 * 2.3 + 0.75 * 3.3, tolerance) );
+}
+
+TEST_CASE( "Test multi-robot" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    struct Pose2D facing_back = {.x = 10, .y = 0, .theta_rad = static_cast<float>(M_PI)};
+    std::shared_ptr<RobotManager2D> first_robot = std::make_shared<MockManager2D>(
+        origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+    std::shared_ptr<RobotManager2D> second_robot = std::make_shared<MockManager2D>(
+        facing_back, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+
+    // both robots see the landmark at (2, 0)
+    std::vector<struct RobotFrame> frames = {
+        {.robot_id = 0, .pose_mean = origin, .observations = {{.range_m = 2, .bearing_rad = 0}}},
+        {.robot_id = 1, .pose_mean = facing_back,
+         .observations = {{.range_m = 8, .bearing_rad = 0}}}};
+
+    SECTION( "robots added to a filter share one map" ){
+        FastSLAMPF test_pf(first_robot, 20, origin, 0.5);
+        REQUIRE( test_pf.addRobot(second_robot, facing_back) == 1 );
+        REQUIRE( test_pf.getNumRobots() == 2 );
+        REQUIRE( test_pf.addRobot(nullptr, origin) == -1 );
+
+        test_pf.updateFleet(frames);
+        test_pf.updateFleet(frames, 4);
+        const FastSLAMParticles& est = test_pf.returnEst();
+        REQUIRE( est.getNumRobots() == 2 );
+        REQUIRE( est.getNumLandMark() == 1 );
+        REQUIRE_THAT( est.getRobotPose(1).x, Catch::Matchers::WithinAbs(10, 1e-4) );
+        REQUIRE_THAT( est.getLandmark(0).getLMEst().x, Catch::Matchers::WithinAbs(2, 1e-3) );
+        REQUIRE( test_pf.getConsensusMap().getLandmarks().size() == 1 );
+    }
+
+#ifdef PF_PROFILING
+    SECTION( "every worker's stage timings reach the profile" ){
+        FastSLAMPF test_pf(first_robot, 20, origin, 0.5);
+        REQUIRE( test_pf.addRobot(second_robot, facing_back) == 1 );
+        test_pf.resetStageProfile();
+
+        test_pf.updateFleet(frames, 2);
+        test_pf.updateFleet(frames, 2);
+        const Profiler::StageProfile& profile = test_pf.getStageProfile();
+        REQUIRE( profile[Profiler::Stage::ASSOCIATION].count() == 2 * 20 * frames.size() );
+        REQUIRE( profile[Profiler::Stage::FRAME].count() == 2 );
+    }
+#endif // PF_PROFILING
+
+    SECTION( "a frame of an unknown robot gets the lowest log weight" ){
+        FastSLAMParticles particle(0.5, origin, first_robot);
+        std::vector<int> labels;
+        float weight = particle.updateRobotProposal(1, second_robot, frames[1].observations,
+                                                    facing_back, Eigen::Matrix3f::Zero(),
+                                                    labels);
+        REQUIRE( weight == MIN_LOG_LIKELIHOOD );
+        REQUIRE( particle.getNumLandMark() == 0 );
+    }
+
+    SECTION( "aligned maps are merged into one" ){
+        FastSLAMPF test_pf(first_robot, 20, origin, 0.5);
+        FastSLAMPF other_pf(second_robot, 10, facing_back, 0.5);
+        std::queue<struct Observation2D> sightings;
+        sightings.push({.range_m = 2, .bearing_rad = 0});
+        test_pf.updateFilter(origin, sightings);
+        sightings.push({.range_m = 8, .bearing_rad = 0});
+        sightings.push({.range_m = 3, .bearing_rad = static_cast<float>(-M_PI / 2)});
+        other_pf.updateFilter(facing_back, sightings);
+
+        REQUIRE( test_pf.mergeRobot(second_robot, other_pf) == 1 );
+        const FastSLAMParticles& est = test_pf.returnEst();
+        REQUIRE( est.getNumLandMark() == 2 );
+        REQUIRE_THAT( est.getRobotPose(1).x, Catch::Matchers::WithinAbs(10, 1e-4) );
+        REQUIRE_THAT( est.getLandmark(1).getLMEst().y, Catch::Matchers::WithinAbs(3, 1e-3) );
+        REQUIRE( test_pf.getConsensusMap().getLandmarks().size() == 2 );
+
+        // the merged robot keeps associating against the shared map
+        test_pf.updateFleet({{.robot_id = 1, .pose_mean = facing_back,
+                              .observations = {{.range_m = 3,
+                                                .bearing_rad = static_cast<float>(-M_PI / 2)}}}});
+        REQUIRE( test_pf.returnEst().getNumLandMark() == 2 );
+    }
+
+    SECTION( "landmarks frozen in the other filter's submaps are merged" ){
+        FastSLAMPF test_pf(first_robot, 20, origin, 0.5);
+        FastSLAMPF other_pf(second_robot, 10, facing_back, 0.5);
+        other_pf.enableSubmaps({.region_size_m = 1.0f, .active_radius = 0});
+        std::queue<struct Observation2D> sightings;
+        sightings.push({.range_m = 2, .bearing_rad = 0});
+        test_pf.updateFilter(origin, sightings);
+        sightings.push({.range_m = 8, .bearing_rad = 0});
+        sightings.push({.range_m = 3, .bearing_rad = static_cast<float>(-M_PI / 2)});
+        other_pf.updateFilter(facing_back, sightings);
+        // moving to the next region freezes both landmarks
+        other_pf.updateFilter({.x = 11, .y = 0, .theta_rad = static_cast<float>(M_PI)},
+                              sightings);
+        REQUIRE( other_pf.returnEst().getNumLandMark() == 0 );
+        REQUIRE( other_pf.returnEst().getNumFrozenLandMark() == 2 );
+
+        REQUIRE( test_pf.mergeRobot(second_robot, other_pf) == 1 );
+        const FastSLAMParticles& est = test_pf.returnEst();
+        REQUIRE( est.getNumLandMark() == 2 );
+        REQUIRE_THAT( est.getLandmark(1).getLMEst().y, Catch::Matchers::WithinAbs(3, 1e-3) );
+        REQUIRE( test_pf.getConsensusMap().getLandmarks().size() == 2 );
+    }
+
+    SECTION( "particles without the matched landmark get it appended" ){
+        FastSLAMPF test_pf(first_robot, 20, origin, 0.5);
+        FastSLAMPF other_pf(second_robot, 10, facing_back, 0.5);
+        std::queue<struct Observation2D> sightings;
+        sightings.push({.range_m = 2, .bearing_rad = 0});
+        test_pf.updateFilter(origin, sightings);
+        sightings.push({.range_m = 8, .bearing_rad = 0});
+        sightings.push({.range_m = 3, .bearing_rad = static_cast<float>(-M_PI / 2)});
+        other_pf.updateFilter(facing_back, sightings);
+
+        // matching uses the best particle, every other particle loses the landmark
+        int best = test_pf.getBestParticleIndex();
+        uint32_t matched_uid = test_pf.returnEst().getLandmarkUid(0);
+        for (int i = 0; i < 20; i++) {
+            if (i != best) FastSLAMBench::particle(test_pf, i).clearLandmarks();
+        }
+
+        REQUIRE( test_pf.mergeRobot(second_robot, other_pf) == 1 );
+        for (int i = 0; i < 20; i++) {
+            const FastSLAMParticles& it = FastSLAMBench::particle(test_pf, i);
+            REQUIRE( it.getNumLandMark() == 2 );
+            REQUIRE( it.getLandmarkUid(0) < it.getLandmarkUid(1) );
+            REQUIRE( (i == best) == (it.findLandmark(matched_uid) == 0) );
+            REQUIRE_THAT( it.getLandmark(0).getLMEst().x, Catch::Matchers::WithinAbs(2, 1e-2) );
+        }
+        // the fused landmark, its unfused copy and the new landmark
+        REQUIRE( test_pf.getConsensusMap().getLandmarks().size() == 3 );
+    }
+}
+
+TEST_CASE( "Test landmark staging in the filter" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+
+    for (PF_PROPOSAL proposal: {PF_PROPOSAL::MOTION, PF_PROPOSAL::OBSERVATION}) {
+        FastSLAMPF test_pf(test_manager, 10, origin, 0.5);
+        test_pf.setProposal(proposal);
+        test_pf.enableStaging({.min_sightings = 3, .window_frames = 5, .gate_m = 0.5f});
+
+        for (int frame = 0; frame < 6; frame++) {
+            // the landmark at (2, 0) every frame, and clutter somewhere new each frame
+            std::queue<struct Observation2D> sightings;
+            sightings.push({.range_m = 2, .bearing_rad = 0});
+            sightings.push({.range_m = 3.0f + frame, .bearing_rad = 1.0f + 0.7f * frame});
+            test_pf.updateFilter(origin, sightings);
+
+            int expected_landmarks = frame < 2 ? 0 : 1;
+            REQUIRE( test_pf.returnEst().getNumLandMark() == expected_landmarks );
+        }
+        REQUIRE_THAT( test_pf.returnEst().getLandmark(0).getLMEst().x,
+                      Catch::Matchers::WithinAbs(2.0f, 0.01f) );
+        REQUIRE( test_pf.getConsensusMap().getLandmarks().size() == 1 );
+        // clutter of the last window_frames frames is still tentative
+        REQUIRE( test_pf.getStaging().getTentative().size() == 5 );
+
+        test_pf.disableStaging();
+        REQUIRE( test_pf.getStaging().getTentative().empty() );
+        std::queue<struct Observation2D> sightings;
+        sightings.push({.range_m = 5, .bearing_rad = -1});
+        test_pf.updateFilter(origin, sightings);
+        REQUIRE( test_pf.returnEst().getNumLandMark() == 2 );
+    }
+}
+
+TEST_CASE( "Test converged landmarks in the filter" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+
+    for (PF_PROPOSAL proposal: {PF_PROPOSAL::MOTION, PF_PROPOSAL::OBSERVATION}) {
+        for (bool info_fusion: {false, true}) {
+            // a low importance factor keeps associating the landmark once it moved
+            FastSLAMPF test_pf(test_manager, 5, origin, 1e-3);
+            test_pf.setProposal(proposal);
+            test_pf.setInformationFusion(info_fusion);
+            test_pf.enableConvergence({.trace_threshold = 2e-3f, .thaw_gate = 9.21f});
+
+            int frames = 0;
+            while (test_pf.returnEst().getNumConvergedLandMark() == 0 && frames < 100) {
+                std::queue<struct Observation2D> sightings;
+                sightings.push({.range_m = 2, .bearing_rad = 0});
+                test_pf.updateFilter(origin, sightings);
+                frames++;
+            }
+            REQUIRE( frames < 100 );
+            REQUIRE( test_pf.returnEst().getNumLandMark() == 1 );
+            Eigen::Matrix2f converged_cov = test_pf.returnEst().getLandmark(0).getLMCov();
+            float converged_x = test_pf.returnEst().getLandmark(0).getLMEst().x;
+
+            std::queue<struct Observation2D> sightings;
+            sightings.push({.range_m = 2.02f, .bearing_rad = 0});
+            sightings.push({.range_m = 2, .bearing_rad = 0});
+            test_pf.updateFilter(origin, sightings);
+            REQUIRE( test_pf.returnEst().getLandmark(0).getLMCov() == converged_cov );
+            REQUIRE( test_pf.returnEst().getLandmark(0).getLMEst().x == converged_x );
+
+            // the landmark moved, the filter follows it again
+            for (int i = 0; i < 5; i++) {
+                sightings.push({.range_m = 2.4f, .bearing_rad = 0});
+                test_pf.updateFilter(origin, sightings);
+            }
+            REQUIRE( test_pf.returnEst().getNumLandMark() == 1 );
+            REQUIRE_THAT( test_pf.returnEst().getLandmark(0).getLMEst().x,
+                          Catch::Matchers::WithinAbs(2.4f, 0.05f) );
+
+            test_pf.disableConvergence();
+        }
+    }
+}
+
+TEST_CASE( "Test localization against a prior map" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    Eigen::Matrix3f process_noise = Eigen::Vector3f(0.04f, 0.04f, 0.0004f).asDiagonal();
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        process_noise);
+
+    std::vector<struct PriorLandmark> landmarks;
+    for (const struct Point2D& it: std::vector<struct Point2D>{{.x = 3, .y = 0}, {.x = 0, .y = 3},
+                                                               {.x = -3, .y = 1},
+                                                               {.x = 2, .y = -2}}) {
+        landmarks.push_back({.uid = static_cast<uint32_t>(landmarks.size()), .mean = it,
+                             .cov = 1e-4f * Eigen::Matrix2f::Identity()});
+    }
+    auto prior_map = std::make_shared<const PriorMap>(landmarks, 2.0f);
+
+    // odometry is off by 0.25 m; the observations are taken from the origin
+    struct Pose2D odometry = {.x = 0.2f, .y = -0.15f, .theta_rad = 0};
+    FastSLAMPF test_pf(test_manager, 200, odometry, 0.01);
+    std::queue<struct Observation2D> sightings;
+    sightings.push({.range_m = 3, .bearing_rad = 0});
+    test_pf.updateFilter(odometry, sightings);
+    REQUIRE( test_pf.returnEst().getNumLandMark() == 1 );
+
+    test_pf.enableLocalization(prior_map, {.search_radius_m = 1.0f});
+    REQUIRE( test_pf.isLocalizing() );
+    REQUIRE( test_pf.returnEst().getNumLandMark() == 0 );
+    REQUIRE( test_pf.getConsensusMap().getLandmarks().empty() );
+
+    for (int frame = 0; frame < 3; frame++) {
+        for (const auto& it: landmarks) {
+            sightings.push(test_manager->predictMeas(origin, it.mean));
+        }
+        // clutter matches nothing and weighs every particle the same
+        sightings.push({.range_m = 8, .bearing_rad = 2.5f});
+        test_pf.updateFilter(odometry, sightings);
+
+        const struct Pose2D& best = test_pf.returnEst().getPose();
+        REQUIRE( std::hypot(best.x, best.y) < 0.15f );
+        REQUIRE( test_pf.returnEst().getNumLandMark() == 0 );
+    }
+
+    SECTION( "a particle without a robot manager gets the lowest log weight" ){
+        FastSLAMParticles particle(0.5, origin, nullptr);
+        int num_matched = -1;
+        float weight = particle.localizeParticle({{.range_m = 3, .bearing_rad = 0}}, origin,
+                                                 *prior_map, {.search_radius_m = 1.0f},
+                                                 num_matched);
+        REQUIRE( weight == MIN_LOG_LIKELIHOOD );
+        REQUIRE( num_matched == 0 );
+    }
+
+    SECTION( "fleet updates are refused" ){
+        struct Pose2D before = test_pf.returnEst().getPose();
+        test_pf.updateFleet({{.robot_id = 0, .pose_mean = odometry,
+                              .observations = {{.range_m = 3, .bearing_rad = 0}}}});
+        REQUIRE( test_pf.returnEst().getPose().x == before.x );
+        REQUIRE( test_pf.returnEst().getNumLandMark() == 0 );
+    }
+
+    SECTION( "merging another robot is refused" ){
+        FastSLAMPF other_pf(test_manager, 10, origin, 0.5);
+        REQUIRE( test_pf.mergeRobot(test_manager, other_pf) == -1 );
+        REQUIRE( test_pf.getNumRobots() == 1 );
+        REQUIRE( test_pf.returnEst().getNumRobots() == 1 );
+    }
+
+    SECTION( "mapping resumes once localization is disabled" ){
+        test_pf.disableLocalization();
+        REQUIRE_FALSE( test_pf.isLocalizing() );
+        sightings.push({.range_m = 3, .bearing_rad = 0});
+        test_pf.updateFilter(odometry, sightings);
+        REQUIRE( test_pf.returnEst().getNumLandMark() == 1 );
+    }
+}
+#endif //USE_MOCK
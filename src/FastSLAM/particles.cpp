@@ -4,25 +4,32 @@
  */
 
 #include "particle-filter.h"
+#include "logging.h"
+#include <algorithm>
+#include <cfloat>
 
-FastSLAMParticles::FastSLAMParticles(const FastSLAMParticles& part):
-    m_importance_factor(part.m_importance_factor),
-    m_robot_pose(part.m_robot_pose),
-    m_data_label(part.m_data_label),
-    m_robot(part.m_robot){
-    for (const auto& it: m_lmekf_bank){
-        m_lmekf_bank.push_back(std::make_pair(std::make_unique<LMEKF2D>(*it.first.get()), it.second));
-    }
+namespace {
+
+/**
+ * @brief log a SQUARE_ROOT correction that completed in JOSEPH form, then treat it as done
+ */
+KF_RET acceptFallback(KF_RET status, int label) {
+    if (status != KF_RET::COV_FORM_FALLBACK) return status;
+    PF_LOG_WARN("landmark covariance has no square root, corrected in Joseph form",
+                "landmark", label);
+    return KF_RET::SUCCESS;
 }
 
+} // namespace
+
 int FastSLAMParticles::matchLandmark(const struct Observation2D& curr_obs) {
     float w_0 = this->m_importance_factor;
     int landmark_id = m_lmekf_bank.size();
     int idx = 0;
 
-    for (auto const& it: m_lmekf_bank) {
-        it.first->updateObservation(curr_obs);
-        float w_n = it.first->calcCPD();
+    for (auto& it: m_lmekf_bank) {
+        it.first.updateObservation(curr_obs);
+        float w_n = it.first.calcCPD();
         landmark_id = w_n > w_0 ? idx : landmark_id;
         idx++;
     }
@@ -32,44 +39,38 @@ int FastSLAMParticles::matchLandmark(const struct Observation2D& curr_obs) {
     return landmark_id;
 }
 
-PF_RET FastSLAMParticles::updateLMBelief(const struct Observation2D& curr_obs){
+PF_RET FastSLAMParticles::updateLMBelief(const struct Observation2D& curr_obs,
+                                         uint32_t new_uid, bool stage_new){
     if (m_robot == nullptr) {
-        // appropriate error handling here
-        std::cout << "non-robot manager specified" << std::endl;
+        PF_LOG_ERROR("no robot manager specified");
         return PF_RET::EMPTY_ROBOT_MANAGER;
     }
     if (m_data_label == m_lmekf_bank.size()) {
-        // initiate new EKF
-        struct Point2D proposed_mean = m_robot->inverseMeas(m_robot_pose, curr_obs);
-        auto meas_jacobian = m_robot->measJacobian(proposed_mean);
-
-        Eigen::Matrix2f proposed_cov;
-        if (meas_jacobian.determinant() == 0) {
-            // log error here
-            std::cout << "Non-invertible matrix" << std::endl;
-            proposed_cov = Eigen::Matrix2f::Identity();
-        } else {
-            proposed_cov = meas_jacobian.inverse() * m_robot->getMeasNoise() *
-                meas_jacobian.inverse().transpose();
+        if (stage_new) {
+            m_last_assoc = PF_ASSOC::TENTATIVE;
+            return PF_RET::SUCCESS;
         }
-
-        std::unique_ptr<LMEKF2D> new_lmefk =
-            std::make_unique<LMEKF2D>(proposed_mean, proposed_cov, m_robot);
-        m_lmekf_bank.push_back(std::make_pair(std::move(new_lmefk), 1));
+        int label = LABEL_NEW_LANDMARK;
+        if (initLandmarks(m_robot_pose, m_robot, &curr_obs, &label, 1, new_uid) == 0) {
+            m_last_assoc = PF_ASSOC::REJECTED;
+            return PF_RET::UPDATE_ERROR;
+        }
+        m_last_assoc = PF_ASSOC::NEW_LANDMARK;
         return PF_RET::SUCCESS;
     } else {
-        LMEKF2D * filter_to_update = m_lmekf_bank[m_data_label].first.get();
-        filter_to_update->updateObservation(curr_obs);
-        auto status = filter_to_update->update();
+        // matchLandmark stored the observation and left its innovation in the landmark
+        LMEKF2D * filter_to_update = &m_lmekf_bank[m_data_label].first;
+        auto status = acceptFallback(filter_to_update->update(m_cov_form, convergencePolicy()),
+                                     m_data_label);
+        m_last_assoc = status == KF_RET::SUCCESS ? PF_ASSOC::MATCHED : PF_ASSOC::REJECTED;
 
         switch (status) {
             case KF_RET::EMPTY_ROBOT_MANAGER:
-                // error handling
-                std::cout << "non-robot manager specified" << std::endl;
+                PF_LOG_ERROR("no robot manager specified");
                 return PF_RET::EMPTY_ROBOT_MANAGER;
             case KF_RET::MATRIX_INVERSION_ERROR:
-                // error handling
-                std::cout << "Kalman Filter failed to converge" << std::endl;
+                PF_LOG_ERROR("landmark EKF update failed to invert innovation covariance",
+                             "landmark", m_data_label);
                 return PF_RET::MATRIX_INVERSION_ERROR;
             default:
                 m_lmekf_bank[m_data_label].second++;
@@ -88,7 +89,7 @@ void FastSLAMParticles::cleanUpSightings() {
             continue;
         }
 
-        if ( MathUtil::findDist(it.first->getLMEst(), m_robot_pose) <=
+        if ( MathUtil::findDist(it.first.getLMEst(), m_robot_pose) <=
              m_robot->getPerceptualRange() ) {
             it.second--;
         }
@@ -96,35 +97,511 @@ void FastSLAMParticles::cleanUpSightings() {
 }
 #endif
 
+int FastSLAMParticles::initLandmarks(const struct Pose2D& robot_pose,
+                                     const std::shared_ptr<RobotManager2D>& robot,
+                                     const struct Observation2D* obs, int* labels, int count,
+                                     uint32_t first_uid) {
+    int num_new = std::count(labels, labels + count, LABEL_NEW_LANDMARK);
+    if (num_new == 0) return 0;
+    // keep geometric growth when a frame explores a new area
+    size_t needed = m_lmekf_bank.size() + num_new;
+    if (m_lmekf_bank.capacity() < needed) {
+        m_lmekf_bank.reserve(std::max(needed, 2 * m_lmekf_bank.size()));
+        m_lm_uids.reserve(m_lmekf_bank.capacity());
+    }
+
+    const Eigen::Matrix2f meas_noise = robot->getMeasNoise();
+    int num_started = 0;
+    for (int j = 0; j < count; j++) {
+        if (labels[j] != LABEL_NEW_LANDMARK) continue;
+        float range = obs[j].range_m;
+        if (!(range > 0) || !std::isfinite(range) || !std::isfinite(obs[j].bearing_rad)) {
+            labels[j] = LABEL_INVALID;
+            continue;
+        }
+
+        float heading = robot_pose.theta_rad + obs[j].bearing_rad;
+        float cos_h = std::cos(heading);
+        float sin_h = std::sin(heading);
+        // jacobian of the landmark position with respect to (range, bearing)
+        Eigen::Matrix2f J;
+        J << cos_h, -range * sin_h,
+             sin_h, range * cos_h;
+        Eigen::Matrix2f cov = J * meas_noise * J.transpose();
+        cov = 0.5f * (cov + cov.transpose()).eval();
+        struct Point2D mean = {.x = robot_pose.x + range * cos_h,
+                               .y = robot_pose.y + range * sin_h};
+
+        m_lmekf_bank.emplace_back(std::piecewise_construct,
+                                  std::forward_as_tuple(mean, cov, robot),
+                                  std::forward_as_tuple(1));
+        m_lm_uids.push_back(first_uid == LM_UID_NONE ? LM_UID_NONE : first_uid + j);
+        num_started++;
+    }
+    if (num_started > 0) m_data_label = m_lmekf_bank.size() - 1;
+    return num_started;
+}
+
 PF_RET FastSLAMParticles::updatePose(const struct Pose2D& new_pose) {
     m_robot_pose = new_pose;
     return PF_RET::SUCCESS;
 }
 
 float FastSLAMParticles::updateParticle(const struct Observation2D& new_obs,
-                                      const struct Pose2D& new_pose) {
+                                      const struct Pose2D& new_pose,
+                                      uint32_t new_uid,
+                                      bool stage_new) {
     if (m_robot == nullptr) {
-        std::cout << "No robot manager specified" << std::endl;
+        PF_LOG_ERROR("no robot manager specified");
         return -1.0;
     }
     int res_code = 0;
     res_code += static_cast<int>(updatePose(new_pose));
-    matchLandmark(new_obs);
-    res_code += static_cast<int>(updateLMBelief(new_obs));
+    {
+        PF_PROFILE_SCOPE(Profiler::Stage::ASSOCIATION);
+        matchLandmark(new_obs);
+    }
+    {
+        PF_PROFILE_SCOPE(Profiler::Stage::EKF_UPDATE);
+        m_last_update_status = updateLMBelief(new_obs, new_uid, stage_new);
+        res_code += static_cast<int>(m_last_update_status);
+    }
 
 #ifdef LM_CLEANUP
     cleanUpSightings();
 #endif //LM_CLEANUP
 
+    PF_PROFILE_SCOPE(Profiler::Stage::WEIGHTING);
+    // a staged observation is weighted like the start of a new landmark
+    if (m_last_assoc == PF_ASSOC::TENTATIVE && res_code == static_cast<int>(PF_RET::SUCCESS)) {
+        return m_importance_factor;
+    }
     return res_code == static_cast<int>(PF_RET::SUCCESS) ?
-        m_lmekf_bank[m_data_label].first->calcCPD() :
+        m_lmekf_bank[m_data_label].first.calcCPD() :
         static_cast<float>(PF_RET::UPDATE_ERROR);
 }
 
+float FastSLAMParticles::updateParticleProposal(const std::vector<struct Observation2D>& frame_obs,
+                                               const struct Pose2D& pose_mean,
+                                               const Eigen::Matrix3f& pose_cov,
+                                               std::vector<int>& labels,
+                                               uint32_t first_uid,
+                                               bool stage_new) {
+    return proposalUpdate(m_robot_pose, m_robot, frame_obs, pose_mean, pose_cov, labels,
+                          first_uid, stage_new);
+}
+
+float FastSLAMParticles::updateRobotProposal(unsigned int robot_id,
+                                             const std::shared_ptr<RobotManager2D>& robot,
+                                             const std::vector<struct Observation2D>& frame_obs,
+                                             const struct Pose2D& pose_mean,
+                                             const Eigen::Matrix3f& pose_cov,
+                                             std::vector<int>& labels,
+                                             uint32_t first_uid) {
+    if (robot_id > m_fleet_poses.size()) {
+        labels.clear();
+        PF_LOG_ERROR("unknown robot", "robot", robot_id);
+        return MIN_LOG_LIKELIHOOD;
+    }
+    struct Pose2D& pose = robot_id == 0 ? m_robot_pose : m_fleet_poses[robot_id - 1];
+    return proposalUpdate(pose, robot, frame_obs, pose_mean, pose_cov, labels, first_uid,
+                          false);
+}
+
+float FastSLAMParticles::proposalUpdate(struct Pose2D& robot_pose,
+                                        const std::shared_ptr<RobotManager2D>& robot,
+                                        const std::vector<struct Observation2D>& frame_obs,
+                                        const struct Pose2D& pose_mean,
+                                        const Eigen::Matrix3f& pose_cov,
+                                        std::vector<int>& labels,
+                                        uint32_t first_uid,
+                                        bool stage_new) {
+    labels.clear();
+    if (robot == nullptr) {
+        PF_LOG_ERROR("no robot manager specified");
+        return MIN_LOG_LIKELIHOOD;
+    }
+    const Eigen::Matrix2f meas_noise = robot->getMeasNoise();
+    struct Pose2D proposal_mean = pose_mean;
+    Eigen::Matrix3f proposal_cov = pose_cov;
+    float weight = 0.0f;
+
+    {
+        PF_PROFILE_SCOPE(Profiler::Stage::ASSOCIATION);
+        for (const auto& obs: frame_obs) {
+            int best_idx = LABEL_NEW_LANDMARK;
+            float best_w = m_importance_factor;
+            Eigen::Matrix<float, 2, 3> best_pose_jacobian = Eigen::Matrix<float, 2, 3>::Zero();
+            Eigen::Matrix2f best_cov = Eigen::Matrix2f::Zero();
+            Eigen::Vector2f best_innovation = Eigen::Vector2f::Zero();
+
+            for (int i = 0; i < m_lmekf_bank.size(); i++) {
+                const LMEKF2D& lm = m_lmekf_bank[i].first;
+                Eigen::Matrix2f H_m = robot->measJacobian(proposal_mean, lm.getLMEst());
+                Eigen::Matrix<float, 2, 3> H_x = robot->poseJacobian(proposal_mean,
+                                                                     lm.getLMEst());
+                // innovation covariance including the remaining pose uncertainty
+                Eigen::Matrix2f L = H_x * proposal_cov * H_x.transpose() +
+                    H_m * lm.getLMCov() * H_m.transpose() + meas_noise;
+                Eigen::Vector2f innovation = obs - robot->predictMeas(proposal_mean,
+                                                                      lm.getLMEst());
+                innovation(1) = MathUtil::wrapAngle(innovation(1));
+
+                float w_n = MathUtil::gaussianPdf2D(innovation, L);
+                if (w_n > best_w) {
+                    best_idx = i;
+                    best_w = w_n;
+                    best_pose_jacobian = H_x;
+                    best_cov = L;
+                    best_innovation = innovation;
+                }
+            }
+            labels.push_back(best_idx);
+            weight += std::log(std::max(best_w, FLT_MIN));
+            if (best_idx == LABEL_NEW_LANDMARK) continue;
+
+            // condition the proposal on the match; the gain form tolerates a singular motion
+            // covariance, where the proposal collapses onto the mean
+            Eigen::Matrix<float, 3, 2> K = proposal_cov * best_pose_jacobian.transpose() *
+                best_cov.inverse();
+            proposal_mean += K * best_innovation;
+            proposal_cov = (Eigen::Matrix3f::Identity() - K * best_pose_jacobian) * proposal_cov;
+            proposal_cov = 0.5f * (proposal_cov + proposal_cov.transpose()).eval();
+        }
+    }
+
+    {
+        PF_PROFILE_SCOPE(Profiler::Stage::SAMPLE_POSE);
+        robot_pose = proposal_mean;
+        robot_pose += MathUtil::sampleMultivariateNormal(proposal_cov);
+        robot_pose.theta_rad = MathUtil::wrapAngle(robot_pose.theta_rad);
+    }
+
+    PF_PROFILE_SCOPE(Profiler::Stage::EKF_UPDATE);
+    // the information form needs the inverse sensor noise; a noiseless sensor updates in turn
+    float noise_det = meas_noise.determinant();
+    bool fuse_frame = m_info_fusion && noise_det != 0 && std::isfinite(noise_det);
+    if (fuse_frame) {
+        fuseFrameInformation(robot_pose, *robot, meas_noise.inverse(), frame_obs, labels);
+    }
+    if (stage_new) {
+        std::replace(labels.begin(), labels.end(), LABEL_NEW_LANDMARK, LABEL_TENTATIVE);
+    } else if (initLandmarks(robot_pose, robot, frame_obs.data(), labels.data(),
+                             frame_obs.size(), first_uid) > 0) {
+        m_last_assoc = PF_ASSOC::NEW_LANDMARK;
+    }
+    for (int j = 0; j < frame_obs.size(); j++) {
+        if (labels[j] < 0) continue;
+        if (fuse_frame) continue;
+
+        LMEKF2D& lm = m_lmekf_bank[labels[j]].first;
+        lm.updateObservation(frame_obs[j]);
+        m_data_label = labels[j];
+        KF_RET status = lm.update(robot_pose, *robot, m_cov_form, convergencePolicy());
+        if (acceptFallback(status, labels[j]) == KF_RET::SUCCESS) {
+            m_lmekf_bank[labels[j]].second++;
+            m_last_assoc = PF_ASSOC::MATCHED;
+        } else {
+            PF_LOG_ERROR("landmark EKF update failed to invert innovation covariance",
+                         "landmark", labels[j]);
+            labels[j] = LABEL_REJECTED;
+            m_last_assoc = PF_ASSOC::REJECTED;
+        }
+    }
+    return weight;
+}
+
+void FastSLAMParticles::fuseFrameInformation(const struct Pose2D& robot_pose,
+                                             RobotManager2D& robot,
+                                             const Eigen::Matrix2f& noise_inv,
+                                             const std::vector<struct Observation2D>& frame_obs,
+                                             std::vector<int>& labels) {
+    // m_fusion_info and m_fusion_thawed are empty between frames
+    for (int j = 0; j < frame_obs.size(); j++) {
+        if (labels[j] < 0) continue;
+        LMEKF2D& lm = m_lmekf_bank[labels[j]].first;
+        bool was_converged = lm.isConverged();
+        if (lm.absorbConverged(robot_pose, robot, frame_obs[j], convergencePolicy())) {
+            m_lmekf_bank[labels[j]].second++;
+            m_data_label = labels[j];
+            m_last_assoc = PF_ASSOC::MATCHED;
+            continue;
+        }
+        if (was_converged && !lm.isConverged()) m_fusion_thawed.push_back(labels[j]);
+        // frames see few landmarks, a linear search beats a map
+        auto entry = std::find_if(m_fusion_info.begin(), m_fusion_info.end(),
+                                  [&](const auto& it) { return it.first == labels[j]; });
+        if (entry == m_fusion_info.end()) {
+            m_fusion_info.emplace_back(labels[j], LMInformation());
+            entry = m_fusion_info.end() - 1;
+        }
+        lm.accumulate(robot_pose, robot, frame_obs[j], noise_inv, entry->second);
+    }
+
+    for (const auto& [label, info]: m_fusion_info) {
+        m_data_label = label;
+        // landmarks thawed by this frame are not allowed to converge again in it
+        bool was_thawed = std::find(m_fusion_thawed.begin(), m_fusion_thawed.end(), label) !=
+            m_fusion_thawed.end();
+        const struct ConvergenceConfig* policy = was_thawed ? nullptr : convergencePolicy();
+        if (m_lmekf_bank[label].first.applyInformation(info, policy) == KF_RET::SUCCESS) {
+            m_lmekf_bank[label].second += info.count;
+            m_last_assoc = PF_ASSOC::MATCHED;
+            continue;
+        }
+        PF_LOG_ERROR("landmark information update failed to invert",
+                     "landmark", label, "observations", info.count);
+        std::replace(labels.begin(), labels.end(), label, LABEL_REJECTED);
+        m_last_assoc = PF_ASSOC::REJECTED;
+    }
+    m_fusion_info.clear();
+    m_fusion_thawed.clear();
+}
+
+int FastSLAMParticles::getNumConvergedLandMark() const {
+    return std::count_if(m_lmekf_bank.begin(), m_lmekf_bank.end(),
+                         [](const auto& it) { return it.first.isConverged(); });
+}
+
+bool FastSLAMParticles::promoteLandmark(const struct Observation2D& obs, uint32_t uid) {
+    int label = LABEL_NEW_LANDMARK;
+    if (m_robot == nullptr ||
+        initLandmarks(m_robot_pose, m_robot, &obs, &label, 1, uid) == 0) return false;
+    m_last_assoc = PF_ASSOC::NEW_LANDMARK;
+    return true;
+}
+
+void FastSLAMParticles::addRobotPose(const struct Pose2D& starting_pose) {
+    m_fleet_poses.push_back(starting_pose);
+}
+
+const struct Pose2D& FastSLAMParticles::getRobotPose(unsigned int robot_id) const {
+    return robot_id == 0 || robot_id > m_fleet_poses.size() ? m_robot_pose
+                                                            : m_fleet_poses[robot_id - 1];
+}
+
+bool FastSLAMParticles::fuseLandmark(uint32_t uid, const struct Point2D& mean,
+                                     const Eigen::Matrix2f& cov, int sightings) {
+    int idx = findLandmark(uid);
+    if (idx < 0) return false;
+    KF_RET status = m_lmekf_bank[idx].first.fuse(mean, cov, m_cov_form);
+    if (acceptFallback(status, idx) != KF_RET::SUCCESS) return false;
+    m_lmekf_bank[idx].second += sightings;
+    return true;
+}
+
+void FastSLAMParticles::appendLandmark(uint32_t uid, const struct Point2D& mean,
+                                       const Eigen::Matrix2f& cov, int sightings) {
+    m_lmekf_bank.emplace_back(LMEKF2D(mean, cov, m_robot), sightings);
+    m_lm_uids.push_back(uid);
+}
+
+int FastSLAMParticles::getNumFrozenLandMark() const {
+    int num_frozen = 0;
+    for (const auto& it: m_frozen_submaps) {
+        num_frozen += it->landmarks.size();
+    }
+    return num_frozen;
+}
+
+void FastSLAMParticles::thawSubmap(const struct FrozenSubmap& submap) {
+    for (const auto& it: submap.landmarks) {
+        Eigen::Matrix2f cov;
+        cov << it.cov_xx, it.cov_xy,
+               it.cov_xy, it.cov_yy;
+        m_lmekf_bank.emplace_back(LMEKF2D({.x = it.x, .y = it.y}, cov, m_robot), it.sightings);
+        m_lm_uids.push_back(it.uid);
+    }
+}
+
+void FastSLAMParticles::sortBankByUid() {
+    if (std::is_sorted(m_lm_uids.begin(), m_lm_uids.end())) return;
+
+    std::vector<int> order(m_lm_uids.size());
+    for (int i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+              [this](int a, int b) { return m_lm_uids[a] < m_lm_uids[b]; });
+
+    std::vector<std::pair<LMEKF2D, int>> bank;
+    std::vector<uint32_t> uids;
+    bank.reserve(order.size());
+    uids.reserve(order.size());
+    for (const auto& idx: order) {
+        bank.push_back(m_lmekf_bank[idx]);
+        uids.push_back(m_lm_uids[idx]);
+    }
+    m_lmekf_bank.swap(bank);
+    m_lm_uids.swap(uids);
+}
+
+void FastSLAMParticles::updateActiveRegion(int32_t center_ix, int32_t center_iy,
+                                           const struct SubmapConfig& config) {
+    auto inWindow = [&](int64_t key) {
+        return std::abs(regionKeyX(key) - center_ix) <= config.active_radius &&
+               std::abs(regionKeyY(key) - center_iy) <= config.active_radius;
+    };
+
+    // thaw the frozen regions that entered the window
+    int num_kept = 0;
+    for (int i = 0; i < m_frozen_submaps.size(); i++) {
+        if (inWindow(m_frozen_submaps[i]->key)) {
+            thawSubmap(*m_frozen_submaps[i]);
+        } else {
+            m_frozen_submaps[num_kept++] = m_frozen_submaps[i];
+        }
+    }
+    m_frozen_submaps.resize(num_kept);
+
+    // freeze the active landmarks outside the window, grouped by region
+    std::vector<std::pair<int64_t, int>> leaving;
+    for (int i = 0; i < m_lmekf_bank.size(); i++) {
+        const struct Point2D& mean = m_lmekf_bank[i].first.getLMEst();
+        int64_t key = regionKey(regionIndex(mean.x, config.region_size_m),
+                                regionIndex(mean.y, config.region_size_m));
+        if (!inWindow(key)) leaving.push_back({key, i});
+    }
+    std::sort(leaving.begin(), leaving.end());
+
+    for (int begin = 0; begin < leaving.size();) {
+        int64_t key = leaving[begin].first;
+        auto submap = std::make_shared<FrozenSubmap>();
+        submap->key = key;
+
+        // frozen submaps are shared, so a region that gains landmarks gets a new copy
+        auto existing = std::find_if(m_frozen_submaps.begin(), m_frozen_submaps.end(),
+                                     [key](const auto& it) { return it->key == key; });
+        if (existing != m_frozen_submaps.end()) {
+            submap->landmarks = (*existing)->landmarks;
+        }
+
+        int end = begin;
+        for (; end < leaving.size() && leaving[end].first == key; end++) {
+            const auto& lm = m_lmekf_bank[leaving[end].second];
+            const Eigen::Matrix2f& cov = lm.first.getLMCov();
+            submap->landmarks.push_back({.uid = m_lm_uids[leaving[end].second],
+                                         .x = lm.first.getLMEst().x,
+                                         .y = lm.first.getLMEst().y,
+                                         .cov_xx = cov(0, 0), .cov_xy = cov(0, 1),
+                                         .cov_yy = cov(1, 1), .sightings = lm.second});
+        }
+
+        if (existing != m_frozen_submaps.end()) {
+            *existing = std::move(submap);
+        } else {
+            m_frozen_submaps.push_back(std::move(submap));
+        }
+        begin = end;
+    }
+
+    if (!leaving.empty()) {
+        // leaving is sorted by region, not by index; mark and compact the bank
+        std::vector<uint8_t> frozen(m_lmekf_bank.size(), 0);
+        for (const auto& it: leaving) {
+            frozen[it.second] = 1;
+        }
+        int num_active = 0;
+        for (int i = 0; i < m_lmekf_bank.size(); i++) {
+            if (frozen[i]) continue;
+            if (num_active != i) {
+                m_lmekf_bank[num_active] = m_lmekf_bank[i];
+                m_lm_uids[num_active] = m_lm_uids[i];
+            }
+            num_active++;
+        }
+        m_lmekf_bank.erase(m_lmekf_bank.begin() + num_active, m_lmekf_bank.end());
+        m_lm_uids.resize(num_active);
+    }
+
+    sortBankByUid();
+    m_data_label = -1;
+}
+
+float FastSLAMParticles::localizeParticle(const std::vector<struct Observation2D>& frame_obs,
+                                          const struct Pose2D& new_pose,
+                                          const PriorMap& map,
+                                          const struct LocalizationConfig& config,
+                                          int& num_matched) {
+    num_matched = 0;
+    if (m_robot == nullptr) {
+        PF_LOG_ERROR("no robot manager specified");
+        return MIN_LOG_LIKELIHOOD;
+    }
+    updatePose(new_pose);
+    PF_PROFILE_SCOPE(Profiler::Stage::ASSOCIATION);
+    const Eigen::Matrix2f meas_noise = m_robot->getMeasNoise();
+    float weight = 0.0f;
+    for (const auto& obs: frame_obs) {
+        // where the observation places its landmark, seen from this particle
+        float bearing = new_pose.theta_rad + obs.bearing_rad;
+        struct Point2D sighted = {.x = new_pose.x + obs.range_m * std::cos(bearing),
+                                  .y = new_pose.y + obs.range_m * std::sin(bearing)};
+        float best_w = m_importance_factor;
+        map.forEachNear(sighted, config.search_radius_m, [&](const struct PriorLandmark& lm) {
+            Eigen::Matrix2f H = m_robot->measJacobian(new_pose, lm.mean);
+            Eigen::Matrix2f S = H * lm.cov * H.transpose() + meas_noise;
+            Eigen::Vector2f innovation = obs - m_robot->predictMeas(new_pose, lm.mean);
+            innovation(1) = MathUtil::wrapAngle(innovation(1));
+            best_w = std::max(best_w, MathUtil::gaussianPdf2D(innovation, S));
+        });
+        num_matched += best_w > m_importance_factor;
+        weight += std::log(std::max(best_w, FLT_MIN));
+    }
+    m_last_assoc = num_matched > 0 ? PF_ASSOC::MATCHED : PF_ASSOC::REJECTED;
+    return weight;
+}
+
+void FastSLAMParticles::clearLandmarks() {
+    m_lmekf_bank.clear();
+    m_lm_uids.clear();
+    m_frozen_submaps.clear();
+    m_data_label = -1;
+}
+
+void FastSLAMParticles::thawAll() {
+    for (const auto& it: m_frozen_submaps) {
+        thawSubmap(*it);
+    }
+    m_frozen_submaps.clear();
+    sortBankByUid();
+    m_data_label = -1;
+}
+
+int FastSLAMParticles::findLandmark(uint32_t uid) const {
+    auto it = std::lower_bound(m_lm_uids.begin(), m_lm_uids.end(), uid);
+    return it != m_lm_uids.end() && *it == uid ? static_cast<int>(it - m_lm_uids.begin()) : -1;
+}
+
+bool FastSLAMParticles::getLandmarkEstimate(uint32_t uid, struct Point2D& mean,
+                                            Eigen::Matrix2f& cov) const {
+    int idx = findLandmark(uid);
+    if (idx >= 0) {
+        mean = m_lmekf_bank[idx].first.getLMEst();
+        cov = m_lmekf_bank[idx].first.getLMCov();
+        return true;
+    }
+    for (const auto& submap: m_frozen_submaps) {
+        for (const auto& it: submap->landmarks) {
+            if (it.uid != uid) continue;
+            mean = {.x = it.x, .y = it.y};
+            cov << it.cov_xx, it.cov_xy,
+                   it.cov_xy, it.cov_yy;
+            return true;
+        }
+    }
+    return false;
+}
+
 const std::vector<struct Point2D> FastSLAMParticles::getLandmarkCoordinates() const{
     std::vector<struct Point2D> landmarks;
     for(const auto& ekf : m_lmekf_bank){
-        landmarks.push_back(ekf.first->getLMEst());
+        landmarks.push_back(ekf.first.getLMEst());
+    }
+    for (const auto& submap: m_frozen_submaps) {
+        for (const auto& it: submap->landmarks) {
+            landmarks.push_back({.x = it.x, .y = it.y});
+        }
     }
     return landmarks;
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+/**
+ * @file prior-map.cpp
+ * @brief implements the grid index of the fixed landmark map
+ */
+
+#include "prior-map.h"
+#include "consensus-map.h"
+#include <algorithm>
+
+PriorMap::PriorMap(std::vector<struct PriorLandmark> landmarks, float cell_size_m):
+    m_cell_size_m(cell_size_m > 0 ? cell_size_m : 2.0f),
+    m_landmarks(std::move(landmarks)) {
+
+    // sort by cell key, then split into runs of one cell each
+    std::vector<std::pair<int64_t, uint32_t>> keyed;
+    keyed.reserve(m_landmarks.size());
+    for (uint32_t i = 0; i < m_landmarks.size(); i++) {
+        keyed.emplace_back(regionKey(regionIndex(m_landmarks[i].mean.x, m_cell_size_m),
+                                     regionIndex(m_landmarks[i].mean.y, m_cell_size_m)), i);
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    std::vector<struct PriorLandmark> sorted;
+    sorted.reserve(m_landmarks.size());
+    for (uint32_t i = 0; i < keyed.size(); i++) {
+        if (i == 0 || keyed[i].first != keyed[i - 1].first) {
+            m_cell_keys.push_back(keyed[i].first);
+            m_cell_start.push_back(i);
+        }
+        sorted.push_back(m_landmarks[keyed[i].second]);
+    }
+    m_cell_start.push_back(sorted.size());
+    m_landmarks = std::move(sorted);
+}
+
+PriorMap PriorMap::fromConsensus(const ConsensusMap& consensus, float min_support,
+                                 float cell_size_m) {
+    std::vector<struct PriorLandmark> landmarks;
+    landmarks.reserve(consensus.getLandmarks().size());
+    for (const auto& it: consensus.getLandmarks()) {
+        if (it.support < min_support) continue;
+        landmarks.push_back({.uid = it.uid, .mean = it.mean, .cov = it.cov});
+    }
+    return PriorMap(std::move(landmarks), cell_size_m);
+}
+
+int PriorMap::findCell(int64_t key) const {
+    auto it = std::lower_bound(m_cell_keys.begin(), m_cell_keys.end(), key);
+    if (it == m_cell_keys.end() || *it != key) return -1;
+    return static_cast<int>(it - m_cell_keys.begin());
+}
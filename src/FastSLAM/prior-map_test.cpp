@@ -0,0 +1,51 @@
+#include <catch2/catch_test_macros.hpp>
+#include "prior-map.h"
+#include <algorithm>
+
+namespace {
+
+std::vector<uint32_t> uidsNear(const PriorMap& map, const struct Point2D& center, float radius) {
+    std::vector<uint32_t> uids;
+    map.forEachNear(center, radius, [&](const struct PriorLandmark& lm) {
+        uids.push_back(lm.uid);
+    });
+    std::sort(uids.begin(), uids.end());
+    return uids;
+}
+
+} // namespace
+
+TEST_CASE( "Test prior map" ){
+    Eigen::Matrix2f cov = 0.01f * Eigen::Matrix2f::Identity();
+    PriorMap map({{.uid = 0, .mean = {.x = 0.5f, .y = 0.5f}, .cov = cov},
+                  {.uid = 1, .mean = {.x = 1.9f, .y = 0.1f}, .cov = cov},
+                  {.uid = 2, .mean = {.x = -0.5f, .y = -0.5f}, .cov = cov},
+                  {.uid = 3, .mean = {.x = 10.0f, .y = -7.0f}, .cov = cov},
+                  {.uid = 4, .mean = {.x = 0.6f, .y = 0.4f}, .cov = cov}}, 1.0f);
+    REQUIRE( map.size() == 5 );
+
+    SECTION( "landmarks are grouped by cell" ){
+        const auto& landmarks = map.getLandmarks();
+        auto first = std::find_if(landmarks.begin(), landmarks.end(),
+                                  [](const auto& lm) { return lm.uid == 0; });
+        REQUIRE( first != landmarks.end() );
+        REQUIRE( (first + 1 != landmarks.end() && (first + 1)->uid == 4) );
+        REQUIRE( map.findCell(regionKey(0, 0)) >= 0 );
+        REQUIRE( map.findCell(regionKey(5, 5)) == -1 );
+    }
+
+    SECTION( "queries return the landmarks within the radius, across cells" ){
+        REQUIRE( uidsNear(map, {.x = 0.5f, .y = 0.5f}, 0.2f) == std::vector<uint32_t>{0, 4} );
+        REQUIRE( uidsNear(map, {.x = 0.5f, .y = 0.5f}, 1.5f) ==
+                 std::vector<uint32_t>{0, 1, 2, 4} );
+        REQUIRE( uidsNear(map, {.x = 10.0f, .y = -7.0f}, 0.0f) == std::vector<uint32_t>{3} );
+        REQUIRE( uidsNear(map, {.x = 5.0f, .y = 5.0f}, 1.0f).empty() );
+        REQUIRE( uidsNear(map, {.x = 0.5f, .y = 0.5f}, -1.0f).empty() );
+    }
+
+    SECTION( "an empty map answers every query with nothing" ){
+        PriorMap empty(std::vector<struct PriorLandmark>{});
+        REQUIRE( empty.size() == 0 );
+        REQUIRE( uidsNear(empty, {.x = 0, .y = 0}, 100.0f).empty() );
+    }
+}
@@ -0,0 +1,109 @@
+/**
+ * @file profiler.cpp
+ * @brief Implements the stage timing histograms
+ */
+
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+const char* Profiler::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::SAMPLE_POSE:
+            return "sample_pose";
+        case Stage::ASSOCIATION:
+            return "association";
+        case Stage::EKF_UPDATE:
+            return "ekf_update";
+        case Stage::WEIGHTING:
+            return "weighting";
+        case Stage::RESAMPLE:
+            return "resample";
+        case Stage::FRAME:
+            return "frame";
+        default:
+            return "unknown";
+    }
+}
+
+int Profiler::LatencyHistogram::bucketIndex(uint64_t duration_ns) {
+    if (duration_ns > MAX_TRACKABLE_NS) duration_ns = MAX_TRACKABLE_NS;
+    if (duration_ns < SUB_BUCKET_COUNT) return static_cast<int>(duration_ns);
+
+    // keep the top SUB_BUCKET_BITS bits; the shift selects the power-of-two range
+    int msb = 63 - __builtin_clzll(duration_ns);
+    int shift = msb - (SUB_BUCKET_BITS - 1);
+    uint64_t sub_bucket = duration_ns >> shift;
+    return static_cast<int>(SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF +
+                            (sub_bucket - SUB_BUCKET_HALF));
+}
+
+uint64_t Profiler::LatencyHistogram::bucketUpperNs(int bucket) {
+    if (bucket < static_cast<int>(SUB_BUCKET_COUNT)) return static_cast<uint64_t>(bucket);
+
+    int offset = bucket - static_cast<int>(SUB_BUCKET_COUNT);
+    int shift = offset / static_cast<int>(SUB_BUCKET_HALF) + 1;
+    uint64_t sub_bucket = SUB_BUCKET_HALF + offset % SUB_BUCKET_HALF;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void Profiler::LatencyHistogram::record(uint64_t duration_ns) {
+    m_buckets[bucketIndex(duration_ns)]++;
+    m_count++;
+    m_total_ns += duration_ns;
+    m_min_ns = std::min(m_min_ns, duration_ns);
+    m_max_ns = std::max(m_max_ns, duration_ns);
+}
+
+void Profiler::LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_total_ns += other.m_total_ns;
+    m_min_ns = std::min(m_min_ns, other.m_min_ns);
+    m_max_ns = std::max(m_max_ns, other.m_max_ns);
+}
+
+void Profiler::LatencyHistogram::reset() {
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    m_count = 0;
+    m_total_ns = 0;
+    m_min_ns = UINT64_MAX;
+    m_max_ns = 0;
+}
+
+uint64_t Profiler::LatencyHistogram::percentileNs(double pct) const {
+    if (m_count == 0) return 0;
+
+    // the epsilon keeps e.g. p99.9 of 1000 samples at rank 999 despite rounding in pct / 100
+    uint64_t rank = static_cast<uint64_t>(
+        std::ceil(pct / 100.0 * static_cast<double>(m_count) - 1e-9));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        seen += m_buckets[i];
+        if (seen >= rank) {
+            // the bucket's upper bound, clamped to what was actually observed
+            return std::min(m_max_ns, bucketUpperNs(i));
+        }
+    }
+    return m_max_ns;
+}
+
+bool Profiler::writeLatencyReport(const StageProfile& profile, const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+
+    out << "stage,count,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n";
+    for (int i = 0; i < NUM_STAGES; i++) {
+        const LatencyHistogram& hist = profile.stages[i];
+        if (hist.count() == 0) continue;
+        out << stageName(static_cast<Stage>(i)) << "," << hist.count() << ","
+            << static_cast<uint64_t>(hist.meanNs()) << "," << hist.percentileNs(50.0) << ","
+            << hist.percentileNs(90.0) << "," << hist.percentileNs(99.0) << ","
+            << hist.percentileNs(99.9) << "," << hist.maxNs() << "\n";
+    }
+    return out.good();
+}
@@ -0,0 +1,106 @@
+#include <catch2/catch_test_macros.hpp>
+#include "profiler.h"
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+TEST_CASE( "Test latency histogram" ){
+    Profiler::LatencyHistogram hist;
+    REQUIRE( hist.count() == 0 );
+    REQUIRE( hist.percentileNs(50.0) == 0 );
+
+    SECTION( "small durations are counted exactly" ){
+        hist.record(1);
+        hist.record(3);
+        hist.record(100);
+        REQUIRE( hist.bucketCount(1) == 1 );
+        REQUIRE( hist.bucketCount(3) == 1 );
+        REQUIRE( hist.bucketCount(100) == 1 );
+        REQUIRE( hist.count() == 3 );
+        REQUIRE( hist.totalNs() == 104 );
+        REQUIRE( hist.minNs() == 1 );
+        REQUIRE( hist.maxNs() == 100 );
+    }
+
+    SECTION( "large durations keep their relative precision" ){
+        for (uint64_t value: {uint64_t{128}, uint64_t{1000}, uint64_t{123456},
+                              uint64_t{987654321}, uint64_t{1} << 39}) {
+            int bucket = Profiler::LatencyHistogram::bucketIndex(value);
+            uint64_t upper = Profiler::LatencyHistogram::bucketUpperNs(bucket);
+            REQUIRE( upper >= value );
+            REQUIRE( upper - value <= value / Profiler::LatencyHistogram::SUB_BUCKET_HALF );
+            REQUIRE( bucket < Profiler::LatencyHistogram::NUM_BUCKETS );
+        }
+        REQUIRE( Profiler::LatencyHistogram::bucketIndex(UINT64_MAX) ==
+                 Profiler::LatencyHistogram::NUM_BUCKETS - 1 );
+    }
+
+    SECTION( "percentiles report the tail" ){
+        for (int i = 0; i < 999; i++) {
+            hist.record(10000);
+        }
+        hist.record(5000000);
+        REQUIRE( hist.percentileNs(50.0) >= 10000 );
+        REQUIRE( hist.percentileNs(50.0) <= 10000 + 10000 / Profiler::LatencyHistogram::SUB_BUCKET_HALF );
+        REQUIRE( hist.percentileNs(99.0) <= 10000 + 10000 / Profiler::LatencyHistogram::SUB_BUCKET_HALF );
+        REQUIRE( hist.percentileNs(99.9) <= 10000 + 10000 / Profiler::LatencyHistogram::SUB_BUCKET_HALF );
+        REQUIRE( hist.percentileNs(100.0) == 5000000 );
+    }
+
+    SECTION( "merge adds another histogram" ){
+        Profiler::LatencyHistogram other;
+        hist.record(10);
+        other.record(2000);
+        hist.merge(other);
+        REQUIRE( hist.count() == 2 );
+        REQUIRE( hist.minNs() == 10 );
+        REQUIRE( hist.maxNs() == 2000 );
+    }
+
+    SECTION( "reset clears everything" ){
+        hist.record(42);
+        hist.reset();
+        REQUIRE( hist.count() == 0 );
+        REQUIRE( hist.maxNs() == 0 );
+        REQUIRE( hist.bucketCount(42) == 0 );
+    }
+}
+
+TEST_CASE( "Test latency report export" ){
+    Profiler::StageProfile profile;
+    profile[Profiler::Stage::FRAME].record(2000);
+    std::string path = "latency_report_test.csv";
+    REQUIRE( Profiler::writeLatencyReport(profile, path) );
+
+    std::ifstream in(path);
+    std::string header, row, extra;
+    std::getline(in, header);
+    std::getline(in, row);
+    REQUIRE( header == "stage,count,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns" );
+    REQUIRE( row == "frame,1,2000,2000,2000,2000,2000,2000" );
+    REQUIRE_FALSE( std::getline(in, extra) );
+    std::remove(path.c_str());
+}
+
+TEST_CASE( "Test scoped timer binding" ){
+    Profiler::StageProfile profile;
+
+    SECTION( "unbound timers record nothing" ){
+        {
+            Profiler::ScopedTimer timer(Profiler::Stage::ASSOCIATION);
+        }
+        REQUIRE( profile[Profiler::Stage::ASSOCIATION].count() == 0 );
+    }
+
+    SECTION( "bound timers record into their stage" ){
+        {
+            Profiler::ProfileBinding binding(profile);
+            Profiler::ScopedTimer timer(Profiler::Stage::RESAMPLE);
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        REQUIRE( profile[Profiler::Stage::RESAMPLE].count() == 1 );
+        REQUIRE( profile[Profiler::Stage::RESAMPLE].minNs() >= 50000 );
+        REQUIRE( profile[Profiler::Stage::ASSOCIATION].count() == 0 );
+        REQUIRE( Profiler::t_active_profile == nullptr );
+    }
+}
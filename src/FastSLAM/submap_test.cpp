@@ -0,0 +1,90 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "particle-filter.h"
+#include "robot-manager.h"
+#include "submap.h"
+
+TEST_CASE( "Test region keys" ){
+    REQUIRE( regionIndex(0.5f, 20.0f) == 0 );
+    REQUIRE( regionIndex(-0.5f, 20.0f) == -1 );
+    REQUIRE( regionIndex(45.0f, 20.0f) == 2 );
+
+    int64_t key = regionKey(-3, 7);
+    REQUIRE( regionKeyX(key) == -3 );
+    REQUIRE( regionKeyY(key) == 7 );
+    REQUIRE( regionKey(1, 0) != regionKey(0, 1) );
+}
+
+#ifdef USE_MOCK
+TEST_CASE( "Test submaps" ){
+    Eigen::Matrix2f meas_noise;
+    meas_noise << 0.01f, 0,
+        0, 0.001f;
+    struct Pose2D origin = {.x = 0, .y = 0, .theta_rad = 0};
+    struct Pose2D far_pose = {.x = 100, .y = 0, .theta_rad = 0};
+    std::shared_ptr<RobotManager2D> test_manager = std::make_shared<MockManager2D>(
+        origin, VelocityCommand2D{.vx_mps = 0, .wz_radps = 0}, meas_noise, 10,
+        Eigen::Matrix3f::Zero());
+    struct SubmapConfig config;
+    config.region_size_m = 20.0f;
+    config.active_radius = 0;
+
+    SECTION( "distant landmarks are frozen and thawed by region" ){
+        FastSLAMParticles particle(0.5, origin, test_manager);
+        particle.updateParticle({.range_m = 2, .bearing_rad = 0}, origin, 1);
+        particle.updateParticle({.range_m = 3, .bearing_rad = 0}, far_pose, 2);
+        REQUIRE( particle.getNumLandMark() == 2 );
+
+        particle.updateActiveRegion(0, 0, config);
+        REQUIRE( particle.getNumLandMark() == 1 );
+        REQUIRE( particle.getNumFrozenLandMark() == 1 );
+        REQUIRE( particle.findLandmark(1) == 0 );
+        REQUIRE( particle.findLandmark(2) == -1 );
+        REQUIRE( particle.getLandmarkCoordinates().size() == 2 );
+
+        // copies share the frozen storage
+        FastSLAMParticles copy = particle;
+        REQUIRE( copy.getFrozenSubmaps()[0] == particle.getFrozenSubmaps()[0] );
+
+        particle.updateActiveRegion(5, 0, config);
+        REQUIRE( particle.getNumLandMark() == 1 );
+        REQUIRE( particle.findLandmark(2) == 0 );
+        REQUIRE_THAT( particle.getLandmark(0).getLMEst().x, Catch::Matchers::WithinAbs(103, 1e-4) );
+        REQUIRE( copy.getNumFrozenLandMark() == 1 );
+
+        // a wide window holds everything again, in uid order
+        config.active_radius = 10;
+        particle.updateActiveRegion(0, 0, config);
+        REQUIRE( particle.getNumLandMark() == 2 );
+        REQUIRE( particle.getNumFrozenLandMark() == 0 );
+        REQUIRE( particle.getLandmarkUid(0) == 1 );
+        REQUIRE( particle.getLandmarkUid(1) == 2 );
+    }
+
+    SECTION( "the filter only associates against the active window" ){
+        FastSLAMPF test_pf(test_manager, 10, origin, 0.5);
+        test_pf.enableSubmaps(config);
+
+        std::queue<struct Observation2D> sightings;
+        sightings.push({.range_m = 2, .bearing_rad = 0});
+        test_pf.updateFilter(origin, sightings);
+        REQUIRE( test_pf.returnEst().getNumLandMark() == 1 );
+
+        sightings.push({.range_m = 3, .bearing_rad = 0});
+        test_pf.updateFilter(far_pose, sightings);
+        REQUIRE( test_pf.returnEst().getNumLandMark() == 1 );
+        REQUIRE( test_pf.returnEst().getNumFrozenLandMark() == 1 );
+
+        // returning thaws the first landmark, which is matched again
+        sightings.push({.range_m = 2, .bearing_rad = 0});
+        test_pf.updateFilter(origin, sightings);
+        REQUIRE( test_pf.returnEst().getNumLandMark() == 1 );
+        REQUIRE( test_pf.returnEst().getNumFrozenLandMark() == 1 );
+        REQUIRE( test_pf.getConsensusMap().getLandmarks().size() == 2 );
+
+        test_pf.disableSubmaps();
+        REQUIRE( test_pf.returnEst().getNumLandMark() == 2 );
+        REQUIRE( test_pf.returnEst().getNumFrozenLandMark() == 0 );
+    }
+}
+#endif //USE_MOCK
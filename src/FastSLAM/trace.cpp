@@ -0,0 +1,131 @@
+/**
+ * @file trace.cpp
+ * @brief Implements the per-thread span buffers and the Chrome trace-event export
+ */
+
+#include "trace.h"
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+
+std::atomic<bool> Trace::g_enabled{false};
+
+namespace {
+
+/**
+ * @brief every buffer ever registered; buffers outlive their threads so they can be dumped
+ */
+struct BufferRegistry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<Trace::ThreadBuffer>> buffers;
+};
+
+BufferRegistry& registry() {
+    static BufferRegistry instance;
+    return instance;
+}
+
+const std::chrono::steady_clock::time_point& epoch() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+/**
+ * @brief trace-event timestamps are microseconds; keep nanosecond resolution as decimals
+ */
+std::string toMicros(uint64_t ns) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%llu.%03llu", static_cast<unsigned long long>(ns / 1000),
+             static_cast<unsigned long long>(ns % 1000));
+    return buf;
+}
+
+} // namespace
+
+void Trace::start() {
+    epoch();
+    g_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::stop() {
+    g_enabled.store(false, std::memory_order_relaxed);
+}
+
+void Trace::clear() {
+    std::lock_guard<std::mutex> guard(registry().lock);
+    for (auto& it: registry().buffers) {
+        it->clear();
+    }
+}
+
+uint64_t Trace::nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch()).count());
+}
+
+Trace::ThreadBuffer& Trace::threadBuffer() {
+    thread_local ThreadBuffer* t_buffer = nullptr;
+    if (t_buffer == nullptr) {
+        std::lock_guard<std::mutex> guard(registry().lock);
+        uint32_t tid = static_cast<uint32_t>(registry().buffers.size()) + 1;
+        registry().buffers.push_back(std::make_unique<ThreadBuffer>(tid, DEFAULT_BUFFER_EVENTS));
+        t_buffer = registry().buffers.back().get();
+        t_buffer->setThreadName("thread " + std::to_string(tid));
+    }
+    return *t_buffer;
+}
+
+void Trace::setThreadName(const std::string& name) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> guard(registry().lock);
+    buffer.setThreadName(name);
+}
+
+std::vector<Trace::TraceEvent> Trace::ThreadBuffer::snapshot() const {
+    uint64_t written = m_written.load(std::memory_order_acquire);
+    uint64_t capacity = m_events.size();
+    uint64_t first = written > capacity ? written - capacity : 0;
+
+    std::vector<TraceEvent> events;
+    events.reserve(written - first);
+    for (uint64_t i = first; i < written; i++) {
+        events.push_back(m_events[i % capacity]);
+    }
+    return events;
+}
+
+bool Trace::dumpChromeJson(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+
+    const long pid = static_cast<long>(getpid());
+    bool first_event = true;
+    auto separator = [&first_event]() {
+        const char* sep = first_event ? "\n" : ",\n";
+        first_event = false;
+        return sep;
+    };
+
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    std::lock_guard<std::mutex> guard(registry().lock);
+    for (const auto& buffer: registry().buffers) {
+        out << separator() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+            << ", \"tid\": " << buffer->getTid()
+            << ", \"args\": {\"name\": \"" << buffer->getThreadName() << "\"}}";
+
+        for (const auto& it: buffer->snapshot()) {
+            out << separator() << "{\"name\": \"" << it.name << "\", \"cat\": \"" << it.category
+                << "\", \"ph\": \"X\", \"pid\": " << pid << ", \"tid\": " << buffer->getTid()
+                << ", \"ts\": " << toMicros(it.start_ns)
+                << ", \"dur\": " << toMicros(it.duration_ns);
+            if (it.arg >= 0) {
+                out << ", \"args\": {\"value\": " << it.arg << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    return out.good();
+}
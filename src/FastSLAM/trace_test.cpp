@@ -0,0 +1,68 @@
+#include <catch2/catch_test_macros.hpp>
+#include "trace.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+} // namespace
+
+TEST_CASE( "Test thread buffer ring" ){
+    Trace::ThreadBuffer buffer(1, 4);
+    REQUIRE( buffer.snapshot().empty() );
+
+    for (int i = 0; i < 6; i++) {
+        buffer.push({"span", "test", static_cast<uint64_t>(i), 1, i});
+    }
+    auto events = buffer.snapshot();
+    REQUIRE( events.size() == 4 );
+    REQUIRE( events.front().arg == 2 );
+    REQUIRE( events.back().arg == 5 );
+
+    buffer.clear();
+    REQUIRE( buffer.snapshot().empty() );
+}
+
+TEST_CASE( "Test Chrome trace export" ){
+    Trace::clear();
+
+    SECTION( "spans are dropped while tracing is stopped" ){
+        {
+            Trace::ScopedSpan span("ignored", "test");
+        }
+        REQUIRE( Trace::threadBuffer().snapshot().empty() );
+    }
+
+    SECTION( "spans of every thread are exported" ){
+        Trace::start();
+        {
+            Trace::ScopedSpan span("main_span", "test", 7);
+        }
+        std::thread worker([]() {
+            Trace::setThreadName("worker 1");
+            Trace::ScopedSpan span("worker_span", "test");
+        });
+        worker.join();
+        Trace::stop();
+
+        const std::string path = "trace_test_output.json";
+        REQUIRE( Trace::dumpChromeJson(path) );
+        std::string json = readFile(path);
+        std::remove(path.c_str());
+
+        REQUIRE( json.find("\"traceEvents\"") != std::string::npos );
+        REQUIRE( json.find("\"name\": \"main_span\"") != std::string::npos );
+        REQUIRE( json.find("\"args\": {\"value\": 7}") != std::string::npos );
+        REQUIRE( json.find("\"name\": \"worker_span\"") != std::string::npos );
+        REQUIRE( json.find("\"name\": \"worker 1\"") != std::string::npos );
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * @file worker-pool.cpp
+ * @brief implements the persistent worker threads
+ */
+
+#include "worker-pool.h"
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stop = true;
+    }
+    m_start.notify_all();
+    for (auto& it: m_threads) {
+        it.join();
+    }
+}
+
+void WorkerPool::workerLoop(unsigned int worker, uint64_t generation) {
+    std::unique_lock<std::mutex> guard(m_lock);
+    while (true) {
+        m_start.wait(guard, [&]() { return m_stop || m_generation != generation; });
+        if (m_stop) return;
+        generation = m_generation;
+        if (worker > m_active) continue;
+
+        const std::function<void(unsigned int)>* task = m_task;
+        guard.unlock();
+        (*task)(worker);
+        guard.lock();
+        if (--m_pending == 0) m_done.notify_all();
+    }
+}
+
+void WorkerPool::run(unsigned int num_workers, const std::function<void(unsigned int)>& task) {
+    if (num_workers <= 1) {
+        task(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        while (m_threads.size() < num_workers - 1) {
+            m_threads.emplace_back(&WorkerPool::workerLoop, this,
+                                   static_cast<unsigned int>(m_threads.size()) + 1,
+                                   m_generation);
+        }
+        m_task = &task;
+        m_active = num_workers - 1;
+        m_pending = m_active;
+        m_generation++;
+    }
+    m_start.notify_all();
+
+    task(0);
+
+    std::unique_lock<std::mutex> guard(m_lock);
+    m_done.wait(guard, [&]() { return m_pending == 0; });
+    m_task = nullptr;
+}
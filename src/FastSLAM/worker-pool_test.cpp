@@ -0,0 +1,58 @@
+#include <catch2/catch_test_macros.hpp>
+#include "worker-pool.h"
+#include <atomic>
+#include <set>
+
+TEST_CASE( "Test worker pool" ){
+    WorkerPool pool;
+
+    SECTION( "a single worker runs inline" ){
+        std::thread::id caller;
+        pool.run(1, [&](unsigned int worker) {
+            REQUIRE( worker == 0 );
+            caller = std::this_thread::get_id();
+        });
+        REQUIRE( caller == std::this_thread::get_id() );
+        REQUIRE( pool.size() == 0 );
+    }
+
+    SECTION( "threads are started once and reused by every run" ){
+        std::set<std::thread::id> seen;
+        std::mutex lock;
+        for (int run = 0; run < 200; run++) {
+            std::atomic<int> calls{0};
+            std::atomic<unsigned int> workers_sum{0};
+            pool.run(4, [&](unsigned int worker) {
+                calls++;
+                workers_sum += worker;
+                std::lock_guard<std::mutex> guard(lock);
+                seen.insert(std::this_thread::get_id());
+            });
+            REQUIRE( calls == 4 );
+            REQUIRE( workers_sum == 0 + 1 + 2 + 3 );
+        }
+        REQUIRE( pool.size() == 3 );
+        REQUIRE( seen.size() == 4 );
+    }
+
+    SECTION( "smaller runs leave the extra threads idle" ){
+        pool.run(4, [](unsigned int) {});
+        std::atomic<int> calls{0};
+        std::atomic<unsigned int> max_worker{0};
+        pool.run(2, [&](unsigned int worker) {
+            calls++;
+            unsigned int seen = max_worker;
+            while (worker > seen && !max_worker.compare_exchange_weak(seen, worker)) {}
+        });
+        REQUIRE( calls == 2 );
+        REQUIRE( max_worker == 1 );
+        REQUIRE( pool.size() == 3 );
+    }
+
+    SECTION( "a copy starts without threads" ){
+        pool.run(3, [](unsigned int) {});
+        WorkerPool copy = pool;
+        REQUIRE( copy.size() == 0 );
+        REQUIRE( pool.size() == 2 );
+    }
+}